@@ -0,0 +1,16 @@
+varying lowp vec4 destinationColor;     // color or selection id
+varying highp vec4 currentPosition;
+varying highp vec4 sourcePosition;
+varying mediump float destinationStippleLength;  // 0.0 disables stippling
+
+void main() {
+    const mediump float pi = 3.1415;
+    if ((destinationStippleLength > 0.0) && (sin(pi*abs(distance(sourcePosition.xyz, currentPosition.xyz))/destinationStippleLength) < 0.0))
+    {
+        gl_FragColor = vec4(0,0,0,0);
+    }
+    else
+    {
+        gl_FragColor = destinationColor;
+    }
+}
@@ -0,0 +1,95 @@
+// global
+uniform highp mat4 projectionMatrix;    // projection matrix
+uniform highp mat4 viewMatrix;          // view matrix
+uniform highp float segmentCount;       // segments of the draw call, the most any arc of the batch needs
+uniform highp float pixelScale;         // pixels per world unit at a distance of 1.0
+uniform highp float arcTolerance;       // maximum distance in pixels between an arc and its segments
+
+// batch specific
+uniform highp float executedSequence;   // arcs with a lower sequence are drawn in the backplot color
+
+// vertex specific
+attribute highp float segment;          // per-vertex index of the point on the arc, 0 is the start
+
+// instance specific
+attribute highp vec4 modelRow0;         // per-instance rows of the model matrix
+attribute highp vec4 modelRow1;
+attribute highp vec4 modelRow2;
+attribute highp vec4 arc;               // per-instance center x, center y, radius and start angle
+attribute highp vec4 sweep;             // per-instance sweep angle, helix offset, stipple length and selection id
+attribute lowp vec4 color;              // per-instance color
+attribute lowp vec4 backplotColor;      // per-instance color once executed
+attribute highp float sequence;         // per-instance position in the program order
+
+// selection mode
+uniform highp float idOffset;     // selection id of the first arc
+uniform bool selectionMode;       // enables or disables the selection mode
+
+varying lowp vec4 destinationColor;
+varying highp vec4 currentPosition;
+varying highp vec4 sourcePosition;
+varying mediump float destinationStippleLength;
+
+highp vec4 modelPoint(highp vec4 point)
+{
+    return vec4(dot(modelRow0, point), dot(modelRow1, point), dot(modelRow2, point), 1.0);
+}
+
+highp vec4 arcPoint(highp float t)
+{
+    highp float angle = arc.w + sweep.x * t;
+
+    return modelPoint(vec4(arc.x + arc.z * cos(angle), arc.y + arc.z * sin(angle), sweep.y * t, 1.0));
+}
+
+// segments needed by this arc, the surplus segments of the draw call collapse to its end point
+highp float arcSegments(highp mat4 viewProjectionMatrix)
+{
+    highp vec4 center = viewProjectionMatrix * modelPoint(vec4(arc.x, arc.y, sweep.y * 0.5, 1.0));
+    highp float scale = max(length(vec3(modelRow0.x, modelRow1.x, modelRow2.x)),
+                            max(length(vec3(modelRow0.y, modelRow1.y, modelRow2.y)),
+                                length(vec3(modelRow0.z, modelRow1.z, modelRow2.z))));
+    highp float pixelRadius;
+
+    if (center.w <= 0.0)
+    {
+        return segmentCount;    // at or behind the camera
+    }
+
+    // a segment of angle a deviates r * a^2 / 8 from the arc
+    pixelRadius = arc.z * scale * pixelScale / center.w;
+    return clamp(ceil(abs(sweep.x) * sqrt(pixelRadius / (8.0 * arcTolerance))), 1.0, segmentCount);
+}
+
+void main() {
+    highp mat4 viewProjectionMatrix = projectionMatrix * viewMatrix;
+
+    if (selectionMode)
+    {
+        // encode the id as 24 bit RGB color
+        highp float id = idOffset + sweep.w;
+        destinationColor = vec4(mod(floor(id / 65536.0), 256.0) / 255.0,
+                                mod(floor(id / 256.0), 256.0) / 255.0,
+                                mod(id, 256.0) / 255.0,
+                                1.0);
+    }
+    else
+    {
+        destinationColor = (sequence < executedSequence) ? backplotColor : color;
+    }
+    destinationStippleLength = sweep.z;
+
+    highp float segments = arcSegments(viewProjectionMatrix);
+    currentPosition = viewProjectionMatrix * arcPoint(min(segment, segments) / segments);
+
+    if (sweep.z > 0.0)
+    {
+        sourcePosition = viewProjectionMatrix * arcPoint(0.0);
+    }
+    else
+    {
+        sourcePosition = currentPosition;
+    }
+
+    gl_Position = currentPosition;
+}
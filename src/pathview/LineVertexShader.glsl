@@ -1,31 +1,46 @@
 // global
 uniform highp mat4 projectionMatrix;    // projection matrix
 uniform highp mat4 viewMatrix;          // view matrix
+uniform highp float vertexResolution;   // size of one quantization step of positions
 
-// line specific
-uniform highp mat4 modelMatrix;         // model matrix
-uniform lowp vec4 color;          // per-vertex color
+// group specific
+uniform highp float executedSequence;   // vertices with a lower sequence are drawn in the backplot color
+
+// chunk specific
+uniform highp vec3 chunkOrigin;         // position of the quantized value 0
+uniform highp vec3 chunkStippleOrigin;  // start point of the stipple pattern of all vertices
+uniform highp float chunkStippleLength; // 0.0 disables stippling
+uniform highp float chunkSequenceOrigin;    // sequence of the quantized value 0
 
 // vertex specific
-attribute highp vec4 position;    // per-vertex position
-uniform bool stipple;       // enable or disable stippling
+attribute highp vec3 position;          // per-vertex quantized position
+attribute lowp vec4 color;              // per-vertex color
+attribute lowp vec4 backplotColor;      // per-vertex color once executed
+attribute highp float sequence;         // per-vertex position in the program order, relative to the chunk
 
 varying lowp vec4 destinationColor;
 varying highp vec4 currentPosition;
 varying highp vec4 sourcePosition;
+varying mediump float destinationStippleLength;
 
 void main() {
-    highp mat4 modelviewMatrix = viewMatrix * modelMatrix;
+    highp mat4 viewProjectionMatrix = projectionMatrix * viewMatrix;
+
+    highp vec4 worldPosition = vec4(chunkOrigin + position * vertexResolution, 1.0);
+
+    destinationColor = ((chunkSequenceOrigin + sequence) < executedSequence) ? backplotColor : color;
+    destinationStippleLength = chunkStippleLength;
 
-    destinationColor = color;
+    currentPosition = viewProjectionMatrix * worldPosition;
 
-    if (stipple)
+    if (chunkStippleLength > 0.0)
     {
-        const highp vec4 sourcePoint = vec4(0.0, 0.0, 0.0, 1.0);
-        sourcePosition = projectionMatrix * modelviewMatrix * sourcePoint;
+        sourcePosition = viewProjectionMatrix * vec4(chunkStippleOrigin, 1.0);
+    }
+    else
+    {
+        sourcePosition = currentPosition;
     }
-
-    currentPosition = projectionMatrix * modelviewMatrix * position;
 
     gl_Position = currentPosition;
 }
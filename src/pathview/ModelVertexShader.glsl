@@ -2,14 +2,15 @@
 uniform highp mat4 projectionMatrix;    // projection matrix
 uniform highp mat4 viewMatrix;          // view matrix
 
-// model specific
-uniform highp mat4 modelMatrix;         // model matrix
-uniform lowp vec4 color;                // per-vertex color
-
 // vertex specific
 attribute highp vec4 position;    // per-vertex position
 attribute highp vec3 normal;      // per-vertex normal information
 
+// instance specific
+attribute highp mat4 modelMatrix;   // per-instance model matrix
+attribute lowp vec4 color;          // per-instance color
+attribute highp float pickId;       // per-instance selection id
+
 // lighting
 //uniform vec3 lightPos;            // position of the light source
 //uniform bool enableLighting;      // whether lighting is enabled or not
@@ -25,7 +26,7 @@ struct Light {
 uniform Light light;
 
 // selection mode
-uniform lowp vec4 idColor;             // color to be used for selection mode
+uniform highp float idOffset;     // selection id of the first instance
 uniform bool selectionMode;       // enables or disables the selection mode
 
 varying lowp vec4 destinationColor;  // the output colors
@@ -35,7 +36,12 @@ void main(void) {
 
     if (selectionMode)
     {
-        destinationColor = idColor;
+        // encode the id as 24 bit RGB color
+        highp float id = idOffset + pickId;
+        destinationColor = vec4(mod(floor(id / 65536.0), 256.0) / 255.0,
+                                mod(floor(id / 256.0), 256.0) / 255.0,
+                                mod(id, 256.0) / 255.0,
+                                1.0);
     }
     else if (light.enabled)
     {
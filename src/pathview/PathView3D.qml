@@ -85,13 +85,29 @@ GLView3D {
     property bool coordinateVisible: object.settings.initialized && object.settings.values.preview.showCoordinate
     property bool offsetsVisible: object.settings.initialized && object.settings.values.dro.showOffsets
 
+    // quality policy while the camera moves, applications can tune or turn off the fast mode
+    property alias fastInteraction: pathView.adaptiveQuality
+    property alias fastInteractionRenderScale: pathView.interactionRenderScale
+    property alias fastInteractionTimeout: pathView.interactionTimeout
+
     property bool _ready: status.synced
     property var _axisNames: ["x", "y", "z", "a", "b", "c", "u", "v", "w"]
 
     id: pathView
 
+    adaptiveQuality: true
     enabled: object.settings.initialized && object.settings.values.preview.enable
     visible: enabled
+    vertexResolution: { // 1 um in program units, the preview client falls back to inches too
+        switch (_ready ? status.config.programUnits : ApplicationStatus.CanonUnitsInches) {
+        case ApplicationStatus.CanonUnitsInches:
+            return 0.001 / 25.4
+        case ApplicationStatus.CanonUnitsCm:
+            return 0.0001
+        default:
+            return 0.001
+        }
+    }
 
     camera: Camera3D {
         property real heading: pathView.cameraHeading
@@ -296,6 +312,7 @@ GLView3D {
 
     Grid3D {
         visible: pathView.gridVisible && (pathView.viewMode != "Perspective")
+        cached: true
         colorAxis1: pathView.colors["grid"]
         colorAxis1Min: pathView.colors["grid_min"]
         colorAxis2: pathView.colors["grid"]
@@ -329,6 +346,7 @@ GLView3D {
     BoundingBox3D {
         id: boundingBox
         visible: pathView.machineLimitsVisible
+        cached: true
         axes: pathView.axes
         lineStippleLength: (pathView.viewMode == "Perspective") ? 0.02 * camera.distance / pathView.cameraZoom : 0.02
         minimum.x: _ready ? status.config.axis[0].minPositionLimit : 0
@@ -342,6 +360,7 @@ GLView3D {
     ProgramExtents3D {
         id: programExtents
         visible: pathView.programVisible && pathView.programExtentsVisible
+        cached: true
         position: coordinates.position
         axes: pathView.axes
         maximum: path.maximumExtents
@@ -362,6 +381,7 @@ GLView3D {
 
         id: coordinates
         visible: pathView.coordinateVisible
+        cached: true
         axes: pathView.axes
         position: getPosition()
         textSize: 14 * pathView.sizeFactor
@@ -399,11 +419,13 @@ GLView3D {
         g5xOffset: status.synced ? status.motion.g5xOffset : {"x":0.12345, "y":0.234,"z":123.12,"a":324.3}
         g92Offset: status.synced ? status.motion.g92Offset : {"x":0.12345, "y":0.234,"z":123.12,"a":324.3}
         visible: pathView.offsetsVisible && (status.config.positionOffset === ApplicationStatus.RelativePositionOffset)
+        cached: true
     }
 
     Sphere3D {
         id: smallOrigin
         visible: pathView.offsetsVisible
+        cached: true
         radius: 2 * sizeFactor
         position: Qt.vector3d(0.0, 0.0, 0.0)
         color: pathView.colors["small_origin"]
@@ -412,6 +434,7 @@ GLView3D {
     Path3D {
         id: path
         visible: pathView.programVisible
+        cached: true
         position: coordinates.position
         arcFeedColor: pathView.colors["arc_feed"]
         straightFeedColor: pathView.colors["straight_feed"]
@@ -437,6 +460,7 @@ GLView3D {
 
         MouseArea {
             anchors.fill: parent
+            hoverEnabled: true
             onWheel: pathView.cameraZoom *= (1 + wheel.angleDelta.y/1200)
 
             property int lastY: 0
@@ -453,8 +477,10 @@ GLView3D {
             onClicked: pathView.readPixel(mouseX, mouseY)
 
             function move() {
-                if (!pressed)
+                if (!pressed) {
+                    pathView.hoverPixel(mouseX, mouseY)
                     return
+                }
 
                 var scaleFactor = camera.viewSize.height/pathView.height
                 var xOffset = lastX - Math.floor(mouseX)
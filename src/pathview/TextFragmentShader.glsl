@@ -1,20 +1,28 @@
-uniform lowp sampler2D texture;             // The input texture.
+uniform lowp sampler2D texture;             // The glyph atlas, a signed distance field
 
 varying lowp vec4 destinationColor;         // the output colors
 varying mediump vec2 destinationTexCoordinate; // the output texture coordinate
 
 // selection mode
-uniform lowp vec4 idColor;             // color to be used for selection mode
 uniform bool selectionMode;       // enables or disables the selection mode
 
+const mediump float smoothing = 0.08;   // width of the anti-aliased outline
+
 void main(void)
 {
+    mediump float distance = texture2D(texture, destinationTexCoordinate).a;
+
     if (!selectionMode)
     {
-        gl_FragColor = destinationColor * texture2D(texture, destinationTexCoordinate);
+        mediump float alpha = smoothstep(0.5 - smoothing, 0.5 + smoothing, distance);
+        gl_FragColor = vec4(destinationColor.rgb, destinationColor.a * alpha);
     }
     else
     {
-        gl_FragColor = idColor * texture2D(texture, destinationTexCoordinate);
+        if (distance < 0.5)
+        {
+            discard;    // ids must only be written inside of the glyphs
+        }
+        gl_FragColor = destinationColor;
     }
 }
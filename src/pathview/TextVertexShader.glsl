@@ -1,38 +1,38 @@
 // global
 uniform highp mat4 projectionMatrix;    // projection matrix
 uniform highp mat4 viewMatrix;          // view matrix
-
-// model specific
-uniform highp mat4 modelMatrix;         // model matrix
-uniform lowp vec4 color;               // per-vertex color
-uniform mediump float aspectRatio;        // aspect ratio
-uniform lowp int alignment;            // text alignment
+uniform highp vec2 textureScale;        // converts atlas pixels to texture coordinates
 
 // vertex specific
-attribute highp vec4 position;          // per-vertex position
-attribute mediump vec2 texCoordinate;     // per-vertex texture coordinate
+attribute highp vec4 position;          // per-vertex position, already in world space
+attribute highp vec2 texCoordinate;     // per-vertex position in the glyph atlas
+attribute lowp vec4 color;              // per-vertex color
+attribute highp float pickId;           // per-vertex selection id
+
+// selection mode
+uniform highp float idOffset;     // selection id of the first text
+uniform bool selectionMode;       // enables or disables the selection mode
 
 varying lowp vec4 destinationColor;         // the output colors
 varying mediump vec2 destinationTexCoordinate; // the output texture coordinate
 
 void main(void)
 {
-    mat4 modelviewMatrix = viewMatrix * modelMatrix;
-
-    destinationTexCoordinate = texCoordinate;
-    destinationColor = color;
-
-    vec4 scaledPosition = position;
-    scaledPosition[0] *= aspectRatio;
+    destinationTexCoordinate = texCoordinate * textureScale;
 
-    if (alignment == 1) // centered
+    if (selectionMode)
     {
-        scaledPosition[0] -= aspectRatio/2.0;
+        // encode the id as 24 bit RGB color
+        highp float id = idOffset + pickId;
+        destinationColor = vec4(mod(floor(id / 65536.0), 256.0) / 255.0,
+                                mod(floor(id / 256.0), 256.0) / 255.0,
+                                mod(id, 256.0) / 255.0,
+                                1.0);
     }
-    else if (alignment == 2) // left
+    else
     {
-        scaledPosition[0] -= aspectRatio;
+        destinationColor = color;
     }
 
-    gl_Position = projectionMatrix * modelviewMatrix * scaledPosition;
+    gl_Position = projectionMatrix * viewMatrix * position;
 }
@@ -1,5 +1,5 @@
 TEMPLATE = lib
-QT += qml quick network
+QT += qml quick network concurrent
 
 uri = Machinekit.PathView
 include(../plugin.pri)
@@ -12,6 +12,11 @@ include(../common/common.pri)
 SOURCES += \
     plugin.cpp \
     qglview.cpp \
+    qglglyphatlas.cpp \
+    qglscenebuffer.cpp \
+    qgllinepacker.cpp \
+    qglbufferuploader.cpp \
+    qglviewrenderer.cpp \
     qglitem.cpp \
     qglcubeitem.cpp \
     qglsphereitem.cpp \
@@ -19,28 +24,36 @@ SOURCES += \
     qglcamera.cpp \
     qgllight.cpp \
     qglpathitem.cpp \
+    qglpathscene.cpp \
     qglcanvas.cpp \
     qpreviewclient.cpp \
-    qgcodeprogramitem.cpp \
     qgcodeprogrammodel.cpp \
-    qgcodeprogramloader.cpp
+    qgcodeprogramloader.cpp \
+    qgcodesync.cpp
 
 HEADERS += \
     plugin.h \
     qglview.h \
+    qglviewrenderer.h \
     qglitem.h \
+    qgldrawablepool.h \
+    qglglyphatlas.h \
+    qglscenebuffer.h \
+    qgllinepacker.h \
+    qglbufferuploader.h \
     qglcubeitem.h \
     qglsphereitem.h \
     qglcylinderitem.h \
     qglcamera.h \
     qgllight.h \
     qglpathitem.h \
+    qglpathscene.h \
     qglcanvas.h \
     qpreviewclient.h \
     debughelper.h \
-    qgcodeprogramitem.h \
     qgcodeprogrammodel.h \
-    qgcodeprogramloader.h
+    qgcodeprogramloader.h \
+    qgcodesync.h
 
 RESOURCES += \
     shaders.qrc \
@@ -49,7 +62,6 @@ RESOURCES += \
 QML_FILES = \
     BoundingBox3D.qml \
     Coordinate3D.qml \
-    GCodeSync.qml \
     Grid3D.qml \
     PathView3D.qml \
     PathViewCore.qml \
@@ -72,6 +84,8 @@ OTHER_FILES += \
     LineVertexShader.glsl \
     LineFragmentShader.glsl \
     TextFragmentShader.glsl \
-    TextVertexShader.glsl
+    TextVertexShader.glsl \
+    ArcVertexShader.glsl \
+    ArcFragmentShader.glsl
 
 include(../deployment.pri)
@@ -32,6 +32,7 @@
 #include "qglcanvas.h"
 #include "qgcodeprogrammodel.h"
 #include "qgcodeprogramloader.h"
+#include "qgcodesync.h"
 
 static void initResources()
 {
@@ -44,7 +45,6 @@ static const struct {
 } qmldir [] = {
     { "BoundingBox3D", 1, 0 },
     { "Coordinate3D", 1, 0 },
-    { "GCodeSync", 1, 0 },
     { "Grid3D", 1, 0 },
     { "PathView3D", 1, 0 },
     { "PathViewCore", 1, 0 },
@@ -62,6 +62,8 @@ void MachinekitPathViewPlugin::registerTypes(const char *uri)
 {
     initResources();
 
+    qRegisterMetaType<QGLDrawableHandle>("QGLDrawableHandle");    // queued selection signal
+
     // @uri Machinekit.PathView
     qmlRegisterType<QGLCamera>(uri, 1, 0, "Camera3D");
     qmlRegisterType<QGLLight>(uri, 1, 0, "Light3D");
@@ -74,6 +76,7 @@ void MachinekitPathViewPlugin::registerTypes(const char *uri)
     qmlRegisterType<QPreviewClient>(uri, 1, 0, "PreviewClient");
     qmlRegisterType<QGCodeProgramModel>(uri, 1, 0, "GCodeProgramModel");
     qmlRegisterType<QGCodeProgramLoader>(uri, 1, 0, "GCodeProgramLoader");
+    qmlRegisterType<QGCodeSync>(uri, 1, 0, "GCodeSync");
 
     const QString filesLocation = fileLocation();
     for (int i = 0; i < int(sizeof(qmldir)/sizeof(qmldir[0])); i++) {
@@ -76,7 +76,7 @@ void QGCodeProgramLoader::load()
     while (!file.atEnd()) {
         QByteArray line = file.readLine();
         lineNumber++;
-        m_model->setData(remoteFilePath, lineNumber, QString(line), QGCodeProgramModel::GCodeRole);
+        m_model->setGcode(remoteFilePath, lineNumber, line);
     }
 
     m_model->endUpdate();
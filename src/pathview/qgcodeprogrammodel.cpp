@@ -23,14 +23,38 @@
 #include "qgcodeprogrammodel.h"
 #include <QDebug>
 
+static void insertBits(QBitArray *bits, int position, int count)
+{
+    int size = bits->size();
+
+    bits->resize(size + count);
+    for (int i = (size - 1); i >= position; --i)
+    {
+        bits->setBit(i + count, bits->testBit(i));
+    }
+    bits->fill(false, position, position + count);
+}
+
+static void removeBits(QBitArray *bits, int position, int count)
+{
+    int size = bits->size();
+
+    for (int i = (position + count); i < size; ++i)
+    {
+        bits->setBit(i - count, bits->testBit(i));
+    }
+    bits->resize(size - count);
+}
+
 QGCodeProgramModel::QGCodeProgramModel(QObject *parent) :
-    QAbstractListModel(parent)
+    QAbstractListModel(parent),
+    m_unusedTextSize(0),
+    m_previewsGrouped(false)
 {
 }
 
 QGCodeProgramModel::~QGCodeProgramModel()
 {
-    qDeleteAll(m_items);
 }
 
 QVariant QGCodeProgramModel::data(const QModelIndex &index, int role) const
@@ -45,21 +69,14 @@ bool QGCodeProgramModel::setData(const QModelIndex &index, const QVariant &value
 
 QModelIndex QGCodeProgramModel::index(const QString &fileName, int lineNumber) const
 {
-    FileIndex fileIndex;
+    int row = rowOf(fileName, lineNumber);
 
-    if (!m_fileIndices.contains(fileName))
+    if (row == -1)
     {
         return QModelIndex();
     }
 
-    fileIndex = m_fileIndices.value(fileName);
-
-    if (lineNumber > fileIndex.count)
-    {
-        return QModelIndex();
-    }
-
-    return createIndex(fileIndex.index + (lineNumber-1), 0);
+    return createIndex(row, 0);
 }
 
 QModelIndex QGCodeProgramModel::index(int row, int column, const QModelIndex &parent) const
@@ -84,7 +101,7 @@ Qt::ItemFlags QGCodeProgramModel::flags(const QModelIndex &index) const
 int QGCodeProgramModel::rowCount(const QModelIndex &parent) const
 {
     Q_UNUSED(parent)
-    return m_items.count();
+    return m_textSpans.size();
 }
 
 QHash<int, QByteArray> QGCodeProgramModel::roleNames() const
@@ -97,88 +114,191 @@ QHash<int, QByteArray> QGCodeProgramModel::roleNames() const
     roles[SelectedRole] = "selected";
     roles[ActiveRole] = "active";
     roles[ExecutedRole] = "executed";
+    roles[PreviewCountRole] = "previewCount";
     return roles;
 }
 
-void QGCodeProgramModel::prepareFile(const QString &fileName, int lineCount)
+QString QGCodeProgramModel::fileName(int row) const
 {
-    FileIndex fileIndex;
+    if ((row < 0) || (row >= m_textSpans.size()))
+    {
+        return QString();
+    }
 
-    if (m_fileIndices.contains(fileName))
+    return m_files.at(fileAt(row)).fileName;
+}
+
+int QGCodeProgramModel::lineNumber(int row) const
+{
+    if ((row < 0) || (row >= m_textSpans.size()))
     {
-        fileIndex = m_fileIndices.value(fileName);
+        return 0;
     }
-    else
+
+    return row - m_files.at(fileAt(row)).index + 1;
+}
+
+QString QGCodeProgramModel::gcode(int row) const
+{
+    if ((row < 0) || (row >= m_textSpans.size()))
     {
-        fileIndex.index = m_items.count();
-        fileIndex.count = 0;
+        return QString();
     }
 
-    int firstRow = fileIndex.index + fileIndex.count;
-    int lastRow = (fileIndex.index + lineCount - 1);
-    int rowCount = lastRow - firstRow + 1;
+    const TextSpan &span = m_textSpans.at(row);
+    return QString::fromUtf8(m_text.constData() + span.offset, span.length);
+}
+
+bool QGCodeProgramModel::isSelected(int row) const
+{
+    return (row >= 0) && (row < m_selected.size()) && m_selected.testBit(row);
+}
+
+bool QGCodeProgramModel::isActive(int row) const
+{
+    return (row >= 0) && (row < m_active.size()) && m_active.testBit(row);
+}
+
+bool QGCodeProgramModel::isExecuted(int row) const
+{
+    return (row >= 0) && (row < m_executed.size()) && m_executed.testBit(row);
+}
 
-    beginInsertRows(QModelIndex(), firstRow, lastRow);
-    for (int i = firstRow; i <= lastRow; ++i)
+int QGCodeProgramModel::previewCount(int row) const
+{
+    if ((row < 0) || (row >= m_textSpans.size()))
     {
-        m_items.insert(i, new QGCodeProgramItem(fileName, (i - fileIndex.index + 1)));
+        return 0;
     }
-    endInsertRows();
 
-    QHashIterator<QString, FileIndex> i(m_fileIndices);
-    while (i.hasNext()) {
-        i.next();
-        FileIndex currentFileIndex = i.value();
-        if (currentFileIndex.index > fileIndex.index)    // if file is after the changed file
-        {
-            currentFileIndex.index += rowCount;
-            m_fileIndices.insert(i.key(), currentFileIndex);
-        }
+    groupPreviews();
+    return m_previewOffsets.at(row + 1) - m_previewOffsets.at(row);
+}
+
+QList<pb::Preview> QGCodeProgramModel::previews(int row) const
+{
+    if ((row < 0) || (row >= m_textSpans.size()))
+    {
+        return QList<pb::Preview>();
     }
 
-    fileIndex.count = lineCount;
-    m_fileIndices.insert(fileName, fileIndex);
+    groupPreviews();
+    return m_previews.mid(m_previewOffsets.at(row), m_previewOffsets.at(row + 1) - m_previewOffsets.at(row));
 }
 
-void QGCodeProgramModel::removeFile(const QString &fileName)
+QGCodeProgramModel::PreviewTable QGCodeProgramModel::previewTable() const
 {
-    FileIndex fileIndex;
+    PreviewTable previewTable;
 
-    if (!m_fileIndices.contains(fileName))
+    groupPreviews();
+    previewTable.previews = m_previews;
+    previewTable.rowOffsets = m_previewOffsets;
+
+    return previewTable;
+}
+
+bool QGCodeProgramModel::setGcode(const QString &fileName, int lineNumber, const QByteArray &code)
+{
+    int row = rowOf(fileName, lineNumber);
+
+    if (row == -1)
+    {
+        return false;
+    }
+
+    setRowCode(row, code);
+
+    QVector<int> changedRoles;
+    changedRoles.append(GCodeRole);
+    emit dataChanged(createIndex(row, 0), createIndex(row, 0), changedRoles);
+
+    return true;
+}
+
+bool QGCodeProgramModel::appendPreview(const QString &fileName, int lineNumber, const pb::Preview &preview)
+{
+    int row = rowOf(fileName, lineNumber);
+
+    if (row == -1)
+    {
+        return false;
+    }
+
+    m_previews.append(preview);
+    m_previewRows.append(row);
+    m_previewsGrouped = false;
+
+    QVector<int> changedRoles;
+    changedRoles.append(PreviewRole);
+    emit dataChanged(createIndex(row, 0), createIndex(row, 0), changedRoles);
+
+    return true;
+}
+
+void QGCodeProgramModel::prepareFile(const QString &fileName, int lineCount)
+{
+    int position;
+    int firstRow;
+    int rowCount;
+
+    if (m_fileIndices.contains(fileName))
+    {
+        position = m_fileIndices.value(fileName);
+    }
+    else
+    {
+        FileIndex fileIndex;
+        fileIndex.fileName = fileName;
+        fileIndex.index = m_textSpans.size();
+        fileIndex.count = 0;
+        position = m_files.size();
+        m_files.append(fileIndex);
+        m_fileIndices.insert(fileName, position);
+    }
+
+    firstRow = m_files.at(position).index + m_files.at(position).count;
+    rowCount = lineCount - m_files.at(position).count;
+    if (rowCount <= 0)
     {
         return;
     }
 
-    fileIndex = m_fileIndices.value(fileName);
+    beginInsertRows(QModelIndex(), firstRow, firstRow + rowCount - 1);
+    insertFileRows(position, firstRow, rowCount);
+    endInsertRows();
+}
 
-    int firstRow = fileIndex.index;
-    int lastRow = fileIndex.index + fileIndex.count - 1;
-    int rowCount = lastRow - firstRow + 1;
+void QGCodeProgramModel::removeFile(const QString &fileName)
+{
+    int position;
+    int firstRow;
+    int lastRow;
 
-    beginRemoveRows(QModelIndex(), firstRow, lastRow);
-    for (int i = lastRow; i >= firstRow; i--)
+    if (!m_fileIndices.contains(fileName))
     {
-        delete m_items.takeAt(i);
+        return;
     }
-    endRemoveRows();
 
-    QHashIterator<QString, FileIndex> i(m_fileIndices);
-    while (i.hasNext()) {
-        i.next();
-        FileIndex currentFileIndex = i.value();
-        if (currentFileIndex.index > fileIndex.index)    // if file is after the changed file
-        {
-            currentFileIndex.index -= rowCount;
-            m_fileIndices.insert(i.key(), currentFileIndex);
-        }
+    position = m_fileIndices.value(fileName);
+    firstRow = m_files.at(position).index;
+    lastRow = firstRow + m_files.at(position).count - 1;
+
+    if (lastRow < firstRow)
+    {
+        m_files.remove(position);
+        updateFileIndices();
+        return;
     }
 
-    m_fileIndices.remove(fileName);
+    beginRemoveRows(QModelIndex(), firstRow, lastRow);
+    removeFileRows(position);
+    endRemoveRows();
 }
 
 void QGCodeProgramModel::addLine(const QString &fileName)
 {
-    FileIndex fileIndex;
+    int position;
+    int row;
 
     if (!m_fileIndices.contains(fileName))
     {
@@ -186,27 +306,12 @@ void QGCodeProgramModel::addLine(const QString &fileName)
         return;
     }
 
-    fileIndex = m_fileIndices.value(fileName);
-    fileIndex.count++;
-
-    int row = fileIndex.index + fileIndex.count - 1;
+    position = m_fileIndices.value(fileName);
+    row = m_files.at(position).index + m_files.at(position).count;
 
     beginInsertRows(QModelIndex(), row, row);
-    m_items.insert(row, new QGCodeProgramItem(fileName, fileIndex.count));
+    insertFileRows(position, row, 1);
     endInsertRows();
-
-    QHashIterator<QString, FileIndex> i(m_fileIndices);
-    while (i.hasNext()) {
-        i.next();
-        FileIndex currentFileIndex = i.value();
-        if (currentFileIndex.index > fileIndex.index)    // if file is after the changed file
-        {
-            currentFileIndex.index++;
-            m_fileIndices.insert(i.key(), currentFileIndex);
-        }
-    }
-
-    m_fileIndices.insert(fileName, fileIndex);
 }
 
 QVariant QGCodeProgramModel::data(const QString &fileName, int lineNumber, int role) const
@@ -225,19 +330,73 @@ bool QGCodeProgramModel::setData(const QString &fileName, int lineNumber, const
     return internalSetData(modelIndex, value, role);
 }
 
+bool QGCodeProgramModel::setRangeData(const QString &fileName, int firstLineNumber, int lastLineNumber, const QVariant &value, int role)
+{
+    FileIndex fileIndex;
+    int firstRow;
+    int lastRow;
+
+    if (!m_fileIndices.contains(fileName))
+    {
+        return false;
+    }
+
+    fileIndex = m_files.at(m_fileIndices.value(fileName));
+    firstLineNumber = qMax(firstLineNumber, 1);
+    lastLineNumber = qMin(lastLineNumber, fileIndex.count);
+    if (firstLineNumber > lastLineNumber)
+    {
+        return false;
+    }
+
+    firstRow = fileIndex.index + (firstLineNumber - 1);
+    lastRow = fileIndex.index + (lastLineNumber - 1);
+    if ((role == SelectedRole) || (role == ActiveRole) || (role == ExecutedRole))
+    {
+        QBitArray *bits = (role == SelectedRole) ? &m_selected : ((role == ActiveRole) ? &m_active : &m_executed);
+        bits->fill(value.toBool(), firstRow, lastRow + 1);
+    }
+    else
+    {
+        for (int row = firstRow; row <= lastRow; ++row)
+        {
+            if (!setRowData(row, value, role))
+            {
+                return false;
+            }
+        }
+    }
+
+    QVector<int> changedRoles;
+    changedRoles.append(role);
+    emit dataChanged(createIndex(firstRow, 0), createIndex(lastRow, 0), changedRoles);
+
+    return true;
+}
+
 void QGCodeProgramModel::clear()
 {
-    if (m_items.count() == 0)
+    if (m_textSpans.isEmpty())
     {
+        m_files.clear();
+        m_fileIndices.clear();
         return;
     }
 
-    beginRemoveRows(QModelIndex(), 0, (m_items.count()-1));
-    qDeleteAll(m_items);
-    m_items.clear();
-    endRemoveRows();
-
+    beginRemoveRows(QModelIndex(), 0, (m_textSpans.size() - 1));
+    m_files.clear();
     m_fileIndices.clear();
+    m_text.clear();
+    m_textSpans.clear();
+    m_unusedTextSize = 0;
+    m_selected.clear();
+    m_active.clear();
+    m_executed.clear();
+    m_previews.clear();
+    m_previewRows.clear();
+    m_previewOffsets.clear();
+    m_previewsGrouped = false;
+    endRemoveRows();
 }
 
 void QGCodeProgramModel::beginUpdate()
@@ -250,31 +409,271 @@ void QGCodeProgramModel::endUpdate()
     endResetModel();
 }
 
+int QGCodeProgramModel::fileAt(int row) const
+{
+    int low = 0;
+    int high = m_files.size() - 1;
+
+    // last file starting at or before the row
+    while (low < high)
+    {
+        int middle = (low + high + 1) / 2;
+        if (m_files.at(middle).index <= row)
+        {
+            low = middle;
+        }
+        else
+        {
+            high = middle - 1;
+        }
+    }
+
+    return low;
+}
+
+int QGCodeProgramModel::rowOf(const QString &fileName, int lineNumber) const
+{
+    QHash<QString, int>::const_iterator it = m_fileIndices.constFind(fileName);
+
+    if (it == m_fileIndices.constEnd())
+    {
+        return -1;
+    }
+
+    const FileIndex &fileIndex = m_files.at(it.value());
+    if ((lineNumber < 1) || (lineNumber > fileIndex.count))
+    {
+        return -1;
+    }
+
+    return fileIndex.index + (lineNumber - 1);
+}
+
+void QGCodeProgramModel::insertFileRows(int fileIndex, int row, int count)
+{
+    TextSpan emptySpan;
+
+    emptySpan.offset = 0;
+    emptySpan.length = 0;
+    m_textSpans.insert(row, count, emptySpan);
+    insertBits(&m_selected, row, count);
+    insertBits(&m_active, row, count);
+    insertBits(&m_executed, row, count);
+
+    for (int i = 0; i < m_previewRows.size(); ++i)
+    {
+        if (m_previewRows.at(i) >= row)
+        {
+            m_previewRows[i] += count;
+        }
+    }
+    m_previewsGrouped = false;
+
+    m_files[fileIndex].count += count;
+    for (int i = (fileIndex + 1); i < m_files.size(); ++i)
+    {
+        m_files[i].index += count;
+    }
+}
+
+void QGCodeProgramModel::removeFileRows(int fileIndex)
+{
+    int firstRow = m_files.at(fileIndex).index;
+    int count = m_files.at(fileIndex).count;
+    int endRow = firstRow + count;
+    int keptPreviews = 0;
+
+    for (int row = firstRow; row < endRow; ++row)
+    {
+        m_unusedTextSize += m_textSpans.at(row).length;
+    }
+    m_textSpans.remove(firstRow, count);
+    removeBits(&m_selected, firstRow, count);
+    removeBits(&m_active, firstRow, count);
+    removeBits(&m_executed, firstRow, count);
+
+    // the previews of the file are dropped, the ones of the following rows move up
+    for (int i = 0; i < m_previews.size(); ++i)
+    {
+        int row = m_previewRows.at(i);
+
+        if (row >= endRow)
+        {
+            row -= count;
+        }
+        else if (row >= firstRow)
+        {
+            continue;
+        }
+
+        if (keptPreviews != i)
+        {
+            m_previews[keptPreviews].Swap(&m_previews[i]);
+        }
+        m_previewRows[keptPreviews] = row;
+        keptPreviews++;
+    }
+    m_previews.erase(m_previews.begin() + keptPreviews, m_previews.end());
+    m_previewRows.resize(keptPreviews);
+    m_previewsGrouped = false;
+
+    m_files.remove(fileIndex);
+    for (int i = fileIndex; i < m_files.size(); ++i)
+    {
+        m_files[i].index -= count;
+    }
+    updateFileIndices();
+
+    if (m_unusedTextSize > (m_text.size() / 2))
+    {
+        compactText();
+    }
+}
+
+void QGCodeProgramModel::updateFileIndices()
+{
+    m_fileIndices.clear();
+    for (int i = 0; i < m_files.size(); ++i)
+    {
+        m_fileIndices.insert(m_files.at(i).fileName, i);
+    }
+}
+
+void QGCodeProgramModel::setRowCode(int row, const QByteArray &code)
+{
+    TextSpan &span = m_textSpans[row];
+
+    // the code is appended, replaced code is reclaimed once it makes up half of the text
+    m_unusedTextSize += span.length;
+    span.offset = m_text.size();
+    span.length = code.size();
+    m_text.append(code);
+
+    if (m_unusedTextSize > (m_text.size() / 2))
+    {
+        compactText();
+    }
+}
+
+void QGCodeProgramModel::compactText()
+{
+    QByteArray text;
+
+    text.reserve(m_text.size() - m_unusedTextSize);
+    for (int i = 0; i < m_textSpans.size(); ++i)
+    {
+        TextSpan &span = m_textSpans[i];
+        int offset = text.size();
+
+        text.append(m_text.constData() + span.offset, span.length);
+        span.offset = offset;
+    }
+    m_text = text;
+    m_unusedTextSize = 0;
+}
+
+void QGCodeProgramModel::groupPreviews() const
+{
+    bool ordered = true;
+
+    if (m_previewsGrouped)
+    {
+        return;
+    }
+
+    m_previewOffsets.fill(0, m_textSpans.size() + 1);
+    for (int i = 0; i < m_previewRows.size(); ++i)
+    {
+        m_previewOffsets[m_previewRows.at(i) + 1]++;
+        if ((i > 0) && (m_previewRows.at(i) < m_previewRows.at(i - 1)))
+        {
+            ordered = false;
+        }
+    }
+    for (int i = 0; i < m_textSpans.size(); ++i)
+    {
+        m_previewOffsets[i + 1] += m_previewOffsets.at(i);
+    }
+
+    // the records usually arrive in row order, otherwise a stable counting sort groups them
+    if (!ordered)
+    {
+        QVector<int> positions = m_previewOffsets;
+        QList<pb::Preview> previews;
+        QVector<int> rows(m_previewRows.size());
+
+        previews.reserve(m_previews.size());
+        for (int i = 0; i < m_previews.size(); ++i)
+        {
+            previews.append(pb::Preview());
+        }
+        for (int i = 0; i < m_previews.size(); ++i)
+        {
+            int position = positions[m_previewRows.at(i)]++;
+            previews[position].Swap(&m_previews[i]);
+            rows[position] = m_previewRows.at(i);
+        }
+        m_previews = previews;
+        m_previewRows = rows;
+    }
+
+    m_previewsGrouped = true;
+}
+
+void QGCodeProgramModel::setRowPreviews(int row, const QList<pb::Preview> &previews)
+{
+    int keptPreviews = 0;
+
+    // the previous records of the row are dropped, the new ones are appended
+    for (int i = 0; i < m_previews.size(); ++i)
+    {
+        if (m_previewRows.at(i) == row)
+        {
+            continue;
+        }
+
+        if (keptPreviews != i)
+        {
+            m_previews[keptPreviews].Swap(&m_previews[i]);
+            m_previewRows[keptPreviews] = m_previewRows.at(i);
+        }
+        keptPreviews++;
+    }
+    m_previews.erase(m_previews.begin() + keptPreviews, m_previews.end());
+    m_previewRows.resize(keptPreviews);
+
+    m_previews.append(previews);
+    m_previewRows.insert(m_previewRows.size(), previews.size(), row);
+    m_previewsGrouped = false;
+}
+
 QVariant QGCodeProgramModel::internalData(const QModelIndex &index, int role) const
 {
-    if (!index.isValid() || (index.row() > (m_items.count() - 1)))
+    int row = index.row();
+
+    if (!index.isValid() || (row > (m_textSpans.size() - 1)))
     {
         return QVariant();
     }
 
-    QGCodeProgramItem *item = m_items.at(index.row());
-
     switch (role)
     {
     case LineNumberRole:
-        return QVariant(item->lineNumber());
+        return QVariant(lineNumber(row));
     case FileNameRole:
-        return QVariant(item->fileName());
+        return QVariant(fileName(row));
     case GCodeRole:
-        return QVariant(item->gcode());
+        return QVariant(gcode(row));
     case PreviewRole:
-        return QVariant::fromValue(static_cast<void*>(item->previewList()));
+        return QVariant::fromValue(previews(row));
+    case PreviewCountRole:
+        return QVariant(previewCount(row));
     case SelectedRole:
-        return QVariant(item->selected());
+        return QVariant(isSelected(row));
     case ActiveRole:
-        return QVariant(item->active());
+        return QVariant(isActive(row));
     case ExecutedRole:
-        return QVariant(item->executed());
+        return QVariant(isExecuted(row));
     default:
         return QVariant();
     }
@@ -284,44 +683,50 @@ QVariant QGCodeProgramModel::internalData(const QModelIndex &index, int role) co
 
 bool QGCodeProgramModel::internalSetData(const QModelIndex &index, const QVariant &value, int role)
 {
-    if (!index.isValid())
+    if (!index.isValid() || (index.row() > (m_textSpans.size() - 1)))
     {
         return false;
     }
 
-    QGCodeProgramItem *item = m_items.at(index.row());
+    if (!setRowData(index.row(), value, role))
+    {
+        return false;
+    }
 
+    QVector<int> changedRoles;
+    changedRoles.append(role);
+    emit dataChanged(index, index, changedRoles);
 
+    return true;
+}
+
+bool QGCodeProgramModel::setRowData(int row, const QVariant &value, int role)
+{
+    // file name and line number follow from the file table
     switch (role)
     {
-    case LineNumberRole:
-        item->setLineNumber(value.toInt());
-        break;
-    case FileNameRole:
-        item->setFileName(value.toString());
-        break;
     case GCodeRole:
-        item->setGcode(value.toString());
+        setRowCode(row, value.toString().toUtf8());
         break;
     case PreviewRole:
-        item->setPreviewList(static_cast<QList<pb::Preview>* >(value.value<void*>()));
+        if (!value.canConvert<QList<pb::Preview> >())
+        {
+            return false;
+        }
+        setRowPreviews(row, value.value<QList<pb::Preview> >());
         break;
     case SelectedRole:
-        item->setSelected(value.toBool());
+        m_selected.setBit(row, value.toBool());
         break;
     case ActiveRole:
-        item->setActive(value.toBool());
+        m_active.setBit(row, value.toBool());
         break;
     case ExecutedRole:
-        item->setExecuted(value.toBool());
+        m_executed.setBit(row, value.toBool());
         break;
     default:
         return false;
     }
 
-    QVector<int> changedRoles;
-    changedRoles.append(role);
-    emit dataChanged(index, index, changedRoles);
-
     return true;
 }
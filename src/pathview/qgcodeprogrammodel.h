@@ -24,14 +24,23 @@
 #define QGCODEPROGRAMMODEL_H
 
 #include <QAbstractListModel>
-#include "qgcodeprogramitem.h"
+#include <QBitArray>
+#include <QByteArray>
+#include <QHash>
+#include <QList>
+#include <QVector>
+#include "preview.pb.h"
 
+// the lines of all files are stored column wise, a line costs its code and a few bytes
 class QGCodeProgramModel : public QAbstractListModel
 {
     Q_OBJECT
     Q_ENUMS(GCodeProgramRoles)
 
 public:
+    // FileNameRole and LineNumberRole are read only, they follow from the file of the row.
+    // PreviewRole holds a QList<pb::Preview> value, a copy of the records of the row,
+    // setting it replaces them. Earlier versions stored a pointer to a list owned by the caller.
     enum GCodeProgramRoles {
             FileNameRole = Qt::UserRole,
             LineNumberRole,
@@ -39,9 +48,16 @@ public:
             PreviewRole,
             SelectedRole,
             ActiveRole,
-            ExecutedRole
+            ExecutedRole,
+            PreviewCountRole    // number of preview records of the row
         };
 
+    // preview records of all rows, implicitly shared, a copy is not affected by later changes
+    typedef struct {
+        QList<pb::Preview> previews;    // grouped by row, in arrival order within a row
+        QVector<int> rowOffsets;        // first preview of each row and the end of the last row
+    } PreviewTable;
+
     explicit QGCodeProgramModel(QObject *parent = 0);
     ~QGCodeProgramModel();
 
@@ -53,27 +69,74 @@ public:
     int rowCount(const QModelIndex &parent = QModelIndex()) const;
     QHash<int, QByteArray> roleNames() const;
 
+    // typed access for C++ users, rows outside of the model return defaults
+    QString fileName(int row) const;
+    int lineNumber(int row) const;
+    QString gcode(int row) const;
+    bool isSelected(int row) const;
+    bool isActive(int row) const;
+    bool isExecuted(int row) const;
+    int previewCount(int row) const;
+    QList<pb::Preview> previews(int row) const;
+    PreviewTable previewTable() const;
+
+    bool setGcode(const QString &fileName, int lineNumber, const QByteArray &code);  // UTF-8
+    bool appendPreview(const QString &fileName, int lineNumber, const pb::Preview &preview);
+
 public slots:
     void prepareFile(const QString &fileName, int lineCount);
     void removeFile(const QString &fileName);
     void addLine(const QString &fileName);
     QVariant data(const QString &fileName, int lineNumber, int role) const;
     bool setData(const QString &fileName, int lineNumber, const QVariant &value, int role);
+    // sets the lines [firstLineNumber, lastLineNumber] of the file with a single dataChanged
+    bool setRangeData(const QString &fileName, int firstLineNumber, int lastLineNumber, const QVariant &value, int role);
     void clear();
     void beginUpdate();
     void endUpdate();
 
 private:
+    // interned file table, the rows of a file are consecutive and the files are ordered by row
     typedef struct {
-        int index;
+        QString fileName;
+        int index;      // first row
         int count;
     } FileIndex;
 
-    QList<QGCodeProgramItem*> m_items;
-    QHash<QString, FileIndex> m_fileIndices;
+    typedef struct {
+        int offset;     // into m_text
+        int length;
+    } TextSpan;
+
+    QVector<FileIndex> m_files;
+    QHash<QString, int> m_fileIndices;  // position of each file in m_files
+    QByteArray m_text;                  // code of all rows, UTF-8
+    QVector<TextSpan> m_textSpans;      // code of each row, the size is the row count
+    int m_unusedTextSize;               // bytes of replaced code still in m_text
+    QBitArray m_selected;
+    QBitArray m_active;
+    QBitArray m_executed;
 
+    // previews are appended in arrival order and grouped by row on first read
+    mutable QList<pb::Preview> m_previews;
+    mutable QVector<int> m_previewRows;     // row of each preview
+    mutable QVector<int> m_previewOffsets;  // valid if m_previewsGrouped
+    mutable bool m_previewsGrouped;
+
+    int fileAt(int row) const;
+    int rowOf(const QString &fileName, int lineNumber) const;
+    void insertFileRows(int fileIndex, int row, int count);
+    void removeFileRows(int fileIndex);
+    void updateFileIndices();
+    void setRowCode(int row, const QByteArray &code);
+    void compactText();
+    void groupPreviews() const;
+    void setRowPreviews(int row, const QList<pb::Preview> &previews);
     QVariant internalData(const QModelIndex &index, int role) const;
     bool internalSetData(const QModelIndex &index, const QVariant &value, int role);
+    bool setRowData(int row, const QVariant &value, int role);
 };
 
+Q_DECLARE_METATYPE(pb::Preview)
+
 #endif // QGCODEPROGRAMMODEL_H
@@ -0,0 +1,188 @@
+/****************************************************************************
+**
+** Copyright (C) 2014 Alexander Rössler
+** License: LGPL version 2.1
+**
+** This file is part of QtQuickVcp.
+**
+** All rights reserved. This program and the accompanying materials
+** are made available under the terms of the GNU Lesser General Public License
+** (LGPL) version 2.1 which accompanies this distribution, and is available at
+** http://www.gnu.org/licenses/lgpl-2.1.html
+**
+** This library is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+** Lesser General Public License for more details.
+**
+** Contributors:
+** Alexander Rössler @ The Cool Tool GmbH <mail DOT aroessler AT gmail DOT com>
+**
+****************************************************************************/
+#include "qgcodesync.h"
+#include <QJsonObject>
+
+QGCodeSync::QGCodeSync(QObject *parent) :
+    QObject(parent),
+    m_status(NULL),
+    m_model(NULL),
+    m_lastLine(1)
+{
+}
+
+void QGCodeSync::setStatus(QObject *arg)
+{
+    if (m_status == arg)
+    {
+        return;
+    }
+
+    if (m_status != NULL)
+    {
+        disconnect(m_status, 0, this, 0);
+    }
+
+    m_status = arg;
+    if (m_status != NULL)
+    {
+        connect(m_status, SIGNAL(motionChanged(QJsonObject)),
+                this, SLOT(updateLine()));
+        connect(m_status, SIGNAL(taskChanged(QJsonObject)),
+                this, SLOT(updateLine()));
+        connect(m_status, SIGNAL(syncedChanged(bool)),
+                this, SLOT(updateLine()));
+        connect(m_status, SIGNAL(destroyed()),
+                this, SLOT(statusDestroyed()));
+    }
+    emit statusChanged(arg);
+
+    updateLine();
+}
+
+void QGCodeSync::setModel(QGCodeProgramModel *arg)
+{
+    if (m_model == arg)
+    {
+        return;
+    }
+
+    if (m_model != NULL)
+    {
+        disconnect(m_model, 0, this, 0);
+    }
+
+    m_model = arg;
+    if (m_model != NULL)
+    {
+        connect(m_model, SIGNAL(modelReset()),
+                this, SLOT(resetLines()));
+        connect(m_model, SIGNAL(rowsRemoved(QModelIndex,int,int)),
+                this, SLOT(resetLines()));
+        connect(m_model, SIGNAL(destroyed()),
+                this, SLOT(modelDestroyed()));
+    }
+    emit modelChanged(arg);
+
+    resetLines();
+}
+
+void QGCodeSync::updateLine()
+{
+    QString fileName;
+    int currentLine;
+
+    if ((m_status == NULL) || (m_model == NULL) || !m_status->property("synced").toBool())
+    {
+        return;
+    }
+
+    fileName = m_status->property("task").toJsonObject().value("file").toString();
+    currentLine = m_status->property("motion").toJsonObject().value("motionLine").toInt();
+
+    if (fileName != m_fileName)
+    {
+        clearLines();
+        m_fileName = fileName;
+    }
+
+    // a rewind starts a new run, nothing of the previous run stays executed
+    if (currentLine < m_lastLine)
+    {
+        clearLines();
+    }
+    else
+    {
+        setLines(&m_executedLines, m_lastLine, currentLine - 1, true, QGCodeProgramModel::ExecutedRole);
+        setLines(&m_activeLines, m_lastLine, currentLine - 1, false, QGCodeProgramModel::ActiveRole);
+    }
+    setLines(&m_activeLines, currentLine, currentLine, true, QGCodeProgramModel::ActiveRole);
+
+    m_lastLine = currentLine;
+}
+
+void QGCodeSync::setLines(QBitArray *lines, int first, int last, bool value, int role)
+{
+    int runFirst = -1;
+
+    first = qMax(first, 1);
+    if (last >= lines->size())
+    {
+        if (value)
+        {
+            lines->resize(last + 1);
+        }
+        else
+        {
+            last = lines->size() - 1;   // the lines outside are not set anyway
+        }
+    }
+
+    // only runs of lines with a different state are written, each run is one dataChanged of the model
+    for (int line = first; line <= (last + 1); ++line)
+    {
+        bool differs = (line <= last) && (lines->testBit(line) != value);
+
+        if (differs && (runFirst == -1))
+        {
+            runFirst = line;
+        }
+        else if (!differs && (runFirst != -1))
+        {
+            lines->fill(value, runFirst, line);
+            m_model->setRangeData(m_fileName, runFirst, line - 1, value, role);
+            runFirst = -1;
+        }
+    }
+}
+
+void QGCodeSync::clearLines()
+{
+    setLines(&m_executedLines, 1, m_executedLines.size() - 1, false, QGCodeProgramModel::ExecutedRole);
+    setLines(&m_activeLines, 1, m_activeLines.size() - 1, false, QGCodeProgramModel::ActiveRole);
+    m_lastLine = 1;
+}
+
+void QGCodeSync::resetLines()
+{
+    // the rows of the model were replaced, their state is applied again from the current status
+    m_executedLines.clear();
+    m_activeLines.clear();
+    m_fileName.clear();
+    m_lastLine = 1;
+
+    updateLine();
+}
+
+void QGCodeSync::statusDestroyed()
+{
+    m_status = NULL;
+    emit statusChanged(m_status);
+}
+
+void QGCodeSync::modelDestroyed()
+{
+    m_model = NULL;
+    m_executedLines.clear();
+    m_activeLines.clear();
+    emit modelChanged(m_model);
+}
@@ -0,0 +1,77 @@
+/****************************************************************************
+**
+** Copyright (C) 2014 Alexander Rössler
+** License: LGPL version 2.1
+**
+** This file is part of QtQuickVcp.
+**
+** All rights reserved. This program and the accompanying materials
+** are made available under the terms of the GNU Lesser General Public License
+** (LGPL) version 2.1 which accompanies this distribution, and is available at
+** http://www.gnu.org/licenses/lgpl-2.1.html
+**
+** This library is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+** Lesser General Public License for more details.
+**
+** Contributors:
+** Alexander Rössler @ The Cool Tool GmbH <mail DOT aroessler AT gmail DOT com>
+**
+****************************************************************************/
+#ifndef QGCODESYNC_H
+#define QGCODESYNC_H
+
+#include <QObject>
+#include <QBitArray>
+#include "qgcodeprogrammodel.h"
+
+// mirrors the executed and active lines of the machine status into the program model,
+// the status is an ApplicationStatus, it is accessed through its properties so the
+// path view does not depend on the application module
+class QGCodeSync : public QObject
+{
+    Q_OBJECT
+    Q_PROPERTY(QObject *status READ status WRITE setStatus NOTIFY statusChanged)
+    Q_PROPERTY(QGCodeProgramModel *model READ model WRITE setModel NOTIFY modelChanged)
+
+public:
+    explicit QGCodeSync(QObject *parent = 0);
+
+    QObject *status() const
+    {
+        return m_status;
+    }
+
+    QGCodeProgramModel *model() const
+    {
+        return m_model;
+    }
+
+public slots:
+    void setStatus(QObject *arg);
+    void setModel(QGCodeProgramModel *arg);
+
+signals:
+    void statusChanged(QObject *arg);
+    void modelChanged(QGCodeProgramModel *arg);
+
+private:
+    QObject *m_status;
+    QGCodeProgramModel *m_model;
+    QString m_fileName;         // file the lines belong to
+    int m_lastLine;             // current line of the previous update
+    QBitArray m_executedLines;  // bit n is line n
+    QBitArray m_activeLines;
+
+    void setLines(QBitArray *lines, int first, int last, bool value, int role);
+    void clearLines();
+
+private slots:
+    void updateLine();
+    void resetLines();
+    void statusDestroyed();
+    void modelDestroyed();
+};
+
+#endif // QGCODESYNC_H
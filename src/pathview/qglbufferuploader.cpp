@@ -0,0 +1,132 @@
+/****************************************************************************
+**
+** Copyright (C) 2014 Alexander Rössler
+** License: LGPL version 2.1
+**
+** This file is part of QtQuickVcp.
+**
+** All rights reserved. This program and the accompanying materials
+** are made available under the terms of the GNU Lesser General Public License
+** (LGPL) version 2.1 which accompanies this distribution, and is available at
+** http://www.gnu.org/licenses/lgpl-2.1.html
+**
+** This library is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+** Lesser General Public License for more details.
+**
+** Contributors:
+** Alexander Rössler @ The Cool Tool GmbH <mail DOT aroessler AT gmail DOT com>
+**
+****************************************************************************/
+
+#include "qglbufferuploader.h"
+#include <QOpenGLFunctions>
+
+static const int UploadChunkSize = 1024 * 1024;    // bytes written at once, keeps the driver from stalling
+static const GLenum SyncGpuCommandsComplete = 0x9117;
+static const GLbitfield SyncFlushCommandsBit = 0x00000001;
+static const quint64 TimeoutIgnored = Q_UINT64_C(0xFFFFFFFFFFFFFFFF);
+
+QGLBufferUploader::QGLBufferUploader(QOpenGLContext *shareContext, QOffscreenSurface *surface) :
+    QObject(),
+    m_context(new QOpenGLContext(this)),
+    m_surface(surface),
+    m_functionsResolved(false),
+    m_fenceSync(NULL),
+    m_clientWaitSync(NULL),
+    m_deleteSync(NULL)
+{
+    m_context->setFormat(shareContext->format());
+    m_context->setShareContext(shareContext);
+    m_context->create();
+}
+
+bool QGLBufferUploader::isValid() const
+{
+    return m_context->isValid() && m_context->shareContext() != NULL;
+}
+
+void QGLBufferUploader::start(QGLBufferUploader::Job *job)
+{
+    QMetaObject::invokeMethod(this, "processJob", Qt::QueuedConnection, Q_ARG(void*, job));
+}
+
+void QGLBufferUploader::processJob(void *job)
+{
+    Job *uploadJob = static_cast<Job*>(job);
+
+    if (!m_context->makeCurrent(m_surface))
+    {
+        uploadJob->state.storeRelease(Failed);
+        emit jobFinished();
+        return;
+    }
+
+    if (!m_functionsResolved)
+    {
+        resolveFunctions();
+    }
+
+    for (int i = 0; i < uploadJob->uploads.size(); ++i)
+    {
+        const Upload &upload = uploadJob->uploads.at(i);
+        const char *data = static_cast<const char*>(upload.data);
+
+        upload.buffer->bind();
+        upload.buffer->allocate(upload.size);
+        for (int offset = 0; offset < upload.size; offset += UploadChunkSize)
+        {
+            upload.buffer->write(offset, data + offset, qMin(UploadChunkSize, upload.size - offset));
+            m_context->functions()->glFlush();
+        }
+        upload.buffer->release();
+    }
+
+    // the buffers may only be used by the render context once the GPU has consumed the data
+    if (m_fenceSync != NULL)
+    {
+        SyncObject fence = m_fenceSync(SyncGpuCommandsComplete, 0);
+        m_clientWaitSync(fence, SyncFlushCommandsBit, TimeoutIgnored);
+        m_deleteSync(fence);
+    }
+    else
+    {
+        m_context->functions()->glFinish();
+    }
+
+    m_context->doneCurrent();
+    uploadJob->state.storeRelease(Finished);
+    emit jobFinished();
+}
+
+void QGLBufferUploader::resolveFunctions()
+{
+    QSurfaceFormat format = m_context->format();
+
+    // sync objects are core in OpenGL 3.2 and OpenGL ES 3.0
+    if (((format.renderableType() == QSurfaceFormat::OpenGLES) && (format.majorVersion() >= 3))
+        || (format.majorVersion() > 3)
+        || ((format.majorVersion() == 3) && (format.minorVersion() >= 2))
+        || m_context->hasExtension("GL_ARB_sync"))
+    {
+        m_fenceSync = reinterpret_cast<FenceSyncFunction>(m_context->getProcAddress("glFenceSync"));
+        m_clientWaitSync = reinterpret_cast<ClientWaitSyncFunction>(m_context->getProcAddress("glClientWaitSync"));
+        m_deleteSync = reinterpret_cast<DeleteSyncFunction>(m_context->getProcAddress("glDeleteSync"));
+    }
+    else if (m_context->hasExtension("GL_APPLE_sync"))
+    {
+        m_fenceSync = reinterpret_cast<FenceSyncFunction>(m_context->getProcAddress("glFenceSyncAPPLE"));
+        m_clientWaitSync = reinterpret_cast<ClientWaitSyncFunction>(m_context->getProcAddress("glClientWaitSyncAPPLE"));
+        m_deleteSync = reinterpret_cast<DeleteSyncFunction>(m_context->getProcAddress("glDeleteSyncAPPLE"));
+    }
+
+    if ((m_fenceSync == NULL) || (m_clientWaitSync == NULL) || (m_deleteSync == NULL))
+    {
+        m_fenceSync = NULL;     // not supported, glFinish is used instead
+        m_clientWaitSync = NULL;
+        m_deleteSync = NULL;
+    }
+
+    m_functionsResolved = true;
+}
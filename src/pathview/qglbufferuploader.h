@@ -0,0 +1,91 @@
+/****************************************************************************
+**
+** Copyright (C) 2014 Alexander Rössler
+** License: LGPL version 2.1
+**
+** This file is part of QtQuickVcp.
+**
+** All rights reserved. This program and the accompanying materials
+** are made available under the terms of the GNU Lesser General Public License
+** (LGPL) version 2.1 which accompanies this distribution, and is available at
+** http://www.gnu.org/licenses/lgpl-2.1.html
+**
+** This library is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+** Lesser General Public License for more details.
+**
+** Contributors:
+** Alexander Rössler @ The Cool Tool GmbH <mail DOT aroessler AT gmail DOT com>
+**
+****************************************************************************/
+
+#ifndef QGLBUFFERUPLOADER_H
+#define QGLBUFFERUPLOADER_H
+
+#include <QObject>
+#include <QAtomicInt>
+#include <QList>
+#include <QOpenGLBuffer>
+#include <QOpenGLContext>
+#include <QOffscreenSurface>
+
+// fills buffer objects from a context shared with the render context,
+// lives on its own thread so large uploads do not stall rendering
+class QGLBufferUploader : public QObject
+{
+    Q_OBJECT
+public:
+    typedef struct {
+        QOpenGLBuffer *buffer;  // created by the render thread
+        const void *data;       // must stay valid until the job is finished
+        int size;
+    } Upload;
+
+    class Job {
+    public:
+        Job():
+            state(Pending)
+        { }
+
+        QList<Upload> uploads;
+        QAtomicInt state;
+    };
+
+    enum JobState {
+        Pending = 0,
+        Finished = 1,
+        Failed = 2     // the buffers have to be filled by the caller
+    };
+
+    // must be called with the render context current
+    explicit QGLBufferUploader(QOpenGLContext *shareContext, QOffscreenSurface *surface);
+
+    bool isValid() const;
+    void start(Job *job);
+
+signals:
+    void jobFinished();
+
+private slots:
+    void processJob(void *job);
+
+private:
+    typedef void *SyncObject;
+    typedef SyncObject (QOPENGLF_APIENTRYP FenceSyncFunction)(GLenum condition, GLbitfield flags);
+    typedef GLenum (QOPENGLF_APIENTRYP ClientWaitSyncFunction)(SyncObject sync, GLbitfield flags, quint64 timeout);
+    typedef void (QOPENGLF_APIENTRYP DeleteSyncFunction)(SyncObject sync);
+
+    QOpenGLContext *m_context;
+    QOffscreenSurface *m_surface;
+    bool m_functionsResolved;
+
+    // fences, NULL if not supported by the context
+    FenceSyncFunction m_fenceSync;
+    ClientWaitSyncFunction m_clientWaitSync;
+    DeleteSyncFunction m_deleteSync;
+
+    void resolveFunctions();
+};
+
+#endif // QGLBUFFERUPLOADER_H
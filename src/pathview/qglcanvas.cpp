@@ -38,7 +38,7 @@ void QGLCanvas::paint(QGLView *glView)
     paint();
 }
 
-void QGLCanvas::selectDrawable(void *pointer)
+void QGLCanvas::selectDrawable(QGLDrawableHandle handle)
 {
-    emit drawableSelected(pointer);
+    emit drawableSelected(handle);
 }
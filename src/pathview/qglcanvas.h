@@ -43,10 +43,10 @@ public:
 signals:
     void contextChanged(QGLView * arg);
     void paint();
-    void drawableSelected(void *pointer);
+    void drawableSelected(QGLDrawableHandle handle);
 
 public slots:
-    virtual void selectDrawable(void *pointer);
+    virtual void selectDrawable(QGLDrawableHandle handle);
 
 private:
     QGLView * m_context;
@@ -24,7 +24,7 @@
 
 QGLCubeItem::QGLCubeItem(QQuickItem *parent) :
     QGLItem(parent),
-    m_cubePointer(NULL),
+    m_cubeHandle(0),
     m_size(QVector3D(1,1,1)),
     m_color(QColor(Qt::yellow)),
     m_centered(false),
@@ -45,20 +45,20 @@ void QGLCubeItem::paint(QGLView *glView)
     glView->reset();
     glView->beginUnion();
     glView->color(m_color);
-    m_cubePointer = glView->cube(m_size, m_centered);
+    m_cubeHandle = glView->cube(m_size, m_centered);
     glView->endUnion();
 }
 
-void QGLCubeItem::selectDrawable(void *pointer)
+void QGLCubeItem::selectDrawable(QGLDrawableHandle handle)
 {
     bool selected;
 
-    if (m_cubePointer == NULL)
+    if (m_cubeHandle == 0)
     {
         return;
     }
 
-    selected = (pointer == m_cubePointer);
+    selected = (handle == m_cubeHandle);
 
     if (selected != m_selected)
     {
@@ -66,7 +66,7 @@ signals:
     void selectedChanged(bool arg);
 
 public slots:
-    virtual void selectDrawable(void *pointer);
+    virtual void selectDrawable(QGLDrawableHandle handle);
 
     void setSize(float w, float l, float h)
     {
@@ -98,7 +98,7 @@ public slots:
     }
 
 private:
-    void* m_cubePointer;
+    QGLDrawableHandle m_cubeHandle;
 
     QVector3D m_size;
     QColor m_color;
@@ -24,7 +24,7 @@
 
 QGLCylinderItem::QGLCylinderItem(QQuickItem *parent) :
     QGLItem(parent),
-    m_cylinderPointer(NULL),
+    m_cylinderHandle(0),
     m_radius(1.0),
     m_height(1.0),
     m_color(QColor(Qt::yellow)),
@@ -50,25 +50,25 @@ void QGLCylinderItem::paint(QGLView *glView)
     glView->color(m_color);
     if (!m_cone)
     {
-        m_cylinderPointer = glView->cylinder(m_radius, m_height);
+        m_cylinderHandle = glView->cylinder(m_radius, m_height);
     }
     else
     {
-        m_cylinderPointer = glView->cone(m_radius, m_height);
+        m_cylinderHandle = glView->cone(m_radius, m_height);
     }
     glView->endUnion();
 }
 
-void QGLCylinderItem::selectDrawable(void *pointer)
+void QGLCylinderItem::selectDrawable(QGLDrawableHandle handle)
 {
     bool selected;
 
-    if (m_cylinderPointer == NULL)
+    if (m_cylinderHandle == 0)
     {
         return;
     }
 
-    selected = (pointer == m_cylinderPointer);
+    selected = (handle == m_cylinderHandle);
 
     if (selected != m_selected)
     {
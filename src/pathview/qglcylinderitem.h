@@ -72,7 +72,7 @@ signals:
     void selectedChanged(bool arg);
 
 public slots:
-    virtual void selectDrawable(void *pointer);
+    virtual void selectDrawable(QGLDrawableHandle handle);
 
     void setRadius(float arg)
     {
@@ -107,7 +107,7 @@ public slots:
     }
 
 private:
-    void *m_cylinderPointer;
+    QGLDrawableHandle m_cylinderHandle;
     float m_radius;
     float m_height;
     QColor m_color;
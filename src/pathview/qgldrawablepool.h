@@ -0,0 +1,195 @@
+/****************************************************************************
+**
+** Copyright (C) 2014 Alexander Rössler
+** License: LGPL version 2.1
+**
+** This file is part of QtQuickVcp.
+**
+** All rights reserved. This program and the accompanying materials
+** are made available under the terms of the GNU Lesser General Public License
+** (LGPL) version 2.1 which accompanies this distribution, and is available at
+** http://www.gnu.org/licenses/lgpl-2.1.html
+**
+** This library is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+** Lesser General Public License for more details.
+**
+** Contributors:
+** Alexander Rössler @ The Cool Tool GmbH <mail DOT aroessler AT gmail DOT com>
+**
+****************************************************************************/
+#ifndef QGLDRAWABLEPOOL_H
+#define QGLDRAWABLEPOOL_H
+
+#include <QVector>
+
+// handle to a drawable of a GL view, 0 is the invalid handle
+// bits 0-31: slot, bits 32-47: generation, bits 48-55: drawable type
+typedef quint64 QGLDrawableHandle;
+
+inline int drawableHandleType(QGLDrawableHandle handle)
+{
+    return (int)((handle >> 48) & 0xFF);
+}
+
+template <typename T>
+class QGLDrawablePool
+{
+public:
+    explicit QGLDrawablePool(int type = 0):
+        m_type(type)
+    { }
+
+    QGLDrawableHandle append(const T &drawable)
+    {
+        quint32 slot;
+
+        if (!m_freeSlots.isEmpty())
+        {
+            slot = m_freeSlots.last();
+            m_freeSlots.removeLast();
+        }
+        else
+        {
+            Slot newSlot;
+            newSlot.index = -1;
+            newSlot.generation = 0;
+            slot = m_slots.size();
+            m_slots.append(newSlot);
+        }
+
+        m_slots[slot].index = m_drawables.size();
+        m_drawables.append(drawable);
+        m_drawableSlots.append(slot);
+
+        return createHandle(slot);
+    }
+
+    // swap remove, the last drawable takes the place of the removed one
+    bool remove(QGLDrawableHandle handle)
+    {
+        int index = indexOf(handle);
+        int lastIndex = m_drawables.size() - 1;
+        quint32 slot;
+
+        if (index == -1)
+        {
+            return false;
+        }
+
+        slot = m_drawableSlots.at(index);
+        if (index != lastIndex)
+        {
+            m_drawables[index] = m_drawables.at(lastIndex);
+            m_drawableSlots[index] = m_drawableSlots.at(lastIndex);
+            m_slots[m_drawableSlots.at(index)].index = index;
+        }
+        m_drawables.removeLast();
+        m_drawableSlots.removeLast();
+
+        releaseSlot(slot);
+        return true;
+    }
+
+    // removes all drawables at once, allocated memory is kept for reuse
+    void clear()
+    {
+        for (int i = 0; i < m_drawableSlots.size(); ++i)
+        {
+            releaseSlot(m_drawableSlots.at(i));
+        }
+        m_drawables.resize(0);
+        m_drawableSlots.resize(0);
+    }
+
+    // returns -1 for stale or foreign handles
+    int indexOf(QGLDrawableHandle handle) const
+    {
+        quint32 slot = (quint32)(handle & 0xFFFFFFFF);
+        quint16 generation = (quint16)((handle >> 32) & 0xFFFF);
+
+        if ((drawableHandleType(handle) != m_type) || (slot >= (quint32)m_slots.size()))
+        {
+            return -1;
+        }
+
+        const Slot &slotData = m_slots.at(slot);
+        if (slotData.generation != generation)
+        {
+            return -1;
+        }
+
+        return slotData.index;
+    }
+
+    T *value(QGLDrawableHandle handle)
+    {
+        int index = indexOf(handle);
+
+        if (index == -1)
+        {
+            return NULL;
+        }
+
+        return &m_drawables[index];
+    }
+
+    QGLDrawableHandle handleAt(int index) const
+    {
+        return createHandle(m_drawableSlots.at(index));
+    }
+
+    T &operator[](int index)
+    {
+        return m_drawables[index];
+    }
+
+    const T &at(int index) const
+    {
+        return m_drawables.at(index);
+    }
+
+    int size() const
+    {
+        return m_drawables.size();
+    }
+
+    bool isEmpty() const
+    {
+        return m_drawables.isEmpty();
+    }
+
+    int type() const
+    {
+        return m_type;
+    }
+
+private:
+    typedef struct {
+        int index;              // position in the drawable array, -1 if unused
+        quint16 generation;     // incremented on release, invalidates old handles
+    } Slot;
+
+    QVector<T> m_drawables;         // contiguous drawable storage
+    QVector<quint32> m_drawableSlots;   // slot of each drawable
+    QVector<Slot> m_slots;
+    QVector<quint32> m_freeSlots;
+    int m_type;
+
+    QGLDrawableHandle createHandle(quint32 slot) const
+    {
+        return ((QGLDrawableHandle)(m_type & 0xFF) << 48)
+                | ((QGLDrawableHandle)m_slots.at(slot).generation << 32)
+                | (QGLDrawableHandle)slot;
+    }
+
+    void releaseSlot(quint32 slot)
+    {
+        m_slots[slot].index = -1;
+        m_slots[slot].generation++;
+        m_freeSlots.append(slot);
+    }
+};
+
+#endif // QGLDRAWABLEPOOL_H
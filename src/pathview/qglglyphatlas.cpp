@@ -0,0 +1,225 @@
+/****************************************************************************
+**
+** Copyright (C) 2014 Alexander Rössler
+** License: LGPL version 2.1
+**
+** This file is part of QtQuickVcp.
+**
+** All rights reserved. This program and the accompanying materials
+** are made available under the terms of the GNU Lesser General Public License
+** (LGPL) version 2.1 which accompanies this distribution, and is available at
+** http://www.gnu.org/licenses/lgpl-2.1.html
+**
+** This library is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+** Lesser General Public License for more details.
+**
+** Contributors:
+** Alexander Rössler @ The Cool Tool GmbH <mail DOT aroessler AT gmail DOT com>
+**
+****************************************************************************/
+
+#include "qglglyphatlas.h"
+#include <QFontMetricsF>
+#include <QImage>
+#include <QPainter>
+#include <QtCore/qmath.h>
+
+static const int GlyphPixelSize = 48;   // glyphs are rendered at this size, the field keeps them sharp when scaled
+static const int GlyphSpread = 6;       // distance in pixels covered by the field around the outline
+static const int AtlasWidth = 1024;
+static const int AtlasMinimumHeight = 256;
+static const int AtlasMaximumHeight = 4096;
+
+QGLGlyphAtlas::QGLGlyphAtlas():
+    m_size(AtlasWidth, AtlasMinimumHeight),
+    m_shelfX(0),
+    m_shelfY(0),
+    m_shelfHeight(0),
+    m_dirtyFirst(-1),
+    m_dirtyLast(-1)
+{
+    m_data.fill(0, m_size.width() * m_size.height());
+}
+
+QGLGlyphAtlas::Glyph QGLGlyphAtlas::glyph(const QFont &font, uint character)
+{
+    QFont renderFont = glyphFont(font);
+    QPair<QString, uint> key = qMakePair(renderFont.key(), character);
+    QHash<QPair<QString, uint>, Glyph>::const_iterator it = m_glyphs.constFind(key);
+
+    if (it != m_glyphs.constEnd())
+    {
+        return it.value();
+    }
+
+    QString string = QString::fromUcs4(&character, 1);
+    QFontMetricsF fontMetrics(renderFont);
+    QRectF boundingRect = fontMetrics.boundingRect(string);
+    Glyph glyph;
+
+    glyph.advance = fontMetrics.width(string);
+    glyph.bounds = QRectF();
+    glyph.textureRect = QRectF();
+
+    if (!boundingRect.isEmpty())
+    {
+        // the field needs some room around the outline
+        QRect bounds = boundingRect.toAlignedRect().adjusted(-GlyphSpread, -GlyphSpread, GlyphSpread, GlyphSpread);
+        QPoint position;
+
+        if (allocate(bounds.size(), &position))
+        {
+            renderGlyph(renderFont, character, bounds, position);
+            glyph.bounds = QRectF(bounds);
+            glyph.textureRect = QRectF(QPointF(position), QSizeF(bounds.size()));
+        }
+    }
+
+    m_glyphs.insert(key, glyph);
+
+    return glyph;
+}
+
+QFont QGLGlyphAtlas::glyphFont(const QFont &font) const
+{
+    QFont renderFont = font;
+    renderFont.setPixelSize(GlyphPixelSize);
+    return renderFont;
+}
+
+qreal QGLGlyphAtlas::pixelSize() const
+{
+    return GlyphPixelSize;
+}
+
+QSize QGLGlyphAtlas::size() const
+{
+    return m_size;
+}
+
+const uchar *QGLGlyphAtlas::data() const
+{
+    return m_data.constData();
+}
+
+bool QGLGlyphAtlas::isDirty() const
+{
+    return (m_dirtyFirst != -1);
+}
+
+int QGLGlyphAtlas::dirtyFirst() const
+{
+    return m_dirtyFirst;
+}
+
+int QGLGlyphAtlas::dirtyLast() const
+{
+    return m_dirtyLast;
+}
+
+void QGLGlyphAtlas::markClean()
+{
+    m_dirtyFirst = -1;
+    m_dirtyLast = -1;
+}
+
+bool QGLGlyphAtlas::allocate(const QSize &size, QPoint *position)
+{
+    if (size.width() > m_size.width())
+    {
+        return false;
+    }
+
+    // glyphs are placed on shelves of the height of the largest glyph
+    if ((m_shelfX + size.width()) > m_size.width())
+    {
+        m_shelfX = 0;
+        m_shelfY += m_shelfHeight;
+        m_shelfHeight = 0;
+    }
+
+    while ((m_shelfY + size.height()) > m_size.height())
+    {
+        if ((m_size.height() * 2) > AtlasMaximumHeight)
+        {
+            return false;
+        }
+
+        // growing keeps the existing rows, the whole texture has to be uploaded again
+        m_size.setHeight(m_size.height() * 2);
+        m_data.resize(m_size.width() * m_size.height());
+        m_dirtyFirst = 0;
+        m_dirtyLast = m_size.height();
+    }
+
+    *position = QPoint(m_shelfX, m_shelfY);
+    m_shelfX += size.width();
+    m_shelfHeight = qMax(m_shelfHeight, size.height());
+
+    if ((m_dirtyFirst == -1) || (position->y() < m_dirtyFirst))
+    {
+        m_dirtyFirst = position->y();
+    }
+    m_dirtyLast = qMax(m_dirtyLast, position->y() + size.height());
+
+    return true;
+}
+
+void QGLGlyphAtlas::renderGlyph(const QFont &font, uint character, const QRect &bounds, const QPoint &position)
+{
+    QImage image(bounds.size(), QImage::Format_ARGB32_Premultiplied);
+    int width = bounds.width();
+    int height = bounds.height();
+    QVector<bool> inside(width * height);
+
+    image.fill(Qt::transparent);
+    QPainter painter(&image);
+    painter.setPen(Qt::white);
+    painter.setFont(font);
+    painter.drawText(-bounds.left(), -bounds.top(), QString::fromUcs4(&character, 1));
+    painter.end();
+
+    for (int y = 0; y < height; ++y)
+    {
+        const QRgb *line = reinterpret_cast<const QRgb*>(image.constScanLine(y));
+        for (int x = 0; x < width; ++x)
+        {
+            inside[y * width + x] = (qAlpha(line[x]) > 127);
+        }
+    }
+
+    // brute force search for the closest pixel on the other side of the outline,
+    // glyphs are only rendered once so this stays cheap
+    for (int y = 0; y < height; ++y)
+    {
+        uchar *destination = m_data.data() + (position.y() + y) * m_size.width() + position.x();
+
+        for (int x = 0; x < width; ++x)
+        {
+            bool state = inside.at(y * width + x);
+            int minimumSquared = (GlyphSpread + 1) * (GlyphSpread + 1);
+            qreal distance;
+
+            for (int j = qMax(y - GlyphSpread, 0); j <= qMin(y + GlyphSpread, height - 1); ++j)
+            {
+                for (int i = qMax(x - GlyphSpread, 0); i <= qMin(x + GlyphSpread, width - 1); ++i)
+                {
+                    if (inside.at(j * width + i) != state)
+                    {
+                        int squared = (i - x) * (i - x) + (j - y) * (j - y);
+                        if (squared < minimumSquared)
+                        {
+                            minimumSquared = squared;
+                        }
+                    }
+                }
+            }
+
+            distance = qMin(qSqrt(minimumSquared), (qreal)GlyphSpread) / GlyphSpread;
+            distance = state ? (0.5 + distance * 0.5) : (0.5 - distance * 0.5);
+            destination[x] = (uchar)qBound(0, qRound(distance * 255.0), 255);
+        }
+    }
+}
@@ -0,0 +1,73 @@
+/****************************************************************************
+**
+** Copyright (C) 2014 Alexander Rössler
+** License: LGPL version 2.1
+**
+** This file is part of QtQuickVcp.
+**
+** All rights reserved. This program and the accompanying materials
+** are made available under the terms of the GNU Lesser General Public License
+** (LGPL) version 2.1 which accompanies this distribution, and is available at
+** http://www.gnu.org/licenses/lgpl-2.1.html
+**
+** This library is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+** Lesser General Public License for more details.
+**
+** Contributors:
+** Alexander Rössler @ The Cool Tool GmbH <mail DOT aroessler AT gmail DOT com>
+**
+****************************************************************************/
+
+#ifndef QGLGLYPHATLAS_H
+#define QGLGLYPHATLAS_H
+
+#include <QFont>
+#include <QHash>
+#include <QPair>
+#include <QRectF>
+#include <QSize>
+#include <QVector>
+
+// signed distance field glyphs packed into one alpha texture
+// 0.5 is the glyph outline, larger values are inside
+class QGLGlyphAtlas
+{
+public:
+    typedef struct {
+        QRectF bounds;      // quad relative to the pen position on the baseline, y points down
+        QRectF textureRect; // area of the glyph in the atlas, in pixels
+        qreal advance;
+    } Glyph;
+
+    QGLGlyphAtlas();
+
+    Glyph glyph(const QFont &font, uint character);
+    QFont glyphFont(const QFont &font) const;
+    qreal pixelSize() const;
+
+    QSize size() const;
+    const uchar *data() const;
+
+    // rows modified since the last call of markClean
+    bool isDirty() const;
+    int dirtyFirst() const;
+    int dirtyLast() const;
+    void markClean();
+
+private:
+    QVector<uchar> m_data;
+    QSize m_size;
+    QHash<QPair<QString, uint>, Glyph> m_glyphs;
+    int m_shelfX;       // next free position on the current shelf
+    int m_shelfY;
+    int m_shelfHeight;
+    int m_dirtyFirst;
+    int m_dirtyLast;
+
+    bool allocate(const QSize &size, QPoint *position);
+    void renderGlyph(const QFont &font, uint character, const QRect &bounds, const QPoint &position);
+};
+
+#endif // QGLGLYPHATLAS_H
@@ -28,7 +28,8 @@ QGLItem::QGLItem(QQuickItem *parent) :
     m_scale(QVector3D(1,1,1)),
     m_rotation(QQuaternion()),
     m_rotationAngle(0),
-    m_rotationAxis(QVector3D())
+    m_rotationAxis(QVector3D()),
+    m_cached(false)
 {
     connect(this, SIGNAL(positionChanged(QVector3D)),
             this, SIGNAL(needsUpdate()));
@@ -44,9 +45,16 @@ QGLItem::QGLItem(QQuickItem *parent) :
             this, SIGNAL(needsUpdate()));
     connect(this, SIGNAL(visibleChanged()),
             this, SIGNAL(needsUpdate()));
+    connect(this, SIGNAL(cachedChanged(bool)),
+            this, SIGNAL(needsUpdate()));
 }
 
 void QGLItem::requestPaint()
 {
     emit needsUpdate();
 }
+
+void QGLItem::hoverDrawable(QGLDrawableHandle handle)
+{
+    Q_UNUSED(handle)
+}
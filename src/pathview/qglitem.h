@@ -24,6 +24,7 @@
 #define QGLITEM_H
 
 #include <QObject>
+#include "qgldrawablepool.h"
 #include "qglview.h"
 
 class QGLView;
@@ -36,6 +37,7 @@ class QGLItem : public QQuickItem
     Q_PROPERTY(QQuaternion rotation READ rotation WRITE setRotation NOTIFY rotationChanged)
     Q_PROPERTY(float rotationAngle READ rotationAngle WRITE setRotationAngle NOTIFY rotationAngleChanged)
     Q_PROPERTY(QVector3D rotationAxis READ rotationAxis WRITE setRotationAxis NOTIFY rotationAxisChanged)
+    Q_PROPERTY(bool cached READ isCached WRITE setCached NOTIFY cachedChanged)
 
 public:
     explicit QGLItem(QQuickItem *parent = 0);
@@ -67,6 +69,12 @@ public:
         return m_rotationAxis;
     }
 
+    // cached items are drawn once into the static layer of the view, use it for rarely changing items
+    bool isCached() const
+    {
+        return m_cached;
+    }
+
 signals:
     void needsUpdate();
     void modelIdChanged(quint32 arg);
@@ -75,10 +83,12 @@ signals:
     void rotationChanged(QQuaternion arg);
     void rotationAngleChanged(float arg);
     void rotationAxisChanged(QVector3D arg);
+    void cachedChanged(bool arg);
 
 public slots:
     void requestPaint();
-    virtual void selectDrawable(void *pointer) = 0; // must be implemented
+    virtual void selectDrawable(QGLDrawableHandle handle) = 0; // must be implemented
+    virtual void hoverDrawable(QGLDrawableHandle handle);
 
     void setPosition(float x, float y, float z)
     {
@@ -142,12 +152,21 @@ public slots:
         }
     }
 
+    void setCached(bool arg)
+    {
+        if (m_cached != arg) {
+            m_cached = arg;
+            emit cachedChanged(arg);
+        }
+    }
+
 private:
     QVector3D m_position;
     QVector3D m_scale;
     QQuaternion m_rotation;
     float m_rotationAngle;
     QVector3D m_rotationAxis;
+    bool m_cached;
 };
 
 #endif // QGLITEM_H
@@ -0,0 +1,339 @@
+/****************************************************************************
+**
+** Copyright (C) 2014 Alexander Rössler
+** License: LGPL version 2.1
+**
+** This file is part of QtQuickVcp.
+**
+** All rights reserved. This program and the accompanying materials
+** are made available under the terms of the GNU Lesser General Public License
+** (LGPL) version 2.1 which accompanies this distribution, and is available at
+** http://www.gnu.org/licenses/lgpl-2.1.html
+**
+** This library is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+** Lesser General Public License for more details.
+**
+** Contributors:
+** Alexander Rössler @ The Cool Tool GmbH <mail DOT aroessler AT gmail DOT com>
+**
+****************************************************************************/
+
+#include "qgllinepacker.h"
+#include <QDebug>
+#include <limits>
+
+static inline GLushort quantize(float value, float step)
+{
+    return (GLushort)qBound(0, qRound(value / step), (int)QGLLinePacker::MaxQuantizedValue);
+}
+
+static inline bool isSamePosition(const QGLLinePacker::Position &a, const QGLLinePacker::Position &b)
+{
+    return (a.x == b.x) && (a.y == b.y) && (a.z == b.z);
+}
+
+// unstippled vertices fit into any unstippled chunk, stippled ones need the same pattern
+static inline bool isSameStipple(const QGLLinePacker::Vertex &a, const QGLLinePacker::Vertex &b)
+{
+    return (a.stippleLength == b.stippleLength)
+            && ((a.stippleLength == 0.0) || isSamePosition(a.stippleOrigin, b.stippleOrigin));
+}
+
+QGLLinePacker::QGLLinePacker(GLfloat resolution):
+    m_resolution(resolution)
+{
+}
+
+GLfloat QGLLinePacker::resolution() const
+{
+    return m_resolution;
+}
+
+GLfloat QGLLinePacker::roundTripLimit(const QGLLinePacker::Position &position) const
+{
+    // half a step plus the float rounding of the position, the chunk origin and the offset in the chunk
+    GLfloat magnitude = qMax(qMax(qAbs(position.x), qAbs(position.y)), qAbs(position.z)) + m_resolution * MaxQuantizedValue;
+    return 0.5f * m_resolution + magnitude * 2.0f * std::numeric_limits<float>::epsilon();
+}
+
+GLfloat QGLLinePacker::maximumExtent() const
+{
+    // one step of margin, a position at the far end must not round past the largest value
+    return m_resolution * (MaxQuantizedValue - 1);
+}
+
+void QGLLinePacker::appendSplitSegments(const QVector<Vertex> &source, int first, int count, QVector<Vertex> &vertices) const
+{
+    GLfloat extent = maximumExtent();
+
+    for (int i = first; (i + 1) < (first + count); i += 2)
+    {
+        const Vertex &start = source.at(i);
+        const Vertex &end = source.at(i + 1);
+        QVector3D startPosition(start.position.x, start.position.y, start.position.z);
+        QVector3D delta = QVector3D(end.position.x, end.position.y, end.position.z) - startPosition;
+        float length = qMax(qMax(qAbs(delta.x()), qAbs(delta.y())), qAbs(delta.z()));
+        int pieces = (int)(length / extent) + 1;
+
+        if (pieces == 1)
+        {
+            vertices.append(start);
+            vertices.append(end);
+            continue;
+        }
+
+        // every piece of a long segment has to fit into the range of one chunk
+        for (int j = 0; j < pieces; ++j)
+        {
+            Vertex vertex = start;
+            QVector3D position = startPosition + delta * ((float)j / pieces);
+
+            vertex.position.x = position.x();
+            vertex.position.y = position.y();
+            vertex.position.z = position.z();
+            vertices.append(vertex);
+
+            if ((j + 1) == pieces)
+            {
+                vertices.append(end);
+            }
+            else
+            {
+                position = startPosition + delta * ((float)(j + 1) / pieces);
+                vertex.position.x = position.x();
+                vertex.position.y = position.y();
+                vertex.position.z = position.z();
+                vertices.append(vertex);
+            }
+        }
+    }
+}
+
+void QGLLinePacker::pack(const QVector<Vertex> &vertices, const QVector<int> &drawableOffsets, QVector<Chunk> &chunks,
+                         QVector<PackedVertex> &packedVertices, QVector<GLushort> &indices) const
+{
+    GLfloat extent = maximumExtent();
+    QVector<bool> sharedStarts(vertices.size() / 2, false);    // the segment starts at the end of the previous one
+    int rangeIndex = indices.size();
+    int rangeVertex = packedVertices.size();
+    QVector3D chunkMinimum;
+    QVector3D chunkMaximum;
+    GLfloat chunkSequenceMinimum = 0.0;
+    GLfloat chunkSequenceMaximum = 0.0;
+    int chunkFirst = 0;
+    int chunkVertexCount = 0;
+    int nextDrawable = 0;
+
+    packedVertices.reserve(packedVertices.size() + vertices.size());
+    indices.reserve(indices.size() + vertices.size());
+
+    // a chunk grows along the vertex order until the next segment does not fit into its range
+    for (int i = 0; (i + 1) < vertices.size(); i += 2)
+    {
+        const Position &start = vertices.at(i).position;
+        const Position &end = vertices.at(i + 1).position;
+        QVector3D minimum(qMin(start.x, end.x), qMin(start.y, end.y), qMin(start.z, end.z));
+        QVector3D maximum(qMax(start.x, end.x), qMax(start.y, end.y), qMax(start.z, end.z));
+        GLfloat sequenceMinimum = qMin(vertices.at(i).sequence, vertices.at(i + 1).sequence);
+        GLfloat sequenceMaximum = qMax(vertices.at(i).sequence, vertices.at(i + 1).sequence);
+        bool drawableStart = false;
+        QVector3D size;
+
+        // the strips are staged as GL_LINES pairs, connected segments of one drawable share the common vertex
+        while ((nextDrawable < drawableOffsets.size()) && (drawableOffsets.at(nextDrawable) <= i))
+        {
+            drawableStart = true;
+            nextDrawable++;
+        }
+        if ((i > 0) && !drawableStart)
+        {
+            const Vertex &previous = vertices.at(i - 1);
+            sharedStarts[i / 2] = isSamePosition(previous.position, start) && (previous.sequence == vertices.at(i).sequence);
+        }
+
+        if (i == chunkFirst)
+        {
+            chunkMinimum = minimum;
+            chunkMaximum = maximum;
+            chunkSequenceMinimum = sequenceMinimum;
+            chunkSequenceMaximum = sequenceMaximum;
+            chunkVertexCount = 2;
+            continue;
+        }
+
+        minimum = QVector3D(qMin(minimum.x(), chunkMinimum.x()), qMin(minimum.y(), chunkMinimum.y()), qMin(minimum.z(), chunkMinimum.z()));
+        maximum = QVector3D(qMax(maximum.x(), chunkMaximum.x()), qMax(maximum.y(), chunkMaximum.y()), qMax(maximum.z(), chunkMaximum.z()));
+        size = maximum - minimum;
+        // the sequence is stored relative to the chunk too, the stipple is set per chunk
+        if ((size.x() > extent) || (size.y() > extent) || (size.z() > extent)
+            || ((qMax(chunkSequenceMaximum, sequenceMaximum) - qMin(chunkSequenceMinimum, sequenceMinimum)) > MaxQuantizedValue)
+            || ((chunkVertexCount + 2) > MaxChunkVertices)
+            || !isSameStipple(vertices.at(chunkFirst), vertices.at(i)))
+        {
+            appendChunks(vertices, sharedStarts, chunkFirst, i, rangeIndex, rangeVertex, chunks, packedVertices, indices);
+            chunkFirst = i;
+            chunkMinimum = QVector3D(qMin(start.x, end.x), qMin(start.y, end.y), qMin(start.z, end.z));
+            chunkMaximum = QVector3D(qMax(start.x, end.x), qMax(start.y, end.y), qMax(start.z, end.z));
+            chunkSequenceMinimum = sequenceMinimum;
+            chunkSequenceMaximum = sequenceMaximum;
+            chunkVertexCount = 2;
+        }
+        else
+        {
+            chunkMinimum = minimum;
+            chunkMaximum = maximum;
+            chunkSequenceMinimum = qMin(chunkSequenceMinimum, sequenceMinimum);
+            chunkSequenceMaximum = qMax(chunkSequenceMaximum, sequenceMaximum);
+            chunkVertexCount += sharedStarts.at(i / 2) ? 1 : 2;
+        }
+    }
+
+    if ((chunkFirst + 1) < vertices.size())
+    {
+        appendChunks(vertices, sharedStarts, chunkFirst, vertices.size(), rangeIndex, rangeVertex, chunks, packedVertices, indices);
+    }
+}
+
+void QGLLinePacker::appendChunks(const QVector<Vertex> &vertices, const QVector<bool> &sharedStarts, int first, int end,
+                                 int rangeIndex, int rangeVertex, QVector<Chunk> &chunks,
+                                 QVector<PackedVertex> &packedVertices, QVector<GLushort> &indices) const
+{
+    int middle;
+
+    if (appendChunk(vertices, sharedStarts, first, end, rangeIndex, rangeVertex, (end - first) <= 2,
+                    chunks, packedVertices, indices))
+    {
+        return;
+    }
+
+    // a position left the range by rounding, the halves have smaller ranges
+    middle = first + ((end - first) / 4) * 2;
+    appendChunks(vertices, sharedStarts, first, middle, rangeIndex, rangeVertex, chunks, packedVertices, indices);
+    appendChunks(vertices, sharedStarts, middle, end, rangeIndex, rangeVertex, chunks, packedVertices, indices);
+}
+
+bool QGLLinePacker::appendChunk(const QVector<Vertex> &vertices, const QVector<bool> &sharedStarts, int first, int end,
+                                int rangeIndex, int rangeVertex, bool force, QVector<Chunk> &chunks,
+                                QVector<PackedVertex> &packedVertices, QVector<GLushort> &indices) const
+{
+    const Vertex &firstVertex = vertices.at(first);
+    int vertexBase = packedVertices.size();
+    int indexBase = indices.size();
+    GLfloat maximumError = 0.0;
+    Chunk chunk;
+
+    chunk.first = indexBase - rangeIndex;
+    chunk.firstVertex = vertexBase - rangeVertex;
+    chunk.origin = QVector3D(firstVertex.position.x, firstVertex.position.y, firstVertex.position.z);
+    chunk.stippleOrigin = QVector3D(firstVertex.stippleOrigin.x, firstVertex.stippleOrigin.y, firstVertex.stippleOrigin.z);
+    chunk.stippleLength = firstVertex.stippleLength;
+    chunk.sequenceOrigin = firstVertex.sequence;
+    for (int i = (first + 1); i < end; ++i)
+    {
+        const Vertex &vertex = vertices.at(i);
+        chunk.origin = QVector3D(qMin(chunk.origin.x(), vertex.position.x),
+                                 qMin(chunk.origin.y(), vertex.position.y),
+                                 qMin(chunk.origin.z(), vertex.position.z));
+        chunk.sequenceOrigin = qMin(chunk.sequenceOrigin, vertex.sequence);
+    }
+
+    for (int i = first; i < end; ++i)
+    {
+        const Vertex &vertex = vertices.at(i);
+        PackedVertex packedVertex;
+        QVector3D error;
+
+        // the first segment of a chunk never shares its start, the previous vertex lies in the previous chunk
+        if (((i % 2) == 0) && (i > first) && sharedStarts.at(i / 2))
+        {
+            indices.append(indices.last());
+            continue;
+        }
+
+        packedVertex.position[0] = quantize(vertex.position.x - chunk.origin.x(), m_resolution);
+        packedVertex.position[1] = quantize(vertex.position.y - chunk.origin.y(), m_resolution);
+        packedVertex.position[2] = quantize(vertex.position.z - chunk.origin.z(), m_resolution);
+        packedVertex.sequence = quantize(vertex.sequence - chunk.sequenceOrigin, 1.0);   // sequences are whole numbers
+        packedVertices.append(packedVertex);
+        indices.append(packedVertices.size() - 1 - vertexBase);
+
+        // measured round trip error, the range of the chunk keeps it within half a step
+        error = chunk.origin
+                + QVector3D(packedVertex.position[0], packedVertex.position[1], packedVertex.position[2]) * m_resolution
+                - QVector3D(vertex.position.x, vertex.position.y, vertex.position.z);
+        maximumError = qMax(maximumError, qMax(qMax(qAbs(error.x()), qAbs(error.y())), qAbs(error.z())) - roundTripLimit(vertex.position));
+    }
+
+    if (maximumError > 0.0)
+    {
+        if (!force)
+        {
+            packedVertices.resize(vertexBase);
+            indices.resize(indexBase);
+            return false;
+        }
+        qWarning() << "line vertex round trip error exceeds its limit by" << maximumError;
+    }
+
+    chunks.append(chunk);
+    return true;
+}
+
+void QGLLinePacker::unpack(const QVector<Chunk> &chunks, const PackedVertex *packedVertices, const GLushort *indices,
+                           int first, int count, QVector<Vertex> &vertices) const
+{
+    int chunkIndex = chunkAt(chunks, first);
+
+    // the indexed pairs are unpacked as GL_LINES pairs again, the staging layout
+    vertices.reserve(vertices.size() + count);
+    for (int i = first; i < (first + count); ++i)
+    {
+        Vertex vertex;
+
+        while (((chunkIndex + 1) < chunks.size()) && (i >= chunks.at(chunkIndex + 1).first))
+        {
+            chunkIndex++;
+        }
+
+        const Chunk &chunk = chunks.at(chunkIndex);
+        const PackedVertex &packedVertex = packedVertices[chunk.firstVertex + indices[i]];
+        vertex.position.x = chunk.origin.x() + packedVertex.position[0] * m_resolution;
+        vertex.position.y = chunk.origin.y() + packedVertex.position[1] * m_resolution;
+        vertex.position.z = chunk.origin.z() + packedVertex.position[2] * m_resolution;
+        vertex.stippleOrigin.x = chunk.stippleOrigin.x();
+        vertex.stippleOrigin.y = chunk.stippleOrigin.y();
+        vertex.stippleOrigin.z = chunk.stippleOrigin.z();
+        vertex.stippleLength = chunk.stippleLength;
+        vertex.sequence = chunk.sequenceOrigin + packedVertex.sequence;
+        vertices.append(vertex);
+    }
+}
+
+int QGLLinePacker::chunkAt(const QVector<Chunk> &chunks, int index)
+{
+    int low = 0;
+    int high = chunks.size() - 1;
+
+    // last chunk starting at or before the index
+    while (low < high)
+    {
+        int middle = (low + high + 1) / 2;
+        if (chunks.at(middle).first <= index)
+        {
+            low = middle;
+        }
+        else
+        {
+            high = middle - 1;
+        }
+    }
+
+    return low;
+}
+
+int QGLLinePacker::vertexAt(const QVector<Chunk> &chunks, const GLushort *indices, int index)
+{
+    return chunks.at(chunkAt(chunks, index)).firstVertex + indices[index];
+}
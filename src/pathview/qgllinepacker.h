@@ -0,0 +1,93 @@
+/****************************************************************************
+**
+** Copyright (C) 2014 Alexander Rössler
+** License: LGPL version 2.1
+**
+** This file is part of QtQuickVcp.
+**
+** All rights reserved. This program and the accompanying materials
+** are made available under the terms of the GNU Lesser General Public License
+** (LGPL) version 2.1 which accompanies this distribution, and is available at
+** http://www.gnu.org/licenses/lgpl-2.1.html
+**
+** This library is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+** Lesser General Public License for more details.
+**
+** Contributors:
+** Alexander Rössler @ The Cool Tool GmbH <mail DOT aroessler AT gmail DOT com>
+**
+****************************************************************************/
+
+#ifndef QGLLINEPACKER_H
+#define QGLLINEPACKER_H
+
+#include <QVector>
+#include <QVector3D>
+#include <qopengl.h>
+
+// quantizes line vertices staged as GL_LINES pairs into chunks of strip vertices
+// and GL_LINES indices, has no GL state so it can be used without a context
+class QGLLinePacker
+{
+public:
+    typedef struct {
+        GLfloat x;
+        GLfloat y;
+        GLfloat z;
+    } Position;
+
+    typedef struct {
+        Position position;
+        Position stippleOrigin;     // start point of the path, stipple distance is measured from here
+        GLfloat stippleLength;      // 0.0 disables stippling
+        GLfloat sequence;           // position in the program order, compared with the executed sequence of the item
+    } Vertex;
+
+    // quantized vertex as stored in the line vertex buffer
+    typedef struct {
+        GLushort position[3];       // relative to the chunk origin, in steps of the resolution
+        GLushort sequence;          // relative to the sequence origin of the chunk
+    } PackedVertex;
+
+    // the stipple of a chunk is the same for all its vertices, it is passed as uniforms
+    typedef struct {
+        int first;                  // first index, relative to the packed range
+        int firstVertex;            // first vertex, relative to the packed range, the indices of the chunk count from here
+        QVector3D origin;           // position of the quantized value 0
+        QVector3D stippleOrigin;
+        GLfloat stippleLength;      // 0.0 disables stippling
+        GLfloat sequenceOrigin;     // sequence of the quantized value 0
+    } Chunk;
+
+    static const int MaxQuantizedValue = 0xFFFF;    // a chunk covers at most MaxQuantizedValue steps of the resolution
+    static const int MaxChunkVertices = 0x10000;    // the indices of a chunk are GLushort
+
+    explicit QGLLinePacker(GLfloat resolution);
+
+    GLfloat resolution() const;
+    GLfloat roundTripLimit(const Position &position) const;
+
+    void appendSplitSegments(const QVector<Vertex> &source, int first, int count, QVector<Vertex> &vertices) const;
+    void pack(const QVector<Vertex> &vertices, const QVector<int> &drawableOffsets, QVector<Chunk> &chunks,
+              QVector<PackedVertex> &packedVertices, QVector<GLushort> &indices) const;
+    void unpack(const QVector<Chunk> &chunks, const PackedVertex *packedVertices, const GLushort *indices,
+                int first, int count, QVector<Vertex> &vertices) const;
+
+    static int chunkAt(const QVector<Chunk> &chunks, int index);
+    static int vertexAt(const QVector<Chunk> &chunks, const GLushort *indices, int index);
+
+private:
+    GLfloat m_resolution;
+
+    GLfloat maximumExtent() const;
+    void appendChunks(const QVector<Vertex> &vertices, const QVector<bool> &sharedStarts, int first, int end,
+                      int rangeIndex, int rangeVertex, QVector<Chunk> &chunks,
+                      QVector<PackedVertex> &packedVertices, QVector<GLushort> &indices) const;
+    bool appendChunk(const QVector<Vertex> &vertices, const QVector<bool> &sharedStarts, int first, int end,
+                     int rangeIndex, int rangeVertex, bool force, QVector<Chunk> &chunks,
+                     QVector<PackedVertex> &packedVertices, QVector<GLushort> &indices) const;
+};
+
+#endif // QGLLINEPACKER_H
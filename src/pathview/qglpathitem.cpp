@@ -21,8 +21,6 @@
 ****************************************************************************/
 
 #include "qglpathitem.h"
-#include <QtCore/qmath.h>
-#include "debughelper.h"
 
 QGLPathItem::QGLPathItem(QQuickItem *parent) :
     QGLItem(parent),
@@ -35,9 +33,11 @@ QGLPathItem::QGLPathItem(QQuickItem *parent) :
     m_backplotTraverseColor(QColor(Qt::yellow)),
     m_selectedColor(QColor(Qt::magenta)),
     m_activeColor(QColor(Qt::red)),
+    m_hoveredColor(QColor(Qt::green)),
+    m_scene(NULL),
+    m_previousSelectedDrawable(0),
     m_needsFullUpdate(true),
-    m_minimumExtents(QVector3D(0, 0, 0)),
-    m_maximumExtents(QVector3D(0, 0, 0))
+    m_executedSegments(0)
 {
     connect(this, SIGNAL(visibleChanged()),
             this, SLOT(triggerFullUpdate()));
@@ -59,7 +59,10 @@ QGLPathItem::QGLPathItem(QQuickItem *parent) :
 
 QGLPathItem::~QGLPathItem()
 {
-    qDeleteAll(m_previewPathItems);
+    if (m_scene != NULL)
+    {
+        QGLPathScene::release(m_scene);
+    }
 }
 
 void QGLPathItem::paint(QGLView *glView)
@@ -68,108 +71,77 @@ void QGLPathItem::paint(QGLView *glView)
     {
         glView->prepare(this);
         glView->reset();
-        glView->beginUnion();
 
-        for (int i = 0; i < m_previewPathItems.size(); ++i)
+        // the geometry was recorded by the shared scene build, it only needs to be handed over
+        m_drawableSegmentMap.clear();
+        m_drawableHandles.clear();
+        if ((m_scene != NULL) && (m_scene->sceneBuffer() != NULL)
+            && (m_scene->sceneBuffer()->pathCount() == m_scene->segmentCount()))
         {
-            void* drawablePointer = NULL;
-            PathItem *pathItem = m_previewPathItems.at(i);
-            if (pathItem->pathType == Line)
-            {
-                LinePathItem *linePathItem = static_cast<LinePathItem*>(pathItem);
-                if (linePathItem->movementType == FeedMove)
-                {
-                    glView->color(m_straightFeedColor);
-                }
-                else
-                {
-                    glView->color(m_traverseColor);
-                    glView->lineStipple(true, 1.0);
-                }
-                glView->translate(linePathItem->position);
-                drawablePointer = glView->line(linePathItem->lineVector);
-            }
-            else if (pathItem->pathType == Arc)
-            {
-                ArcPathItem *arcPathItem = static_cast<ArcPathItem*>(pathItem);
-                glView->color(m_arcFeedColor);
-                glView->translate(arcPathItem->position);
-                if (arcPathItem->rotationPlane == XZPlane) {
-                    glView->rotate(90, 1, 0, 0);
-                }
-                else if  (arcPathItem->rotationPlane == YZPlane) {
-                    glView->rotate(-90, 0, 1, 0);
-                }
-                drawablePointer = glView->arc(arcPathItem->center.x(),
-                                              arcPathItem->center.y(),
-                                              arcPathItem->radius,
-                                              arcPathItem->startAngle,
-                                              arcPathItem->endAngle,
-                                              arcPathItem->anticlockwise,
-                                              arcPathItem->helixOffset);
-            }
+            m_drawableHandles = glView->sceneBuffer(*m_scene->sceneBuffer());
 
-            if (drawablePointer != NULL)
+            m_drawableSegmentMap.reserve(m_drawableHandles.size());
+            for (int i = 0; i < m_drawableHandles.size(); ++i)
             {
-                pathItem->drawablePointer = drawablePointer;
-                m_drawablePathMap.insert(drawablePointer, pathItem);
+                m_drawableSegmentMap.insert(m_drawableHandles.at(i), i);
             }
         }
 
-        glView->endUnion();
-
         m_needsFullUpdate = false;
     }
     else
     {
-        for (int i = 0; i < m_modifiedPathItems.size(); ++i)
+        for (int i = 0; i < m_modifiedSegments.size(); ++i)
         {
-            PathItem *pathItem;
+            int segment = m_modifiedSegments.at(i);
 
-            pathItem = m_modifiedPathItems.at(i);
-            if (pathItem != NULL)
+            // segments that are not drawn yet get their color when they are added
+            if (segment < m_drawableHandles.size())
             {
+                int row = m_scene->segmentRow(segment);
+                QGLPathScene::PathType pathType = m_scene->segmentPathType(segment);
+                QGLPathScene::MovementType movementType = m_scene->segmentMovementType(segment);
                 QColor color;
-                if (m_model->data(pathItem->modelIndex, QGCodeProgramModel::SelectedRole).toBool()) {
+                QColor backplotColor;
+                if (m_model->isSelected(row)) {
                     color = m_selectedColor;
+                    backplotColor = color;
                 }
-                else if (m_model->data(pathItem->modelIndex, QGCodeProgramModel::ActiveRole).toBool())
+                else if (m_hoveredIndex.isValid() && (row == m_hoveredIndex.row()))
                 {
-                    color = m_activeColor;
+                    color = m_hoveredColor;
+                    backplotColor = color;
                 }
-                else if (m_model->data(pathItem->modelIndex, QGCodeProgramModel::ExecutedRole).toBool())
+                else if (m_model->isActive(row))
                 {
-                    if (pathItem->movementType == FeedMove) {
-                        if (pathItem->pathType == Arc) {
-                            color = m_backplotArcFeedColor;
-                        }
-                        else {
-                            color = m_backplotStraightFeedColor;
-                        }
-                    }
-                    else {
-                        color = m_backplotTraverseColor;
-                    }
+                    color = m_activeColor;
+                    backplotColor = color;
                 }
                 else
                 {
-                    if (pathItem->movementType == FeedMove) {
-                        if (pathItem->pathType == Arc) {
+                    // the executed state is applied by the GL view from the backplot sequence
+                    if (movementType == QGLPathScene::FeedMove) {
+                        if (pathType == QGLPathScene::Arc) {
                             color = m_arcFeedColor;
+                            backplotColor = m_backplotArcFeedColor;
                         }
                         else {
                             color = m_straightFeedColor;
+                            backplotColor = m_backplotStraightFeedColor;
                         }
                     }
                     else {
                         color = m_traverseColor;
+                        backplotColor = m_backplotTraverseColor;
                     }
                 }
-                glView->updateColor(pathItem->drawablePointer, color);
+                glView->updateColor(m_drawableHandles.at(segment), color, backplotColor);
             }
         }
-        m_modifiedPathItems.clear();
+        m_modifiedSegments.resize(0);
     }
+
+    glView->updateBackplot(this, m_executedSegments);
 }
 
 QGCodeProgramModel *QGLPathItem::model() const
@@ -194,12 +166,17 @@ QColor QGLPathItem::selectedColor() const
 
 QVector3D QGLPathItem::minimumExtents() const
 {
-    return m_minimumExtents;
+    return (m_scene != NULL) ? m_scene->minimumExtents() : QVector3D();
 }
 
 QVector3D QGLPathItem::maximumExtents() const
 {
-    return m_maximumExtents;
+    return (m_scene != NULL) ? m_scene->maximumExtents() : QVector3D();
+}
+
+double QGLPathItem::progress() const
+{
+    return (m_scene != NULL) ? m_scene->progress() : 1.0;
 }
 
 QColor QGLPathItem::straightFeedColor() const
@@ -212,6 +189,16 @@ QColor QGLPathItem::activeColor() const
     return m_activeColor;
 }
 
+QColor QGLPathItem::hoveredColor() const
+{
+    return m_hoveredColor;
+}
+
+QModelIndex QGLPathItem::hoveredIndex() const
+{
+    return m_hoveredIndex;
+}
+
 QColor QGLPathItem::backplotArcFeedColor() const
 {
     return m_backplotArcFeedColor;
@@ -227,33 +214,63 @@ QColor QGLPathItem::backplotTraverseColor() const
     return m_backplotTraverseColor;
 }
 
-void QGLPathItem::selectDrawable(void *pointer)
+void QGLPathItem::selectDrawable(QGLDrawableHandle handle)
 {
-    PathItem *mappedPathItem;
-    QModelIndex mappedModelIndex;
+    int mappedSegment;
 
-    if (m_model == NULL)
+    if ((m_model == NULL) || (m_scene == NULL))
     {
         return;
     }
 
-    mappedPathItem = m_drawablePathMap.value(pointer, NULL);
-    if (mappedPathItem != NULL)
+    mappedSegment = m_drawableSegmentMap.value(handle, -1);
+    if (mappedSegment != -1)
     {
-        mappedModelIndex = mappedPathItem->modelIndex;
-        m_model->setData(mappedModelIndex, true, QGCodeProgramModel::SelectedRole);
+        m_model->setData(m_model->index(m_scene->segmentRow(mappedSegment)), true, QGCodeProgramModel::SelectedRole);
     }
 
-    if (m_previousSelectedDrawable != pointer)
+    if (m_previousSelectedDrawable != handle)
     {
-        mappedPathItem = m_drawablePathMap.value(m_previousSelectedDrawable);
-        if (mappedPathItem != NULL)
+        mappedSegment = m_drawableSegmentMap.value(m_previousSelectedDrawable, -1);
+        if (mappedSegment != -1)
         {
-            mappedModelIndex = mappedPathItem->modelIndex;
-            m_model->setData(mappedModelIndex, false, QGCodeProgramModel::SelectedRole);
+            m_model->setData(m_model->index(m_scene->segmentRow(mappedSegment)), false, QGCodeProgramModel::SelectedRole);
         }
 
-        m_previousSelectedDrawable = pointer;
+        m_previousSelectedDrawable = handle;
+    }
+}
+
+void QGLPathItem::hoverDrawable(QGLDrawableHandle handle)
+{
+    int mappedSegment;
+    QModelIndex mappedModelIndex;
+
+    if ((m_model == NULL) || (m_scene == NULL))
+    {
+        return;
+    }
+
+    mappedSegment = m_drawableSegmentMap.value(handle, -1);
+    if (mappedSegment != -1)
+    {
+        mappedModelIndex = m_model->index(m_scene->segmentRow(mappedSegment));
+    }
+
+    if (mappedModelIndex != m_hoveredIndex)
+    {
+        // recolor the previous and the new hovered path
+        if (m_hoveredIndex.isValid())
+        {
+            appendModifiedRow(m_hoveredIndex.row());
+        }
+        if (mappedModelIndex.isValid())
+        {
+            appendModifiedRow(mappedModelIndex.row());
+        }
+        m_hoveredIndex = mappedModelIndex;
+        emit hoveredIndexChanged(m_hoveredIndex);
+        emit needsUpdate();
     }
 }
 
@@ -265,16 +282,11 @@ void QGLPathItem::setModel(QGCodeProgramModel *arg)
 
         if (m_model != NULL)
         {
-            connect(m_model, SIGNAL(modelReset()),
-                    this, SLOT(drawPath()));
             connect(m_model, SIGNAL(dataChanged(QModelIndex,QModelIndex,QVector<int>)),
                     this, SLOT(modelDataChanged(QModelIndex,QModelIndex,QVector<int>)));
-
-            if (m_model->rowCount() > 0)
-            {
-                drawPath();     // draw model when set
-            }
         }
+
+        updateScene();
     }
 }
 
@@ -283,6 +295,7 @@ void QGLPathItem::setArcFeedColor(QColor arg)
     if (m_arcFeedColor != arg) {
         m_arcFeedColor = arg;
         emit arcFeedColorChanged(arg);
+        updateScene();  // the color is recorded into the geometry
     }
 }
 
@@ -291,6 +304,7 @@ void QGLPathItem::setTraverseColor(QColor arg)
     if (m_traverseColor != arg) {
         m_traverseColor = arg;
         emit traverseColorChanged(arg);
+        updateScene();  // the color is recorded into the geometry
     }
 }
 
@@ -307,6 +321,7 @@ void QGLPathItem::setStraightFeedColor(QColor arg)
     if (m_straightFeedColor != arg) {
         m_straightFeedColor = arg;
         emit straightFeedColorChanged(arg);
+        updateScene();  // the color is recorded into the geometry
     }
 }
 
@@ -318,11 +333,20 @@ void QGLPathItem::setActiveColor(QColor arg)
     }
 }
 
+void QGLPathItem::setHoveredColor(QColor arg)
+{
+    if (m_hoveredColor != arg) {
+        m_hoveredColor = arg;
+        emit hoveredColorChanged(arg);
+    }
+}
+
 void QGLPathItem::setBackplotArcFeedColor(QColor arg)
 {
     if (m_backplotArcFeedColor != arg) {
         m_backplotArcFeedColor = arg;
         emit backplotArcFeedColorChanged(arg);
+        updateScene();  // the color is recorded into the geometry
     }
 }
 
@@ -331,6 +355,7 @@ void QGLPathItem::setBackplotStraightFeedColor(QColor arg)
     if (m_backplotStraightFeedColor != arg) {
         m_backplotStraightFeedColor = arg;
         emit backplotStraightFeedColorChanged(arg);
+        updateScene();  // the color is recorded into the geometry
     }
 }
 
@@ -339,578 +364,147 @@ void QGLPathItem::setBackplotTraverseColor(QColor arg)
     if (m_backplotTraverseColor != arg) {
         m_backplotTraverseColor = arg;
         emit backplotTraverseColorChanged(arg);
+        updateScene();  // the color is recorded into the geometry
     }
 }
 
-void QGLPathItem::resetActiveOffsets()
-{
-    Position clearOffset;
-    clearOffset.x = 0.0;
-    clearOffset.y = 0.0;
-    clearOffset.z = 0.0;
-    clearOffset.a = 0.0;
-    clearOffset.b = 0.0;
-    clearOffset.c = 0.0;
-    clearOffset.u = 0.0;
-    clearOffset.v = 0.0;
-    clearOffset.w = 0.0;
 
-    m_activeOffsets.g92Offset = clearOffset;
-    m_activeOffsets.toolOffset = clearOffset;
-    m_activeOffsets.g5xOffsets.clear();
-    for (int i = 0; i < 9; ++i)
+void QGLPathItem::modelDataChanged(const QModelIndex &topLeft, const QModelIndex &bottomRight, const QVector<int> &roles)
+{
+    if (m_scene == NULL)
     {
-        m_activeOffsets.g5xOffsets.append(clearOffset);
+        return;
     }
-    m_activeOffsets.g5xOffsetIndex = 1;
-}
 
-void QGLPathItem::resetCurrentPosition()
-{
-    m_currentPosition.x = 0.0;
-    m_currentPosition.y = 0.0;
-    m_currentPosition.z = 0.0;
-    m_currentPosition.a = 0.0;
-    m_currentPosition.b = 0.0;
-    m_currentPosition.c = 0.0;
-    m_currentPosition.u = 0.0;
-    m_currentPosition.v = 0.0;
-    m_currentPosition.w = 0.0;
-}
+    if (roles.contains(QGCodeProgramModel::ExecutedRole))
+    {
+        updateExecutedSegments(topLeft.row(), bottomRight.row());
+    }
 
-void QGLPathItem::resetActivePlane()
-{
-    m_activePlane = XYPlane;
-}
+    if (roles.contains(QGCodeProgramModel::SelectedRole)
+        || roles.contains(QGCodeProgramModel::ActiveRole))
+    {
+        int modifiedCount;
 
-void QGLPathItem::resetExtents()
-{
-    m_maximumExtents = QVector3D();
-    m_minimumExtents = QVector3D();
-}
+        modifiedCount = m_modifiedSegments.size();
+        for (int row = topLeft.row(); row <= bottomRight.row(); ++row)
+        {
+            appendModifiedRow(row);
+        }
 
-void QGLPathItem::updateExtents(const QVector3D &vector)
-{
-    if (vector.x() < m_minimumExtents.x()) {
-        m_minimumExtents.setX(vector.x());
-    }
-    if (vector.y() < m_minimumExtents.y()) {
-        m_minimumExtents.setY(vector.y());
-    }
-    if (vector.z() < m_minimumExtents.z()) {
-        m_minimumExtents.setZ(vector.z());
-    }
-    if (vector.x() > m_maximumExtents.x()) {
-        m_maximumExtents.setX(vector.x());
-    }
-    if (vector.y() > m_maximumExtents.y()) {
-        m_maximumExtents.setY(vector.y());
-    }
-    if (vector.z() > m_maximumExtents.z()) {
-        m_maximumExtents.setZ(vector.z());
+        if (m_modifiedSegments.size() != modifiedCount)
+        {
+            emit needsUpdate();
+        }
     }
 }
 
-void QGLPathItem::releaseExtents()
+void QGLPathItem::appendModifiedRow(int row)
 {
-    emit minimumExtentsChanged(m_minimumExtents);
-    emit maximumExtentsChanged(m_maximumExtents);
-}
+    int end = m_scene->rowSegmentEnd(row);
 
-void QGLPathItem::processPreview(const pb::Preview &preview)
-{
-    switch (preview.type())
-    {
-    case pb::PV_STRAIGHT_PROBE:  /*nothing*/ return;
-    case pb::PV_RIGID_TAP:  /*nothing*/ return;
-    case pb::PV_STRAIGHT_FEED: processStraightMove(preview, FeedMove); return;
-    case pb::PV_ARC_FEED: processArcFeed(preview); return;
-    case pb::PV_STRAIGHT_TRAVERSE: processStraightMove(preview, TraverseMove); return;
-    case pb::PV_SET_G5X_OFFSET: processSetG5xOffset(preview); return;
-    case pb::PV_SET_G92_OFFSET: processSetG92Offset(preview); return;
-    case pb::PV_SET_XY_ROTATION: /*nothing*/ return;
-    case pb::PV_SELECT_PLANE: processSelectPlane(preview); return;
-    case pb::PV_SET_TRAVERSE_RATE: /*nothing*/ return;
-    case pb::PV_SET_FEED_RATE: /*nothing*/ return;
-    case pb::PV_CHANGE_TOOL: /*nothing*/ return;
-    case pb::PV_CHANGE_TOOL_NUMBER: /*nothing*/ return;
-    case pb::PV_DWELL: /*nothing*/ return;
-    case pb::PV_MESSAGE: /*nothing*/ return;
-    case pb::PV_COMMENT: /*nothing*/ return;
-    case pb::PV_USE_TOOL_OFFSET: processUseToolOffset(preview); return;
-    case pb::PV_SET_PARAMS: /*nothing*/ return;
-    case pb::PV_SET_FEED_MODE: /*nothing*/ return;
-    case pb::PV_SOURCE_CONTEXT: /*nothing*/ return;
-    }
-}
-
-void QGLPathItem::processStraightMove(const pb::Preview &preview, MovementType movementType)
-{
-#ifdef QT_DEBUG
-    if (movementType == FeedMove)
-    {
-        qDebug() << "straight feed";
-    }
-    else
+    for (int segment = m_scene->rowSegmentBegin(row); segment < end; ++segment)
     {
-        qDebug() << "straight traverse";
+        m_modifiedSegments.append(segment);
     }
-#endif
-
-    Position newPosition;
-    QVector3D currentVector;
-    QVector3D newVector;
-    LinePathItem *linePathItem;
-
-    linePathItem = new LinePathItem();
-    newPosition = calculateNewPosition(preview.pos());
-    currentVector = positionToVector3D(m_currentPosition);
-    newVector = positionToVector3D(newPosition);
-
-    linePathItem->position = currentVector;
-    linePathItem->lineVector = newVector - currentVector;
-    linePathItem->movementType = movementType;
-    linePathItem->modelIndex = m_currentModelIndex,
-    m_previewPathItems.append(linePathItem);
-    m_modelPathMap.insert(m_currentModelIndex, linePathItem);   // mapping model index to the item
-
-    m_currentPosition = newPosition;
-
-    updateExtents(newVector);
 }
 
-void QGLPathItem::processArcFeed(const pb::Preview &preview)
+void QGLPathItem::updateExecutedSegments(int topRow, int bottomRow)
 {
-#ifdef QT_DEBUG
-    qDebug() << "arc feed";
-#endif
-
-    Position newPosition;
-    QVector3D currentVector;
-    QVector3D newVector;
-    QVector2D startPoint;
-    QVector2D endPoint;
-    QVector2D centerPoint;
-    QVector2D startVector;
-    QVector2D endVector;
-    double startAngle;
-    double endAngle;
-    double helixOffset;
-    bool anticlockwise;
-    double radius;
-    ArcPathItem *arcPathItem;
-
-    currentVector = positionToVector3D(m_currentPosition);
-    newPosition = calculateNewPosition(preview.pos());
-
-    if (m_activePlane == XYPlane)
-    {
-        arcPathItem = new ArcPathItem();
-        newPosition.x = preview.first_end();
-        newPosition.y = preview.second_end();
-        newPosition.z = preview.axis_end_point();
-        newVector = positionToVector3D(newPosition);
-
-        startPoint.setX(currentVector.x());
-        startPoint.setY(currentVector.y());
-
-        helixOffset = newVector.z() - currentVector.z();
-    }
-    else if (m_activePlane == YZPlane)
-    {
-        arcPathItem = new ArcPathItem();
-        newPosition.y = preview.first_end();
-        newPosition.z = preview.second_end();
-        newPosition.x = preview.axis_end_point();
-        newVector = positionToVector3D(newPosition);
-
-        startPoint.setX(currentVector.y());
-        startPoint.setY(currentVector.z());
+    int executedSegments;
 
-        helixOffset = newVector.x() - currentVector.x();
-    }
-    else if (m_activePlane == XZPlane)
+    // the rows are executed in order, so only the frontier moves instead of recoloring every segment
+    if (m_model->isExecuted(bottomRow))
     {
-        arcPathItem = new ArcPathItem();
-        newPosition.x = preview.first_end();
-        newPosition.z = preview.second_end();
-        newPosition.y = preview.axis_end_point();
-        newVector = positionToVector3D(newPosition);
-
-        startPoint.setX(currentVector.x());
-        startPoint.setY(currentVector.z());
-
-        helixOffset = newVector.y() - currentVector.y();
+        executedSegments = qMax(m_executedSegments, m_scene->rowSegmentEnd(bottomRow));
     }
     else
     {
-        return; // not supported
-    }
-
-    endPoint.setX(preview.first_end());
-    endPoint.setY(preview.second_end());
-    centerPoint.setX(preview.first_axis());
-    centerPoint.setY(preview.second_axis());
-    startVector = startPoint - centerPoint;
-    endVector = endPoint - centerPoint;
-
-    startAngle = qAtan2(startVector.y(), startVector.x());
-    if (startAngle < 0) {
-        startAngle += 2 * M_PI;
-    }
-    endAngle = qAtan2(endVector.y(), endVector.x());
-    if (startAngle < 0) {
-        endAngle += 2 * M_PI;
-    }
-    anticlockwise = preview.rotation() >= 0;
-    if (anticlockwise) {
-        startAngle += 2.0 * M_PI * (qAbs((double)preview.rotation())-1.0);  // for rotation > 1 increase the endAngle
-    }
-    else {
-        endAngle -= 2.0 * M_PI * (qAbs((double)preview.rotation())-1.0);  // for rotation > 1 decrease the startAngle
-    }
-
-    radius = centerPoint.distanceToPoint(startPoint);
-
-    // calculate the extents of the arc
-    double firstAngle;
-    double secondAngle;
-    // when viewed on the unit-circle
-    bool point1 = false;    // phi=0        right
-    bool point2 = false;    // phi=pi/2     top
-    bool point3 = false;    // phi=pi       left
-    bool point4 = false;    // phi=3pi/2    bottom
-
-    if (anticlockwise) {
-        firstAngle = endAngle;
-        secondAngle = startAngle;
-    }
-    else {
-        firstAngle = startAngle;
-        secondAngle = endAngle;
+        executedSegments = qMin(m_executedSegments, m_scene->rowSegmentBegin(topRow));
     }
 
-    if (secondAngle > firstAngle) {
-        secondAngle = 2.0 * M_PI - secondAngle;
-    }
-
-    if ((firstAngle > 0.0) && (secondAngle < 0.0)) {
-        point1 = true;
-    }
-    if (((firstAngle > M_PI_2) && (secondAngle < M_PI_2)) || (secondAngle < -3.0*M_PI_2)) {
-        point2 = true;
-    }
-    if (((firstAngle > M_PI) && (secondAngle < M_PI)) || (secondAngle < -M_PI)) {
-        point3 = true;
-    }
-    if (((firstAngle > 3.0*M_PI_2) && (secondAngle < 3.0*M_PI_2)) || (secondAngle < -M_PI_2)) {
-        point4 = true;
-    }
-
-    updateExtents(newVector);
-    if (m_activePlane == XYPlane)   // centerPoint: X is X, Y is Y
+    if (executedSegments != m_executedSegments)
     {
-        if (point1) {
-            updateExtents(QVector3D(centerPoint.x() + radius,
-                                    centerPoint.y(),
-                                    currentVector.z()));
-        }
-        if (point2) {
-            updateExtents(QVector3D(centerPoint.x(),
-                                    centerPoint.y() + radius,
-                                    currentVector.z()));
-        }
-        if (point3) {
-            updateExtents(QVector3D(centerPoint.x() - radius,
-                                    centerPoint.y(),
-                                    currentVector.z()));
-        }
-        if (point4) {
-            updateExtents(QVector3D(centerPoint.x(),
-                                    centerPoint.y() - radius,
-                                    currentVector.z()));
-        }
+        m_executedSegments = executedSegments;
+        emit needsUpdate();
     }
-    else if (m_activePlane == XZPlane)  // centerPoint: X is X, Y is Z
-    {
-        if (point1) {
-            updateExtents(QVector3D(centerPoint.x() + radius,
-                                    currentVector.y(),
-                                    centerPoint.y()));
-        }
-        if (point2) {
-            updateExtents(QVector3D(centerPoint.x(),
-                                    currentVector.y(),
-                                    centerPoint.y() + radius));
-        }
-        if (point3) {
-            updateExtents(QVector3D(centerPoint.x() - radius,
-                                    currentVector.y(),
-                                    centerPoint.y()));
-        }
-        if (point4) {
-            updateExtents(QVector3D(centerPoint.x(),
-                                    currentVector.y(),
-                                    centerPoint.y() - radius));
-        }
-    }
-    else if (m_activePlane == YZPlane)  // centerPoint: X is Y, Y is Z
-    {
-        if (point1) {
-            updateExtents(QVector3D(currentVector.x(),
-                                    centerPoint.x() + radius,
-                                    centerPoint.y()));
-        }
-        if (point2) {
-            updateExtents(QVector3D(currentVector.x(),
-                                    centerPoint.x(),
-                                    centerPoint.y() + radius));
-        }
-        if (point3) {
-            updateExtents(QVector3D(currentVector.x(),
-                                    centerPoint.x() - radius,
-                                    centerPoint.y()));
-        }
-        if (point4) {
-            updateExtents(QVector3D(currentVector.x(),
-                                    centerPoint.x(),
-                                    centerPoint.y() - radius));
-        }
-    }
-
-    arcPathItem->position = currentVector;
-    arcPathItem->rotationPlane = m_activePlane;
-    arcPathItem->center = (centerPoint - startPoint);
-    arcPathItem->radius = radius;
-    arcPathItem->helixOffset = helixOffset;
-    arcPathItem->startAngle = startAngle;
-    arcPathItem->endAngle = endAngle;
-    arcPathItem->anticlockwise = anticlockwise;
-    arcPathItem->movementType = FeedMove;
-    arcPathItem->modelIndex = m_currentModelIndex,
-    m_previewPathItems.append(arcPathItem);
-    m_modelPathMap.insertMulti(m_currentModelIndex, arcPathItem);   // mapping model index to the item
-
-    m_currentPosition = newPosition;
 }
 
-void QGLPathItem::processSetG5xOffset(const pb::Preview &preview)
+void QGLPathItem::triggerFullUpdate()
 {
-    if (preview.has_pos()) {
-        m_activeOffsets.g5xOffsets.replace(preview.g5_index(), previewPositionToPosition(preview.pos()));
-    }
+    m_needsFullUpdate = true;
 }
 
-void QGLPathItem::processSetG92Offset(const pb::Preview &preview)
+void QGLPathItem::componentComplete()
 {
-    if (preview.has_pos()) {
-        m_activeOffsets.g92Offset = previewPositionToPosition(preview.pos());
-    }
+    QGLItem::componentComplete();
+    updateScene();
 }
 
-void QGLPathItem::processUseToolOffset(const pb::Preview &preview)
+void QGLPathItem::updateScene()
 {
-    if (preview.has_pos()) {
-        m_activeOffsets.toolOffset = previewPositionToPosition(preview.pos());
-    }
-}
+    QGLPathScene *scene = NULL;
 
-void QGLPathItem::processSelectPlane(const pb::Preview &preview)
-{
-    if (preview.has_plane())
+    if (!isComponentComplete())
     {
-        switch (preview.plane())
-        {
-        case 1: m_activePlane = XYPlane; break;
-        case 2: m_activePlane = YZPlane; break;
-        case 3: m_activePlane = XZPlane; break;
-        case 4: m_activePlane = UVPlane; break;
-        case 5: m_activePlane = VWPlane; break;
-        case 6: m_activePlane = WUPlane; break;
-        default: break;
-        }
+        return;     // the scene is acquired once all properties are set
     }
-}
-
-QGLPathItem::Position QGLPathItem::previewPositionToPosition(const pb::Position &position) const
-{
-    Position newPosition;
-    newPosition.x = 0.0;
-    newPosition.y = 0.0;
-    newPosition.z = 0.0;
-    newPosition.a = 0.0;
-    newPosition.b = 0.0;
-    newPosition.c = 0.0;
-    newPosition.u = 0.0;
-    newPosition.v = 0.0;
-    newPosition.w = 0.0;
 
-    if (position.has_x()) {
-        newPosition.x = position.x();
-    }
-    if (position.has_y()) {
-        newPosition.y = position.y();
-    }
-    if (position.has_z()) {
-        newPosition.z = position.z();
-    }
-    if (position.has_a()) {
-        newPosition.a = position.a();
-    }
-    if (position.has_b()) {
-        newPosition.b = position.b();
-    }
-    if (position.has_c()) {
-        newPosition.c = position.c();
-    }
-    if (position.has_u()) {
-        newPosition.u = position.u();
-    }
-    if (position.has_v()) {
-        newPosition.v = position.v();
-    }
-    if (position.has_w()) {
-        newPosition.w = position.w();
-    }
-
-    return newPosition;
-}
-
-QGLPathItem::Position QGLPathItem::calculateNewPosition(const pb::Position &newPosition) const
-{
-    Position position = m_currentPosition;
-
-    if (newPosition.has_x()) {
-        position.x = m_activeOffsets.g92Offset.x;
-        position.x += m_activeOffsets.g5xOffsets.at(m_activeOffsets.g5xOffsetIndex-1).x;
-        position.x += m_activeOffsets.toolOffset.x;
-        position.x += newPosition.x();
-    }
-
-    if (newPosition.has_y()) {
-        position.y = m_activeOffsets.g92Offset.y;
-        position.y += m_activeOffsets.g5xOffsets.at(m_activeOffsets.g5xOffsetIndex-1).y;
-        position.y += m_activeOffsets.toolOffset.y;
-        position.y += newPosition.y();
-    }
-
-    if (newPosition.has_z()) {
-        position.z = m_activeOffsets.g92Offset.z;
-        position.z += m_activeOffsets.g5xOffsets.at(m_activeOffsets.g5xOffsetIndex-1).z;
-        position.z += m_activeOffsets.toolOffset.z;
-        position.z += newPosition.z();
-    }
-
-    if (newPosition.has_a()) {
-        position.a = m_activeOffsets.g92Offset.a;
-        position.a += m_activeOffsets.g5xOffsets.at(m_activeOffsets.g5xOffsetIndex-1).a;
-        position.a += m_activeOffsets.toolOffset.a;
-        position.a += newPosition.a();
-    }
-    if (newPosition.has_b()) {
-        position.b = m_activeOffsets.g92Offset.b;
-        position.b += m_activeOffsets.g5xOffsets.at(m_activeOffsets.g5xOffsetIndex-1).b;
-        position.b += m_activeOffsets.toolOffset.b;
-        position.b += newPosition.b();
-    }
-    if (newPosition.has_c()) {
-        position.c = m_activeOffsets.g92Offset.c;
-        position.c += m_activeOffsets.g5xOffsets.at(m_activeOffsets.g5xOffsetIndex-1).c;
-        position.c += m_activeOffsets.toolOffset.c;
-        position.c += newPosition.c();
-    }
-    if (newPosition.has_u()) {
-        position.u = m_activeOffsets.g92Offset.u;
-        position.u += m_activeOffsets.g5xOffsets.at(m_activeOffsets.g5xOffsetIndex-1).u;
-        position.u += m_activeOffsets.toolOffset.u;
-        position.u += newPosition.u();
-    }
-    if (newPosition.has_v()) {
-        position.v = m_activeOffsets.g92Offset.v;
-        position.v += m_activeOffsets.g5xOffsets.at(m_activeOffsets.g5xOffsetIndex-1).v;
-        position.v += m_activeOffsets.toolOffset.v;
-        position.v += newPosition.v();
-    }
-    if (newPosition.has_w()) {
-        position.w = m_activeOffsets.g92Offset.w;
-        position.w += m_activeOffsets.g5xOffsets.at(m_activeOffsets.g5xOffsetIndex-1).w;
-        position.w += m_activeOffsets.toolOffset.w;
-        position.w += newPosition.w();
+    if (m_model != NULL)
+    {
+        scene = QGLPathScene::acquire(m_model, m_arcFeedColor, m_straightFeedColor, m_traverseColor,
+                                      m_backplotArcFeedColor, m_backplotStraightFeedColor, m_backplotTraverseColor);
     }
 
-    return position;
-}
-
-QVector3D QGLPathItem::positionToVector3D(const QGLPathItem::Position &position) const
-{
-    return QVector3D(position.x, position.y, position.z);
-}
-
-void QGLPathItem::drawPath()
-{
-
-    if (m_model == NULL)
+    if ((scene != NULL) && (scene == m_scene))
     {
+        QGLPathScene::release(scene);   // already in use, only the additional reference is dropped
         return;
     }
 
-    qDeleteAll(m_previewPathItems); // clear the list of preview path items
-    m_previewPathItems.clear();
-    resetActiveOffsets(); // clear the offsets
-    resetActivePlane();
-    resetCurrentPosition(); // reset position
-    resetExtents();
-
-    m_modelPathMap.clear();
-    m_drawablePathMap.clear();
-    m_previousSelectedDrawable = NULL;
-
-    for (int i = 0; i < m_model->rowCount(); ++i)
+    if (m_scene != NULL)
     {
-        QModelIndex index;
-        QList<pb::Preview>* previewList;
-
-        index = m_model->index(i);
-        if (!index.isValid()) {
-            continue;
-        }
-        previewList = static_cast<QList<pb::Preview>* >(m_model->data(index, QGCodeProgramModel::PreviewRole).value<void*>());
+        disconnect(m_scene, 0, this, 0);
+        QGLPathScene::release(m_scene);
+    }
 
-        if (previewList != NULL)
-        {
-            m_currentModelIndex = index;
-            for (int j = 0; j < previewList->size(); ++j)
-            {
-                processPreview(previewList->at(j));
-            }
-        }
+    m_scene = scene;
+    if (m_scene != NULL)
+    {
+        connect(m_scene, SIGNAL(segmentsChanged()),
+                this, SLOT(sceneSegmentsChanged()));
+        connect(m_scene, SIGNAL(sceneBufferChanged()),
+                this, SLOT(sceneBufferChanged()));
+        connect(m_scene, SIGNAL(progressChanged(double)),
+                this, SIGNAL(progressChanged(double)));
     }
 
-    m_needsFullUpdate = true;
-    emit needsUpdate();
+    emit progressChanged(progress());
 
-    releaseExtents();
+    sceneSegmentsChanged();
+    sceneBufferChanged();
 }
 
-void QGLPathItem::modelDataChanged(const QModelIndex &topLeft, const QModelIndex &bottomRight, const QVector<int> &roles)
+void QGLPathItem::sceneSegmentsChanged()
 {
-    Q_UNUSED(bottomRight) // we only change one item at a time
-    if (roles.contains(QGCodeProgramModel::SelectedRole)
-        || roles.contains(QGCodeProgramModel::ActiveRole)
-        || roles.contains(QGCodeProgramModel::ExecutedRole))
+    // the indexes of the previous segments are meaningless now
+    m_modifiedSegments.clear();
+    m_drawableSegmentMap.clear();
+    m_drawableHandles.clear();
+    m_previousSelectedDrawable = 0;
+    m_executedSegments = 0;
+    if (m_hoveredIndex.isValid())
     {
-        QList<PathItem*> pathItemList;
-
-        pathItemList = m_modelPathMap.values(topLeft);
-        if (!pathItemList.isEmpty())
-        {
-            m_modifiedPathItems.append(pathItemList);
-            emit needsUpdate();
-        }
+        m_hoveredIndex = QModelIndex();
+        emit hoveredIndexChanged(m_hoveredIndex);
     }
+
+    emit minimumExtentsChanged(minimumExtents());
+    emit maximumExtentsChanged(maximumExtents());
 }
 
-void QGLPathItem::triggerFullUpdate()
+void QGLPathItem::sceneBufferChanged()
 {
     m_needsFullUpdate = true;
+    emit needsUpdate();
 }
@@ -23,9 +23,10 @@
 #ifndef QGLPATHITEM_H
 #define QGLPATHITEM_H
 
+#include <QHash>
 #include "qglitem.h"
+#include "qglpathscene.h"
 #include "qgcodeprogrammodel.h"
-#include "preview.pb.h"
 
 class QGLPathItem : public QGLItem
 {
@@ -38,9 +39,12 @@ class QGLPathItem : public QGLItem
     Q_PROPERTY(QColor backplotTraverseColor READ backplotTraverseColor WRITE setBackplotTraverseColor NOTIFY backplotTraverseColorChanged)
     Q_PROPERTY(QColor selectedColor READ selectedColor WRITE setSelectedColor NOTIFY selectedColorChanged)
     Q_PROPERTY(QColor activeColor READ activeColor WRITE setActiveColor NOTIFY activeColorChanged)
+    Q_PROPERTY(QColor hoveredColor READ hoveredColor WRITE setHoveredColor NOTIFY hoveredColorChanged)
+    Q_PROPERTY(QModelIndex hoveredIndex READ hoveredIndex NOTIFY hoveredIndexChanged)
     Q_PROPERTY(QGCodeProgramModel *model READ model WRITE setModel NOTIFY modelChanged)
     Q_PROPERTY(QVector3D minimumExtents READ minimumExtents NOTIFY minimumExtentsChanged)
     Q_PROPERTY(QVector3D maximumExtents READ maximumExtents NOTIFY maximumExtentsChanged)
+    Q_PROPERTY(double progress READ progress NOTIFY progressChanged)
 
 public:
     explicit QGLPathItem(QQuickItem *parent = 0);
@@ -57,11 +61,15 @@ public:
     QColor backplotTraverseColor() const;
     QColor selectedColor() const;
     QColor activeColor() const;
+    QColor hoveredColor() const;
+    QModelIndex hoveredIndex() const;
     QVector3D minimumExtents() const;
     QVector3D maximumExtents() const;
+    double progress() const;
 
 public slots:
-    virtual void selectDrawable(void *pointer);
+    virtual void selectDrawable(QGLDrawableHandle handle);
+    virtual void hoverDrawable(QGLDrawableHandle handle);
 
     void setModel(QGCodeProgramModel * arg);
     void setArcFeedColor(QColor arg);
@@ -72,92 +80,12 @@ public slots:
     void setBackplotStraightFeedColor(QColor arg);
     void setBackplotTraverseColor(QColor arg);
     void setActiveColor(QColor arg);
+    void setHoveredColor(QColor arg);
 
-private:
-    struct Position {
-        double x;
-        double y;
-        double z;
-        double a;
-        double b;
-        double c;
-        double u;
-        double v;
-        double w;
-    };
-
-    struct Offsets {
-        Position g92Offset;
-        Position toolOffset;
-        QList<Position> g5xOffsets;
-        int g5xOffsetIndex;
-    };
-
-    enum PathType {
-        Line,
-        Arc
-    };
-
-    enum MovementType {
-        FeedMove,
-        TraverseMove
-    };
-
-    enum Plane {
-        XYPlane,
-        XZPlane,
-        YZPlane,
-        UVPlane,
-        WUPlane,
-        VWPlane
-    };
-
-    class PathItem {
-    public:
-        PathItem():
-            pathType(Line),
-            movementType(FeedMove),
-            drawablePointer(NULL){}
-
-        PathType pathType;
-        MovementType movementType;
-        QVector3D position;
-        QModelIndex modelIndex;
-        void *drawablePointer;
-    };
-
-    class LinePathItem: public PathItem {
-    public:
-        LinePathItem(): PathItem() {
-            pathType = Line;
-        }
-
-        QVector3D lineVector;
-    };
-
-    class ArcPathItem: public PathItem {
-    public:
-        ArcPathItem():
-            PathItem(),
-            helixOffset(0.0),
-            radius(0.0),
-            startAngle(0.0),
-            endAngle(0.0),
-            anticlockwise(false),
-            rotationPlane(XYPlane)
-        {
-            pathType = Arc;
-        }
-
-        QVector2D center;
-        double helixOffset;     // offset from the rotation axis
-        double radius;
-        double startAngle;
-        double endAngle;
-        bool anticlockwise;
-        Plane rotationPlane;
-    };
+protected:
+    void componentComplete();
 
+private:
     QGCodeProgramModel * m_model;
     QColor m_arcFeedColor;
     QColor m_straightFeedColor;
@@ -167,43 +95,27 @@ private:
     QColor m_backplotTraverseColor;
     QColor m_selectedColor;
     QColor m_activeColor;
+    QColor m_hoveredColor;
 
-    Offsets m_activeOffsets;
-    Position m_currentPosition;
-    Plane m_activePlane;
-    QList<PathItem*> m_previewPathItems;
-    QModelIndex m_currentModelIndex;
-    QMultiMap<QModelIndex, PathItem*> m_modelPathMap;  // for mapping the model to internal items
-    QMap<void*, PathItem*> m_drawablePathMap;  // for mapping GL views drawables to internal items
-    void* m_previousSelectedDrawable;
+    QGLPathScene *m_scene;  // shared with the path items of other views showing the same model
+    QVector<QGLDrawableHandle> m_drawableHandles;   // drawable of each segment of the scene
+    QHash<QGLDrawableHandle, int> m_drawableSegmentMap; // for mapping GL views drawables to segments
+    QGLDrawableHandle m_previousSelectedDrawable;
+    QModelIndex m_hoveredIndex;
 
     bool m_needsFullUpdate;
-    QList<PathItem*> m_modifiedPathItems;
-
-    QVector3D m_minimumExtents;
-    QVector3D m_maximumExtents;
-
-    void resetActiveOffsets();
-    void resetCurrentPosition();
-    void resetActivePlane();
-    void resetExtents();
-    void updateExtents(const QVector3D &vector);
-    void releaseExtents();
-    void processPreview(const pb::Preview &preview);
-    void processStraightMove(const pb::Preview &preview, MovementType movementType);
-    void processArcFeed(const pb::Preview &preview);
-    void processSetG5xOffset(const pb::Preview &preview);
-    void processSetG92Offset(const pb::Preview &preview);
-    void processUseToolOffset(const pb::Preview &preview);
-    void processSelectPlane(const pb::Preview &preview);
-    Position previewPositionToPosition(const pb::Position &position) const;
-    Position calculateNewPosition(const pb::Position &newPosition) const;
-    QVector3D positionToVector3D(const Position &position) const;
+    QVector<int> m_modifiedSegments;
+    int m_executedSegments;     // the program is executed in segment order, the backplot covers [0, m_executedSegments)
+
+    void updateScene();
+    void appendModifiedRow(int row);
+    void updateExecutedSegments(int topRow, int bottomRow);
 
 private slots:
-    void drawPath();
     void modelDataChanged(const QModelIndex & topLeft, const QModelIndex & bottomRight, const QVector<int> & roles);
     void triggerFullUpdate();
+    void sceneSegmentsChanged();
+    void sceneBufferChanged();
 
 signals:
     void modelChanged(QGCodeProgramModel * arg);
@@ -212,9 +124,12 @@ signals:
     void selectedColorChanged(QColor arg);
     void minimumExtentsChanged(QVector3D arg);
     void maximumExtentsChanged(QVector3D arg);
+    void progressChanged(double arg);
     void straightFeedColorChanged(QColor arg);
     void executedColorChanged(QColor arg);
     void activeColorChanged(QColor arg);
+    void hoveredColorChanged(QColor arg);
+    void hoveredIndexChanged(QModelIndex arg);
     void backplotArcFeedColorChanged(QColor arg);
     void backplotStraightFeedColorChanged(QColor arg);
     void backplotTraverseColorChanged(QColor arg);
@@ -0,0 +1,908 @@
+/****************************************************************************
+**
+** Copyright (C) 2014 Alexander Rössler
+** License: LGPL version 2.1
+**
+** This file is part of QtQuickVcp.
+**
+** All rights reserved. This program and the accompanying materials
+** are made available under the terms of the GNU Lesser General Public License
+** (LGPL) version 2.1 which accompanies this distribution, and is available at
+** http://www.gnu.org/licenses/lgpl-2.1.html
+**
+** This library is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+** Lesser General Public License for more details.
+**
+** Contributors:
+** Alexander Rössler @ The Cool Tool GmbH <mail DOT aroessler AT gmail DOT com>
+**
+****************************************************************************/
+#include "qglpathscene.h"
+#include <QtCore/qmath.h>
+#include <QtConcurrent/QtConcurrentRun>
+#include "debughelper.h"
+
+QList<QGLPathScene*> QGLPathScene::s_scenes;
+
+QGLPathScene::QGLPathScene(QGCodeProgramModel *model, const QColor &arcFeedColor,
+                           const QColor &straightFeedColor, const QColor &traverseColor,
+                           const QColor &backplotArcFeedColor, const QColor &backplotStraightFeedColor,
+                           const QColor &backplotTraverseColor) :
+    QObject(),
+    m_model(model),
+    m_arcFeedColor(arcFeedColor),
+    m_straightFeedColor(straightFeedColor),
+    m_traverseColor(traverseColor),
+    m_backplotArcFeedColor(backplotArcFeedColor),
+    m_backplotStraightFeedColor(backplotStraightFeedColor),
+    m_backplotTraverseColor(backplotTraverseColor),
+    m_users(0),
+    m_sceneBuffer(NULL),
+    m_minimumExtents(QVector3D(0, 0, 0)),
+    m_maximumExtents(QVector3D(0, 0, 0)),
+    m_job(NULL),
+    m_jobWatcher(new QFutureWatcher<Interpretation*>(this)),
+    m_progressTimer(new QTimer(this)),
+    m_progress(1.0)
+{
+    m_progressTimer->setInterval(100);  // progress is polled, the worker does not post events
+
+    connect(m_model, SIGNAL(modelReset()),
+            this, SLOT(drawPath()));
+    connect(m_model, SIGNAL(destroyed()),
+            this, SLOT(modelDestroyed()));
+    connect(m_jobWatcher, SIGNAL(finished()),
+            this, SLOT(jobFinished()));
+    connect(m_progressTimer, SIGNAL(timeout()),
+            this, SLOT(updateProgress()));
+
+    if (m_model->rowCount() > 0)
+    {
+        drawPath();     // draw model when set
+    }
+}
+
+QGLPathScene::~QGLPathScene()
+{
+    cancelJob();
+    delete m_sceneBuffer;
+}
+
+QGLPathScene *QGLPathScene::acquire(QGCodeProgramModel *model, const QColor &arcFeedColor,
+                                    const QColor &straightFeedColor, const QColor &traverseColor,
+                                    const QColor &backplotArcFeedColor, const QColor &backplotStraightFeedColor,
+                                    const QColor &backplotTraverseColor)
+{
+    QGLPathScene *scene = NULL;
+
+    // the colors are recorded into the geometry, so they are part of the key
+    for (int i = 0; i < s_scenes.size(); ++i)
+    {
+        QGLPathScene *existingScene = s_scenes.at(i);
+        if ((existingScene->m_model == model)
+            && (existingScene->m_arcFeedColor == arcFeedColor)
+            && (existingScene->m_straightFeedColor == straightFeedColor)
+            && (existingScene->m_traverseColor == traverseColor)
+            && (existingScene->m_backplotArcFeedColor == backplotArcFeedColor)
+            && (existingScene->m_backplotStraightFeedColor == backplotStraightFeedColor)
+            && (existingScene->m_backplotTraverseColor == backplotTraverseColor))
+        {
+            scene = existingScene;
+            break;
+        }
+    }
+
+    if (scene == NULL)
+    {
+        scene = new QGLPathScene(model, arcFeedColor, straightFeedColor, traverseColor,
+                                 backplotArcFeedColor, backplotStraightFeedColor, backplotTraverseColor);
+        s_scenes.append(scene);
+    }
+
+    scene->m_users++;
+    return scene;
+}
+
+void QGLPathScene::release(QGLPathScene *scene)
+{
+    scene->m_users--;
+    if (scene->m_users == 0)
+    {
+        s_scenes.removeOne(scene);
+        delete scene;
+    }
+}
+
+QGCodeProgramModel *QGLPathScene::model() const
+{
+    return m_model;
+}
+
+int QGLPathScene::segmentCount() const
+{
+    return m_segments.pathTypes.size();
+}
+
+QGLPathScene::PathType QGLPathScene::segmentPathType(int segment) const
+{
+    return (PathType)m_segments.pathTypes.at(segment);
+}
+
+QGLPathScene::MovementType QGLPathScene::segmentMovementType(int segment) const
+{
+    return (MovementType)m_segments.movementTypes.at(segment);
+}
+
+int QGLPathScene::segmentRow(int segment) const
+{
+    return m_segments.rows.at(segment);
+}
+
+int QGLPathScene::rowSegmentBegin(int row) const
+{
+    if ((row < 0) || (row >= (m_segments.rowOffsets.size() - 1)))
+    {
+        return 0;
+    }
+
+    return m_segments.rowOffsets.at(row);
+}
+
+int QGLPathScene::rowSegmentEnd(int row) const
+{
+    if ((row < 0) || (row >= (m_segments.rowOffsets.size() - 1)))
+    {
+        return 0;
+    }
+
+    return m_segments.rowOffsets.at(row + 1);
+}
+
+const QGLSceneBuffer *QGLPathScene::sceneBuffer() const
+{
+    return m_sceneBuffer;
+}
+
+QVector3D QGLPathScene::minimumExtents() const
+{
+    return m_minimumExtents;
+}
+
+QVector3D QGLPathScene::maximumExtents() const
+{
+    return m_maximumExtents;
+}
+
+double QGLPathScene::progress() const
+{
+    return m_progress;
+}
+
+QGLPathScene::Interpreter::Interpreter(Job *job) :
+    m_job(job),
+    m_activePlane(XYPlane),
+    m_currentRow(0),
+    m_minimumExtents(QVector3D(0, 0, 0)),
+    m_maximumExtents(QVector3D(0, 0, 0))
+{
+    resetActiveOffsets();
+    resetCurrentPosition();
+}
+
+QGLPathScene::Interpretation *QGLPathScene::Interpreter::run()
+{
+    Interpretation *interpretation;
+    QGLSceneBuffer *sceneBuffer;
+    const QGCodeProgramModel::PreviewTable &previewTable = m_job->previews;
+    int rowCount = previewTable.rowOffsets.size() - 1;
+
+    m_segments.rowOffsets.reserve(rowCount + 1);
+    for (int i = 0; i < rowCount; ++i)
+    {
+        int previewEnd = previewTable.rowOffsets.at(i + 1);
+
+        if (isCanceled())
+        {
+            return NULL;
+        }
+
+        // segments are appended in row order, so each row owns a consecutive range
+        m_segments.rowOffsets.append(m_segments.pathTypes.size());
+        m_currentRow = i;
+        for (int j = previewTable.rowOffsets.at(i); j < previewEnd; ++j)
+        {
+            processPreview(previewTable.previews.at(j));
+        }
+
+        m_job->processedRows.storeRelease(i + 1);
+    }
+    m_segments.rowOffsets.append(m_segments.pathTypes.size());
+
+    if (isCanceled())
+    {
+        return NULL;
+    }
+
+    sceneBuffer = buildSceneBuffer();
+    if (sceneBuffer == NULL)
+    {
+        return NULL;
+    }
+
+    interpretation = new Interpretation();
+    interpretation->segments = m_segments;
+    interpretation->minimumExtents = m_minimumExtents;
+    interpretation->maximumExtents = m_maximumExtents;
+    interpretation->sceneBuffer = sceneBuffer;
+
+    return interpretation;
+}
+
+bool QGLPathScene::Interpreter::isCanceled() const
+{
+    return (m_job->canceled.loadAcquire() != 0);
+}
+
+void QGLPathScene::Interpreter::resetActiveOffsets()
+{
+    Position clearOffset;
+    clearOffset.x = 0.0;
+    clearOffset.y = 0.0;
+    clearOffset.z = 0.0;
+    clearOffset.a = 0.0;
+    clearOffset.b = 0.0;
+    clearOffset.c = 0.0;
+    clearOffset.u = 0.0;
+    clearOffset.v = 0.0;
+    clearOffset.w = 0.0;
+
+    m_activeOffsets.g92Offset = clearOffset;
+    m_activeOffsets.toolOffset = clearOffset;
+    m_activeOffsets.g5xOffsets.clear();
+    for (int i = 0; i < 9; ++i)
+    {
+        m_activeOffsets.g5xOffsets.append(clearOffset);
+    }
+    m_activeOffsets.g5xOffsetIndex = 1;
+}
+
+void QGLPathScene::Interpreter::resetCurrentPosition()
+{
+    m_currentPosition.x = 0.0;
+    m_currentPosition.y = 0.0;
+    m_currentPosition.z = 0.0;
+    m_currentPosition.a = 0.0;
+    m_currentPosition.b = 0.0;
+    m_currentPosition.c = 0.0;
+    m_currentPosition.u = 0.0;
+    m_currentPosition.v = 0.0;
+    m_currentPosition.w = 0.0;
+}
+
+void QGLPathScene::Interpreter::updateExtents(const QVector3D &vector)
+{
+    if (vector.x() < m_minimumExtents.x()) {
+        m_minimumExtents.setX(vector.x());
+    }
+    if (vector.y() < m_minimumExtents.y()) {
+        m_minimumExtents.setY(vector.y());
+    }
+    if (vector.z() < m_minimumExtents.z()) {
+        m_minimumExtents.setZ(vector.z());
+    }
+    if (vector.x() > m_maximumExtents.x()) {
+        m_maximumExtents.setX(vector.x());
+    }
+    if (vector.y() > m_maximumExtents.y()) {
+        m_maximumExtents.setY(vector.y());
+    }
+    if (vector.z() > m_maximumExtents.z()) {
+        m_maximumExtents.setZ(vector.z());
+    }
+}
+
+void QGLPathScene::Interpreter::processPreview(const pb::Preview &preview)
+{
+    switch (preview.type())
+    {
+    case pb::PV_STRAIGHT_PROBE:  /*nothing*/ return;
+    case pb::PV_RIGID_TAP:  /*nothing*/ return;
+    case pb::PV_STRAIGHT_FEED: processStraightMove(preview, FeedMove); return;
+    case pb::PV_ARC_FEED: processArcFeed(preview); return;
+    case pb::PV_STRAIGHT_TRAVERSE: processStraightMove(preview, TraverseMove); return;
+    case pb::PV_SET_G5X_OFFSET: processSetG5xOffset(preview); return;
+    case pb::PV_SET_G92_OFFSET: processSetG92Offset(preview); return;
+    case pb::PV_SET_XY_ROTATION: /*nothing*/ return;
+    case pb::PV_SELECT_PLANE: processSelectPlane(preview); return;
+    case pb::PV_SET_TRAVERSE_RATE: /*nothing*/ return;
+    case pb::PV_SET_FEED_RATE: /*nothing*/ return;
+    case pb::PV_CHANGE_TOOL: /*nothing*/ return;
+    case pb::PV_CHANGE_TOOL_NUMBER: /*nothing*/ return;
+    case pb::PV_DWELL: /*nothing*/ return;
+    case pb::PV_MESSAGE: /*nothing*/ return;
+    case pb::PV_COMMENT: /*nothing*/ return;
+    case pb::PV_USE_TOOL_OFFSET: processUseToolOffset(preview); return;
+    case pb::PV_SET_PARAMS: /*nothing*/ return;
+    case pb::PV_SET_FEED_MODE: /*nothing*/ return;
+    case pb::PV_SOURCE_CONTEXT: /*nothing*/ return;
+    }
+}
+
+void QGLPathScene::Interpreter::processStraightMove(const pb::Preview &preview, MovementType movementType)
+{
+#ifdef QT_DEBUG
+    if (movementType == FeedMove)
+    {
+        qDebug() << "straight feed";
+    }
+    else
+    {
+        qDebug() << "straight traverse";
+    }
+#endif
+
+    Position newPosition;
+    QVector3D currentVector;
+    QVector3D newVector;
+
+    newPosition = calculateNewPosition(preview.pos());
+    currentVector = positionToVector3D(m_currentPosition);
+    newVector = positionToVector3D(newPosition);
+
+    appendSegment(Line, movementType, currentVector, m_segments.lineVectors.size());
+    m_segments.lineVectors.append(newVector - currentVector);
+
+    m_currentPosition = newPosition;
+
+    updateExtents(newVector);
+}
+
+void QGLPathScene::Interpreter::processArcFeed(const pb::Preview &preview)
+{
+#ifdef QT_DEBUG
+    qDebug() << "arc feed";
+#endif
+
+    Position newPosition;
+    QVector3D currentVector;
+    QVector3D newVector;
+    QVector2D startPoint;
+    QVector2D endPoint;
+    QVector2D centerPoint;
+    QVector2D startVector;
+    QVector2D endVector;
+    double startAngle;
+    double endAngle;
+    double helixOffset;
+    bool anticlockwise;
+    double radius;
+    ArcParameters arcParameters;
+
+    currentVector = positionToVector3D(m_currentPosition);
+    newPosition = calculateNewPosition(preview.pos());
+
+    if (m_activePlane == XYPlane)
+    {
+        newPosition.x = preview.first_end();
+        newPosition.y = preview.second_end();
+        newPosition.z = preview.axis_end_point();
+        newVector = positionToVector3D(newPosition);
+
+        startPoint.setX(currentVector.x());
+        startPoint.setY(currentVector.y());
+
+        helixOffset = newVector.z() - currentVector.z();
+    }
+    else if (m_activePlane == YZPlane)
+    {
+        newPosition.y = preview.first_end();
+        newPosition.z = preview.second_end();
+        newPosition.x = preview.axis_end_point();
+        newVector = positionToVector3D(newPosition);
+
+        startPoint.setX(currentVector.y());
+        startPoint.setY(currentVector.z());
+
+        helixOffset = newVector.x() - currentVector.x();
+    }
+    else if (m_activePlane == XZPlane)
+    {
+        newPosition.x = preview.first_end();
+        newPosition.z = preview.second_end();
+        newPosition.y = preview.axis_end_point();
+        newVector = positionToVector3D(newPosition);
+
+        startPoint.setX(currentVector.x());
+        startPoint.setY(currentVector.z());
+
+        helixOffset = newVector.y() - currentVector.y();
+    }
+    else
+    {
+        return; // not supported
+    }
+
+    endPoint.setX(preview.first_end());
+    endPoint.setY(preview.second_end());
+    centerPoint.setX(preview.first_axis());
+    centerPoint.setY(preview.second_axis());
+    startVector = startPoint - centerPoint;
+    endVector = endPoint - centerPoint;
+
+    startAngle = qAtan2(startVector.y(), startVector.x());
+    if (startAngle < 0) {
+        startAngle += 2 * M_PI;
+    }
+    endAngle = qAtan2(endVector.y(), endVector.x());
+    if (startAngle < 0) {
+        endAngle += 2 * M_PI;
+    }
+    anticlockwise = preview.rotation() >= 0;
+    if (anticlockwise) {
+        startAngle += 2.0 * M_PI * (qAbs((double)preview.rotation())-1.0);  // for rotation > 1 increase the endAngle
+    }
+    else {
+        endAngle -= 2.0 * M_PI * (qAbs((double)preview.rotation())-1.0);  // for rotation > 1 decrease the startAngle
+    }
+
+    radius = centerPoint.distanceToPoint(startPoint);
+
+    // calculate the extents of the arc
+    double firstAngle;
+    double secondAngle;
+    // when viewed on the unit-circle
+    bool point1 = false;    // phi=0        right
+    bool point2 = false;    // phi=pi/2     top
+    bool point3 = false;    // phi=pi       left
+    bool point4 = false;    // phi=3pi/2    bottom
+
+    if (anticlockwise) {
+        firstAngle = endAngle;
+        secondAngle = startAngle;
+    }
+    else {
+        firstAngle = startAngle;
+        secondAngle = endAngle;
+    }
+
+    if (secondAngle > firstAngle) {
+        secondAngle = 2.0 * M_PI - secondAngle;
+    }
+
+    if ((firstAngle > 0.0) && (secondAngle < 0.0)) {
+        point1 = true;
+    }
+    if (((firstAngle > M_PI_2) && (secondAngle < M_PI_2)) || (secondAngle < -3.0*M_PI_2)) {
+        point2 = true;
+    }
+    if (((firstAngle > M_PI) && (secondAngle < M_PI)) || (secondAngle < -M_PI)) {
+        point3 = true;
+    }
+    if (((firstAngle > 3.0*M_PI_2) && (secondAngle < 3.0*M_PI_2)) || (secondAngle < -M_PI_2)) {
+        point4 = true;
+    }
+
+    updateExtents(newVector);
+    if (m_activePlane == XYPlane)   // centerPoint: X is X, Y is Y
+    {
+        if (point1) {
+            updateExtents(QVector3D(centerPoint.x() + radius,
+                                    centerPoint.y(),
+                                    currentVector.z()));
+        }
+        if (point2) {
+            updateExtents(QVector3D(centerPoint.x(),
+                                    centerPoint.y() + radius,
+                                    currentVector.z()));
+        }
+        if (point3) {
+            updateExtents(QVector3D(centerPoint.x() - radius,
+                                    centerPoint.y(),
+                                    currentVector.z()));
+        }
+        if (point4) {
+            updateExtents(QVector3D(centerPoint.x(),
+                                    centerPoint.y() - radius,
+                                    currentVector.z()));
+        }
+    }
+    else if (m_activePlane == XZPlane)  // centerPoint: X is X, Y is Z
+    {
+        if (point1) {
+            updateExtents(QVector3D(centerPoint.x() + radius,
+                                    currentVector.y(),
+                                    centerPoint.y()));
+        }
+        if (point2) {
+            updateExtents(QVector3D(centerPoint.x(),
+                                    currentVector.y(),
+                                    centerPoint.y() + radius));
+        }
+        if (point3) {
+            updateExtents(QVector3D(centerPoint.x() - radius,
+                                    currentVector.y(),
+                                    centerPoint.y()));
+        }
+        if (point4) {
+            updateExtents(QVector3D(centerPoint.x(),
+                                    currentVector.y(),
+                                    centerPoint.y() - radius));
+        }
+    }
+    else if (m_activePlane == YZPlane)  // centerPoint: X is Y, Y is Z
+    {
+        if (point1) {
+            updateExtents(QVector3D(currentVector.x(),
+                                    centerPoint.x() + radius,
+                                    centerPoint.y()));
+        }
+        if (point2) {
+            updateExtents(QVector3D(currentVector.x(),
+                                    centerPoint.x(),
+                                    centerPoint.y() + radius));
+        }
+        if (point3) {
+            updateExtents(QVector3D(currentVector.x(),
+                                    centerPoint.x() - radius,
+                                    centerPoint.y()));
+        }
+        if (point4) {
+            updateExtents(QVector3D(currentVector.x(),
+                                    centerPoint.x(),
+                                    centerPoint.y() - radius));
+        }
+    }
+
+    arcParameters.rotationPlane = m_activePlane;
+    arcParameters.center = (centerPoint - startPoint);
+    arcParameters.radius = radius;
+    arcParameters.helixOffset = helixOffset;
+    arcParameters.startAngle = startAngle;
+    arcParameters.endAngle = endAngle;
+    arcParameters.anticlockwise = anticlockwise;
+    appendSegment(Arc, FeedMove, currentVector, m_segments.arcs.size());
+    m_segments.arcs.append(arcParameters);
+
+    m_currentPosition = newPosition;
+}
+
+void QGLPathScene::Interpreter::processSetG5xOffset(const pb::Preview &preview)
+{
+    if (preview.has_pos()) {
+        m_activeOffsets.g5xOffsets.replace(preview.g5_index(), previewPositionToPosition(preview.pos()));
+    }
+}
+
+void QGLPathScene::Interpreter::processSetG92Offset(const pb::Preview &preview)
+{
+    if (preview.has_pos()) {
+        m_activeOffsets.g92Offset = previewPositionToPosition(preview.pos());
+    }
+}
+
+void QGLPathScene::Interpreter::processUseToolOffset(const pb::Preview &preview)
+{
+    if (preview.has_pos()) {
+        m_activeOffsets.toolOffset = previewPositionToPosition(preview.pos());
+    }
+}
+
+void QGLPathScene::Interpreter::processSelectPlane(const pb::Preview &preview)
+{
+    if (preview.has_plane())
+    {
+        switch (preview.plane())
+        {
+        case 1: m_activePlane = XYPlane; break;
+        case 2: m_activePlane = YZPlane; break;
+        case 3: m_activePlane = XZPlane; break;
+        case 4: m_activePlane = UVPlane; break;
+        case 5: m_activePlane = VWPlane; break;
+        case 6: m_activePlane = WUPlane; break;
+        default: break;
+        }
+    }
+}
+
+QGLPathScene::Position QGLPathScene::Interpreter::previewPositionToPosition(const pb::Position &position) const
+{
+    Position newPosition;
+    newPosition.x = 0.0;
+    newPosition.y = 0.0;
+    newPosition.z = 0.0;
+    newPosition.a = 0.0;
+    newPosition.b = 0.0;
+    newPosition.c = 0.0;
+    newPosition.u = 0.0;
+    newPosition.v = 0.0;
+    newPosition.w = 0.0;
+
+    if (position.has_x()) {
+        newPosition.x = position.x();
+    }
+    if (position.has_y()) {
+        newPosition.y = position.y();
+    }
+    if (position.has_z()) {
+        newPosition.z = position.z();
+    }
+    if (position.has_a()) {
+        newPosition.a = position.a();
+    }
+    if (position.has_b()) {
+        newPosition.b = position.b();
+    }
+    if (position.has_c()) {
+        newPosition.c = position.c();
+    }
+    if (position.has_u()) {
+        newPosition.u = position.u();
+    }
+    if (position.has_v()) {
+        newPosition.v = position.v();
+    }
+    if (position.has_w()) {
+        newPosition.w = position.w();
+    }
+
+    return newPosition;
+}
+
+QGLPathScene::Position QGLPathScene::Interpreter::calculateNewPosition(const pb::Position &newPosition) const
+{
+    Position position = m_currentPosition;
+
+    if (newPosition.has_x()) {
+        position.x = m_activeOffsets.g92Offset.x;
+        position.x += m_activeOffsets.g5xOffsets.at(m_activeOffsets.g5xOffsetIndex-1).x;
+        position.x += m_activeOffsets.toolOffset.x;
+        position.x += newPosition.x();
+    }
+
+    if (newPosition.has_y()) {
+        position.y = m_activeOffsets.g92Offset.y;
+        position.y += m_activeOffsets.g5xOffsets.at(m_activeOffsets.g5xOffsetIndex-1).y;
+        position.y += m_activeOffsets.toolOffset.y;
+        position.y += newPosition.y();
+    }
+
+    if (newPosition.has_z()) {
+        position.z = m_activeOffsets.g92Offset.z;
+        position.z += m_activeOffsets.g5xOffsets.at(m_activeOffsets.g5xOffsetIndex-1).z;
+        position.z += m_activeOffsets.toolOffset.z;
+        position.z += newPosition.z();
+    }
+
+    if (newPosition.has_a()) {
+        position.a = m_activeOffsets.g92Offset.a;
+        position.a += m_activeOffsets.g5xOffsets.at(m_activeOffsets.g5xOffsetIndex-1).a;
+        position.a += m_activeOffsets.toolOffset.a;
+        position.a += newPosition.a();
+    }
+    if (newPosition.has_b()) {
+        position.b = m_activeOffsets.g92Offset.b;
+        position.b += m_activeOffsets.g5xOffsets.at(m_activeOffsets.g5xOffsetIndex-1).b;
+        position.b += m_activeOffsets.toolOffset.b;
+        position.b += newPosition.b();
+    }
+    if (newPosition.has_c()) {
+        position.c = m_activeOffsets.g92Offset.c;
+        position.c += m_activeOffsets.g5xOffsets.at(m_activeOffsets.g5xOffsetIndex-1).c;
+        position.c += m_activeOffsets.toolOffset.c;
+        position.c += newPosition.c();
+    }
+    if (newPosition.has_u()) {
+        position.u = m_activeOffsets.g92Offset.u;
+        position.u += m_activeOffsets.g5xOffsets.at(m_activeOffsets.g5xOffsetIndex-1).u;
+        position.u += m_activeOffsets.toolOffset.u;
+        position.u += newPosition.u();
+    }
+    if (newPosition.has_v()) {
+        position.v = m_activeOffsets.g92Offset.v;
+        position.v += m_activeOffsets.g5xOffsets.at(m_activeOffsets.g5xOffsetIndex-1).v;
+        position.v += m_activeOffsets.toolOffset.v;
+        position.v += newPosition.v();
+    }
+    if (newPosition.has_w()) {
+        position.w = m_activeOffsets.g92Offset.w;
+        position.w += m_activeOffsets.g5xOffsets.at(m_activeOffsets.g5xOffsetIndex-1).w;
+        position.w += m_activeOffsets.toolOffset.w;
+        position.w += newPosition.w();
+    }
+
+    return position;
+}
+
+QVector3D QGLPathScene::Interpreter::positionToVector3D(const QGLPathScene::Position &position) const
+{
+    return QVector3D(position.x, position.y, position.z);
+}
+
+void QGLPathScene::Interpreter::appendSegment(PathType pathType, MovementType movementType, const QVector3D &position, int parameter)
+{
+    m_segments.pathTypes.append((quint8)pathType);
+    m_segments.movementTypes.append((quint8)movementType);
+    m_segments.rows.append(m_currentRow);
+    m_segments.positions.append(position);
+    m_segments.parameters.append(parameter);
+}
+
+void QGLPathScene::drawPath()
+{
+    Job *job;
+
+    if (m_model == NULL)
+    {
+        return;
+    }
+
+    cancelJob();    // a new reset makes the running interpretation obsolete
+
+    // the preview table is only shared, the worker does the interpretation
+    job = new Job();
+    job->previews = m_model->previewTable();
+    job->arcFeedColor = m_arcFeedColor;
+    job->straightFeedColor = m_straightFeedColor;
+    job->traverseColor = m_traverseColor;
+    job->backplotArcFeedColor = m_backplotArcFeedColor;
+    job->backplotStraightFeedColor = m_backplotStraightFeedColor;
+    job->backplotTraverseColor = m_backplotTraverseColor;
+
+    // the previous interpretation stays published until the new one is finished
+    m_job = job;
+    m_jobWatcher->setFuture(QtConcurrent::run(&QGLPathScene::runJob, job));
+    m_progressTimer->start();
+    setProgress(0.0);
+}
+
+void QGLPathScene::jobFinished()
+{
+    Interpretation *interpretation;
+
+    if (m_job == NULL)
+    {
+        return;
+    }
+
+    interpretation = m_jobWatcher->result();
+    delete m_job;
+    m_job = NULL;
+    m_progressTimer->stop();
+
+    if (interpretation != NULL)
+    {
+        // everything is replaced at once, users never see segments and geometry of different programs
+        delete m_sceneBuffer;
+        m_segments = interpretation->segments;
+        m_sceneBuffer = interpretation->sceneBuffer;
+        m_minimumExtents = interpretation->minimumExtents;
+        m_maximumExtents = interpretation->maximumExtents;
+        delete interpretation;
+
+        emit segmentsChanged();
+        emit sceneBufferChanged();
+    }
+
+    setProgress(1.0);
+}
+
+void QGLPathScene::updateProgress()
+{
+    int processedRows;
+
+    if ((m_job == NULL) || (m_job->previews.rowOffsets.size() <= 1))
+    {
+        return;
+    }
+
+    processedRows = m_job->processedRows.loadAcquire();
+    setProgress((double)processedRows / (double)(m_job->previews.rowOffsets.size() - 1));
+}
+
+void QGLPathScene::setProgress(double progress)
+{
+    if (m_progress != progress)
+    {
+        m_progress = progress;
+        emit progressChanged(m_progress);
+    }
+}
+
+void QGLPathScene::cancelJob()
+{
+    Interpretation *interpretation;
+
+    if (m_job == NULL)
+    {
+        return;
+    }
+
+    // the worker checks the flag after every row, so waiting is short
+    m_job->canceled.storeRelease(1);
+    m_jobWatcher->waitForFinished();
+    interpretation = m_jobWatcher->result();
+    if (interpretation != NULL)
+    {
+        delete interpretation->sceneBuffer;
+        delete interpretation;
+    }
+    delete m_job;
+    m_job = NULL;
+    m_progressTimer->stop();
+}
+
+QGLPathScene::Interpretation *QGLPathScene::runJob(Job *job)
+{
+    Interpreter interpreter(job);
+
+    return interpreter.run();
+}
+
+QGLSceneBuffer *QGLPathScene::Interpreter::buildSceneBuffer() const
+{
+    QGLSceneBuffer *sceneBuffer = new QGLSceneBuffer();
+
+    // exactly one path is recorded per segment, so handles can be matched by index
+    for (int i = 0; i < m_segments.pathTypes.size(); ++i)
+    {
+        int parameter = m_segments.parameters.at(i);
+
+        if (((i % 4096) == 0) && isCanceled())
+        {
+            delete sceneBuffer;
+            return NULL;
+        }
+
+        if (m_segments.pathTypes.at(i) == Line)
+        {
+            if (m_segments.movementTypes.at(i) == FeedMove)
+            {
+                sceneBuffer->color(m_job->straightFeedColor);
+                sceneBuffer->backplotColor(m_job->backplotStraightFeedColor);
+            }
+            else
+            {
+                sceneBuffer->color(m_job->traverseColor);
+                sceneBuffer->backplotColor(m_job->backplotTraverseColor);
+                sceneBuffer->lineStipple(true, 1.0);
+            }
+            sceneBuffer->translate(m_segments.positions.at(i));
+            sceneBuffer->line(m_segments.lineVectors.at(parameter));
+        }
+        else
+        {
+            const ArcParameters &arcParameters = m_segments.arcs.at(parameter);
+            sceneBuffer->color(m_job->arcFeedColor);
+            sceneBuffer->backplotColor(m_job->backplotArcFeedColor);
+            sceneBuffer->translate(m_segments.positions.at(i));
+            if (arcParameters.rotationPlane == XZPlane) {
+                sceneBuffer->rotate(90, QVector3D(1, 0, 0));
+            }
+            else if  (arcParameters.rotationPlane == YZPlane) {
+                sceneBuffer->rotate(-90, QVector3D(0, 1, 0));
+            }
+            sceneBuffer->arc(arcParameters.center.x(),
+                             arcParameters.center.y(),
+                             arcParameters.radius,
+                             arcParameters.startAngle,
+                             arcParameters.endAngle,
+                             arcParameters.anticlockwise,
+                             arcParameters.helixOffset);
+        }
+    }
+
+    // the simplified levels are built here as well, huge programs are drawn coarser when far away
+    sceneBuffer->buildLevels();
+
+    return sceneBuffer;
+}
+
+void QGLPathScene::modelDestroyed()
+{
+    // a new model may be created at the same address, it must not find this scene
+    cancelJob();
+    s_scenes.removeOne(this);
+    m_model = NULL;
+}
@@ -0,0 +1,228 @@
+/****************************************************************************
+**
+** Copyright (C) 2014 Alexander Rössler
+** License: LGPL version 2.1
+**
+** This file is part of QtQuickVcp.
+**
+** All rights reserved. This program and the accompanying materials
+** are made available under the terms of the GNU Lesser General Public License
+** (LGPL) version 2.1 which accompanies this distribution, and is available at
+** http://www.gnu.org/licenses/lgpl-2.1.html
+**
+** This library is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+** Lesser General Public License for more details.
+**
+** Contributors:
+** Alexander Rössler @ The Cool Tool GmbH <mail DOT aroessler AT gmail DOT com>
+**
+****************************************************************************/
+#ifndef QGLPATHSCENE_H
+#define QGLPATHSCENE_H
+
+#include <QObject>
+#include <QColor>
+#include <QFutureWatcher>
+#include <QAtomicInt>
+#include <QTimer>
+#include <QVector2D>
+#include <QVector3D>
+#include "qglscenebuffer.h"
+#include "qgcodeprogrammodel.h"
+#include "preview.pb.h"
+
+// interpreted preview of a program model, shared by all path items that show
+// the same model so the interpretation and the scene buffer exist only once for
+// any number of views. Every view still packs the scene buffer into its own line
+// store and GL buffers, see QGLView::sceneBuffer().
+class QGLPathScene : public QObject
+{
+    Q_OBJECT
+
+public:
+    enum PathType {
+        Line,
+        Arc
+    };
+
+    enum MovementType {
+        FeedMove,
+        TraverseMove
+    };
+
+    enum Plane {
+        XYPlane,
+        XZPlane,
+        YZPlane,
+        UVPlane,
+        WUPlane,
+        VWPlane
+    };
+
+    // returns the scene of the model recorded with the given colors, the scene is created on first use
+    static QGLPathScene *acquire(QGCodeProgramModel *model, const QColor &arcFeedColor,
+                                 const QColor &straightFeedColor, const QColor &traverseColor,
+                                 const QColor &backplotArcFeedColor, const QColor &backplotStraightFeedColor,
+                                 const QColor &backplotTraverseColor);
+    // the scene is deleted once the last user released it
+    static void release(QGLPathScene *scene);
+
+    QGCodeProgramModel *model() const;
+    int segmentCount() const;
+    PathType segmentPathType(int segment) const;
+    MovementType segmentMovementType(int segment) const;
+    int segmentRow(int segment) const;      // model row the segment was interpreted from
+    int rowSegmentBegin(int row) const;     // segments of a row are [begin, end)
+    int rowSegmentEnd(int row) const;
+    const QGLSceneBuffer *sceneBuffer() const;    // NULL until the first interpretation is finished
+    QVector3D minimumExtents() const;
+    QVector3D maximumExtents() const;
+    double progress() const;    // of the running interpretation, 1.0 when idle
+
+signals:
+    void segmentsChanged();     // the segments were replaced, the previous indexes are invalid
+    void sceneBufferChanged();  // the geometry of the current segments is ready
+    void progressChanged(double progress);
+
+private:
+    struct Position {
+        double x;
+        double y;
+        double z;
+        double a;
+        double b;
+        double c;
+        double u;
+        double v;
+        double w;
+    };
+
+    struct Offsets {
+        Position g92Offset;
+        Position toolOffset;
+        QList<Position> g5xOffsets;
+        int g5xOffsetIndex;
+    };
+
+    typedef struct {
+        QVector2D center;       // relative to the start point
+        float radius;
+        float startAngle;
+        float endAngle;
+        float helixOffset;      // offset from the rotation axis
+        bool anticlockwise;
+        quint8 rotationPlane;
+    } ArcParameters;
+
+    // path segments stored column wise and addressed by their index,
+    // the columns are implicitly shared so a copy can be handed to the scene build
+    typedef struct {
+        QVector<quint8> pathTypes;
+        QVector<quint8> movementTypes;
+        QVector<int> rows;
+        QVector<QVector3D> positions;       // start point
+        QVector<int> parameters;            // index into lineVectors or arcs, depending on the path type
+        QVector<QVector3D> lineVectors;
+        QVector<ArcParameters> arcs;
+        QVector<int> rowOffsets;            // first segment of each row and the end of the last row
+    } Segments;
+
+    // snapshot of the model and the settings for one interpretation
+    typedef struct {
+        QGCodeProgramModel::PreviewTable previews;  // implicitly shared with the model
+        QColor arcFeedColor;
+        QColor straightFeedColor;
+        QColor traverseColor;
+        QColor backplotArcFeedColor;
+        QColor backplotStraightFeedColor;
+        QColor backplotTraverseColor;
+        QAtomicInt canceled;
+        QAtomicInt processedRows;
+    } Job;
+
+    // result of a job, published to the scene in one piece
+    typedef struct {
+        Segments segments;
+        QVector3D minimumExtents;
+        QVector3D maximumExtents;
+        QGLSceneBuffer *sceneBuffer;
+    } Interpretation;
+
+    // interprets the preview records of a job, runs on a worker thread
+    class Interpreter {
+    public:
+        explicit Interpreter(Job *job);
+
+        Interpretation *run();  // NULL if the job was canceled
+
+    private:
+        Job *m_job;
+        Offsets m_activeOffsets;
+        Position m_currentPosition;
+        Plane m_activePlane;
+        Segments m_segments;
+        int m_currentRow;
+        QVector3D m_minimumExtents;
+        QVector3D m_maximumExtents;
+
+        bool isCanceled() const;
+        void resetActiveOffsets();
+        void resetCurrentPosition();
+        void updateExtents(const QVector3D &vector);
+        void processPreview(const pb::Preview &preview);
+        void processStraightMove(const pb::Preview &preview, MovementType movementType);
+        void processArcFeed(const pb::Preview &preview);
+        void processSetG5xOffset(const pb::Preview &preview);
+        void processSetG92Offset(const pb::Preview &preview);
+        void processUseToolOffset(const pb::Preview &preview);
+        void processSelectPlane(const pb::Preview &preview);
+        Position previewPositionToPosition(const pb::Position &position) const;
+        Position calculateNewPosition(const pb::Position &newPosition) const;
+        QVector3D positionToVector3D(const Position &position) const;
+        void appendSegment(PathType pathType, MovementType movementType, const QVector3D &position, int parameter);
+        QGLSceneBuffer *buildSceneBuffer() const;   // NULL if the job was canceled
+    };
+
+    explicit QGLPathScene(QGCodeProgramModel *model, const QColor &arcFeedColor,
+                          const QColor &straightFeedColor, const QColor &traverseColor,
+                          const QColor &backplotArcFeedColor, const QColor &backplotStraightFeedColor,
+                          const QColor &backplotTraverseColor);
+    ~QGLPathScene();
+
+    static QList<QGLPathScene*> s_scenes;
+
+    QGCodeProgramModel *m_model;
+    QColor m_arcFeedColor;
+    QColor m_straightFeedColor;
+    QColor m_traverseColor;
+    QColor m_backplotArcFeedColor;
+    QColor m_backplotStraightFeedColor;
+    QColor m_backplotTraverseColor;
+    int m_users;
+
+    // published interpretation, only replaced on the GUI thread
+    Segments m_segments;
+    QGLSceneBuffer *m_sceneBuffer;  // recorded geometry of m_segments
+    QVector3D m_minimumExtents;
+    QVector3D m_maximumExtents;
+
+    // running interpretation
+    Job *m_job;     // NULL when idle
+    QFutureWatcher<Interpretation*> *m_jobWatcher;
+    QTimer *m_progressTimer;
+    double m_progress;
+
+    void cancelJob();
+    void setProgress(double progress);
+    static Interpretation *runJob(Job *job);
+
+private slots:
+    void drawPath();
+    void jobFinished();
+    void updateProgress();
+    void modelDestroyed();
+};
+
+#endif // QGLPATHSCENE_H
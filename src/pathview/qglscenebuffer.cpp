@@ -0,0 +1,339 @@
+/****************************************************************************
+**
+** Copyright (C) 2014 Alexander Rössler
+** License: LGPL version 2.1
+**
+** This file is part of QtQuickVcp.
+**
+** All rights reserved. This program and the accompanying materials
+** are made available under the terms of the GNU Lesser General Public License
+** (LGPL) version 2.1 which accompanies this distribution, and is available at
+** http://www.gnu.org/licenses/lgpl-2.1.html
+**
+** This library is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+** Lesser General Public License for more details.
+**
+** Contributors:
+** Alexander Rössler @ The Cool Tool GmbH <mail DOT aroessler AT gmail DOT com>
+**
+****************************************************************************/
+
+#include "qglscenebuffer.h"
+#include <QtCore/qmath.h>
+#include <QStack>
+#include <QPair>
+
+static const int MinLevelChunkPaths = 8;    // shorter chunks are always drawn at full detail
+static const int MaxLevelChunkPaths = 256;  // paths of one chunk, the level is selected per chunk
+
+QGLSceneBuffer::QGLSceneBuffer():
+    m_color(QColor(Qt::yellow)),
+    m_width(1.0),
+    m_stipple(false),
+    m_stippleLength(1.0)
+{
+}
+
+void QGLSceneBuffer::color(const QColor &color)
+{
+    m_color = color;
+}
+
+void QGLSceneBuffer::backplotColor(const QColor &color)
+{
+    m_backplotColor = color;
+}
+
+void QGLSceneBuffer::lineWidth(float width)
+{
+    m_width = width;
+}
+
+void QGLSceneBuffer::lineStipple(bool enable, float length)
+{
+    m_stipple = enable;
+    m_stippleLength = length;
+}
+
+void QGLSceneBuffer::translate(const QVector3D &vector)
+{
+    m_modelMatrix.translate(vector);
+}
+
+void QGLSceneBuffer::rotate(float angle, const QVector3D &axis)
+{
+    m_modelMatrix.rotate(angle, axis);
+}
+
+void QGLSceneBuffer::resetTransformations()
+{
+    m_color = QColor(Qt::yellow);
+    m_backplotColor = QColor();
+    m_width = 1.0;
+    m_stipple = false;
+    m_stippleLength = 1.0;
+    m_modelMatrix.setToIdentity();
+}
+
+int QGLSceneBuffer::line(const QVector3D &vector)
+{
+    QVector<QVector3D> points;
+    int index;
+
+    points.append(QVector3D(0.0, 0.0, 0.0));
+    points.append(vector);
+    index = appendPath(points);
+    resetTransformations();
+
+    return index;
+}
+
+int QGLSceneBuffer::arc(float x, float y, float radius, float startAngle, float endAngle, bool anticlockwise, float helixOffset)
+{
+    Arc arc;
+    Path path;
+    float totalAngle = qAbs(endAngle - startAngle);
+
+    arc.modelMatrix = m_modelMatrix;
+    arc.x = x;
+    arc.y = y;
+    arc.radius = radius;
+    arc.startAngle = startAngle;
+    arc.sweepAngle = anticlockwise ? totalAngle : -totalAngle;
+    arc.helixOffset = helixOffset;
+
+    path = createPath();
+    path.origin = m_modelMatrix.map(QVector3D(qCos(startAngle) * radius + x, qSin(startAngle) * radius + y, 0.0));
+    path.arc = m_arcs.size();
+    m_arcs.append(arc);
+    m_paths.append(path);
+    resetTransformations();
+
+    return m_paths.size() - 1;
+}
+
+int QGLSceneBuffer::pathCount() const
+{
+    return m_paths.size();
+}
+
+const QGLSceneBuffer::Path &QGLSceneBuffer::path(int index) const
+{
+    return m_paths.at(index);
+}
+
+const QVector<QVector3D> &QGLSceneBuffer::vertices() const
+{
+    return m_vertices;
+}
+
+const QGLSceneBuffer::Arc &QGLSceneBuffer::arc(int index) const
+{
+    return m_arcs.at(index);
+}
+
+QGLSceneBuffer::Path QGLSceneBuffer::createPath() const
+{
+    Path path;
+
+    path.first = m_vertices.size();
+    path.count = 0;
+    path.origin = m_modelMatrix.map(QVector3D(0.0, 0.0, 0.0));
+    path.color = m_color;
+    path.backplotColor = m_backplotColor;
+    path.width = m_width;
+    path.stippleLength = m_stipple ? m_stippleLength : 0.0;
+    path.arc = -1;
+
+    return path;
+}
+
+int QGLSceneBuffer::appendPath(const QVector<QVector3D> &points)
+{
+    Path path = createPath();
+    int segmentCount = qMax(points.size() - 1, 0);
+
+    path.count = segmentCount * 2;
+
+    // line strips are split into GL_LINES pairs
+    m_vertices.reserve(m_vertices.size() + path.count);
+    for (int i = 0; i < segmentCount; ++i)
+    {
+        m_vertices.append(m_modelMatrix.map(points.at(i)));
+        m_vertices.append(m_modelMatrix.map(points.at(i + 1)));
+    }
+
+    m_paths.append(path);
+
+    return m_paths.size() - 1;
+}
+
+void QGLSceneBuffer::buildLevels()
+{
+    int first = 0;
+
+    m_levelChunks.clear();
+    m_levelVertices.clear();
+    m_levelVertexPaths.clear();
+
+    // chunks end at arcs, at style changes like feed to traverse moves and at gaps between the paths
+    while (first < m_paths.size())
+    {
+        int end = first + 1;
+
+        if ((m_paths.at(first).arc != -1) || (m_paths.at(first).count != 2))
+        {
+            first++;
+            continue;
+        }
+
+        while ((end < m_paths.size()) && ((end - first) < MaxLevelChunkPaths)
+               && continuesPath(m_paths.at(end - 1), m_paths.at(end)))
+        {
+            end++;
+        }
+
+        if ((end - first) >= MinLevelChunkPaths)
+        {
+            appendLevelChunk(first, end);
+        }
+        first = end;
+    }
+}
+
+int QGLSceneBuffer::levelChunkCount() const
+{
+    return m_levelChunks.size();
+}
+
+const QGLSceneBuffer::LevelChunk &QGLSceneBuffer::levelChunk(int index) const
+{
+    return m_levelChunks.at(index);
+}
+
+const QVector<QVector3D> &QGLSceneBuffer::levelVertices() const
+{
+    return m_levelVertices;
+}
+
+const QVector<int> &QGLSceneBuffer::levelVertexPaths() const
+{
+    return m_levelVertexPaths;
+}
+
+float QGLSceneBuffer::levelTolerance(int level)
+{
+    // 0.01, 0.04, 0.16 and 0.64 machine units
+    return 0.01f * (float)(1 << (2 * level));
+}
+
+bool QGLSceneBuffer::continuesPath(const QGLSceneBuffer::Path &previousPath, const QGLSceneBuffer::Path &path) const
+{
+    return (path.arc == -1)
+            && (path.count == 2)
+            && (path.color == previousPath.color)
+            && (path.backplotColor == previousPath.backplotColor)
+            && (path.width == previousPath.width)
+            && (path.stippleLength == previousPath.stippleLength)
+            && (m_vertices.at(previousPath.first + 1) == m_vertices.at(path.first));
+}
+
+void QGLSceneBuffer::appendLevelChunk(int firstPath, int endPath)
+{
+    QVector<QVector3D> points;
+    QVector<bool> keep;
+    LevelChunk levelChunk;
+    int previousCount;
+
+    // the paths of a chunk form one polyline
+    points.reserve(endPath - firstPath + 1);
+    for (int i = firstPath; i < endPath; ++i)
+    {
+        points.append(m_vertices.at(m_paths.at(i).first));
+    }
+    points.append(m_vertices.at(m_paths.at(endPath - 1).first + 1));
+
+    levelChunk.firstPath = firstPath;
+    levelChunk.pathCount = endPath - firstPath;
+    previousCount = levelChunk.pathCount * 2;
+    for (int level = 0; level < LevelCount; ++level)
+    {
+        int previousPoint = 0;
+
+        levelChunk.levelFirst[level] = m_levelVertices.size();
+        levelChunk.levelCount[level] = 0;
+
+        simplifyPolyline(points, levelTolerance(level), keep);
+        if ((keep.count(true) - 1) * 2 >= previousCount)
+        {
+            continue;   // not coarser than the previous level
+        }
+
+        for (int i = 1; i < points.size(); ++i)
+        {
+            if (keep.at(i))
+            {
+                m_levelVertices.append(points.at(previousPoint));
+                m_levelVertices.append(points.at(i));
+                m_levelVertexPaths.append(firstPath + previousPoint);
+                m_levelVertexPaths.append(firstPath + i - 1);
+                previousPoint = i;
+            }
+        }
+        levelChunk.levelCount[level] = m_levelVertices.size() - levelChunk.levelFirst[level];
+        previousCount = levelChunk.levelCount[level];
+    }
+
+    m_levelChunks.append(levelChunk);
+}
+
+void QGLSceneBuffer::simplifyPolyline(const QVector<QVector3D> &points, float tolerance, QVector<bool> &keep)
+{
+    QStack<QPair<int, int> > ranges;
+
+    // Douglas-Peucker, the farthest point of a range is kept until all points are within the tolerance
+    keep.fill(false, points.size());
+    keep[0] = true;
+    keep[points.size() - 1] = true;
+    ranges.push(qMakePair(0, points.size() - 1));
+    while (!ranges.isEmpty())
+    {
+        QPair<int, int> range = ranges.pop();
+        float maximumDistance = tolerance;
+        int farthestPoint = -1;
+
+        for (int i = (range.first + 1); i < range.second; ++i)
+        {
+            float distance = segmentDistance(points.at(i), points.at(range.first), points.at(range.second));
+            if (distance > maximumDistance)
+            {
+                maximumDistance = distance;
+                farthestPoint = i;
+            }
+        }
+
+        if (farthestPoint != -1)
+        {
+            keep[farthestPoint] = true;
+            ranges.push(qMakePair(range.first, farthestPoint));
+            ranges.push(qMakePair(farthestPoint, range.second));
+        }
+    }
+}
+
+float QGLSceneBuffer::segmentDistance(const QVector3D &point, const QVector3D &start, const QVector3D &end)
+{
+    QVector3D direction = end - start;
+    float lengthSquared = direction.lengthSquared();
+    float t;
+
+    if (lengthSquared == 0.0f)
+    {
+        return (point - start).length();
+    }
+
+    t = qBound(0.0f, QVector3D::dotProduct(point - start, direction) / lengthSquared, 1.0f);
+    return (point - (start + direction * t)).length();
+}
@@ -0,0 +1,117 @@
+/****************************************************************************
+**
+** Copyright (C) 2014 Alexander Rössler
+** License: LGPL version 2.1
+**
+** This file is part of QtQuickVcp.
+**
+** All rights reserved. This program and the accompanying materials
+** are made available under the terms of the GNU Lesser General Public License
+** (LGPL) version 2.1 which accompanies this distribution, and is available at
+** http://www.gnu.org/licenses/lgpl-2.1.html
+**
+** This library is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+** Lesser General Public License for more details.
+**
+** Contributors:
+** Alexander Rössler @ The Cool Tool GmbH <mail DOT aroessler AT gmail DOT com>
+**
+****************************************************************************/
+
+#ifndef QGLSCENEBUFFER_H
+#define QGLSCENEBUFFER_H
+
+#include <QColor>
+#include <QMatrix4x4>
+#include <QVector>
+#include <QVector3D>
+
+// line drawables recorded without a GL view, can be filled on any thread
+// and handed to QGLView::sceneBuffer() in one piece
+class QGLSceneBuffer
+{
+public:
+    typedef struct {
+        int first;              // first vertex, the vertices are stored as GL_LINES pairs
+        int count;
+        QVector3D origin;       // start point of the path, stipple distance is measured from here
+        QColor color;
+        QColor backplotColor;   // color once executed, invalid to keep the color
+        float width;
+        float stippleLength;    // 0.0 disables stippling
+        int arc;                // index of the arc, -1 if the path is stored as vertices
+    } Path;
+
+    // arcs are not tessellated, the GL view evaluates them on the GPU
+    typedef struct {
+        QMatrix4x4 modelMatrix; // plane and position of the arc
+        float x;                // center in the arc plane
+        float y;
+        float radius;
+        float startAngle;
+        float sweepAngle;       // negative for clockwise arcs
+        float helixOffset;
+    } Arc;
+
+    static const int LevelCount = 4;    // simplified levels of detail, the tolerance grows with the level
+
+    // consecutive connected line paths of the same style, simplified for distant views
+    typedef struct {
+        int firstPath;
+        int pathCount;
+        int levelFirst[LevelCount];     // first level vertex, stored as GL_LINES pairs
+        int levelCount[LevelCount];     // 0 if the level brings no reduction
+    } LevelChunk;
+
+    QGLSceneBuffer();
+
+    // same meaning as the functions of QGLView
+    void color(const QColor &color);
+    void backplotColor(const QColor &color);
+    void lineWidth(float width);
+    void lineStipple(bool enable, float length = 5.0);
+    void translate(const QVector3D &vector);
+    void rotate(float angle, const QVector3D &axis);
+    void resetTransformations();
+    int line(const QVector3D &vector);
+    int arc(float x, float y, float radius, float startAngle, float endAngle, bool anticlockwise, float helixOffset = 0.0);
+
+    int pathCount() const;
+    const Path &path(int index) const;
+    const QVector<QVector3D> &vertices() const;
+    const Arc &arc(int index) const;
+
+    // simplifies the recorded line paths, may be called on any thread once recording is done
+    void buildLevels();
+    int levelChunkCount() const;
+    const LevelChunk &levelChunk(int index) const;
+    const QVector<QVector3D> &levelVertices() const;
+    const QVector<int> &levelVertexPaths() const;
+    static float levelTolerance(int level);
+
+private:
+    QColor m_color;
+    QColor m_backplotColor;
+    float m_width;
+    bool m_stipple;
+    float m_stippleLength;
+    QMatrix4x4 m_modelMatrix;
+
+    QVector<Path> m_paths;
+    QVector<QVector3D> m_vertices;
+    QVector<Arc> m_arcs;
+    QVector<LevelChunk> m_levelChunks;
+    QVector<QVector3D> m_levelVertices;
+    QVector<int> m_levelVertexPaths;    // path of each level vertex, the backplot passes the levels with the paths
+
+    Path createPath() const;
+    int appendPath(const QVector<QVector3D> &points);
+    bool continuesPath(const Path &previousPath, const Path &path) const;
+    void appendLevelChunk(int firstPath, int endPath);
+    static void simplifyPolyline(const QVector<QVector3D> &points, float tolerance, QVector<bool> &keep);
+    static float segmentDistance(const QVector3D &point, const QVector3D &start, const QVector3D &end);
+};
+
+#endif // QGLSCENEBUFFER_H
@@ -24,7 +24,7 @@
 
 QGLSphereItem::QGLSphereItem(QQuickItem *parent) :
     QGLItem(parent),
-    m_spherePointer(NULL),
+    m_sphereHandle(0),
     m_radius(1.0),
     m_color(QColor(Qt::yellow)),
     m_selected(false)
@@ -42,20 +42,20 @@ void QGLSphereItem::paint(QGLView *glView)
     glView->reset();
     glView->beginUnion();
     glView->color(m_color);
-    m_spherePointer = glView->sphere(m_radius);
+    m_sphereHandle = glView->sphere(m_radius);
     glView->endUnion();
 }
 
-void QGLSphereItem::selectDrawable(void *pointer)
+void QGLSphereItem::selectDrawable(QGLDrawableHandle handle)
 {
     bool selected;
 
-    if (m_spherePointer == NULL)
+    if (m_sphereHandle == 0)
     {
         return;
     }
 
-    selected = (pointer == m_spherePointer);
+    selected = (handle == m_sphereHandle);
 
     if (selected != m_selected)
     {
@@ -58,7 +58,7 @@ signals:
     void selectedChanged(bool arg);
 
 public slots:
-    virtual void selectDrawable(void *pointer);
+    virtual void selectDrawable(QGLDrawableHandle handle);
 
     void setRadius(float arg)
     {
@@ -77,7 +77,7 @@ public slots:
     }
 
 private:
-    void *m_spherePointer;
+    QGLDrawableHandle m_sphereHandle;
     float m_radius;
     QColor m_color;
     bool m_selected;
@@ -21,23 +21,93 @@
 ****************************************************************************/
 
 #include "qglview.h"
+#include "qglviewrenderer.h"
 
 #include <QtQuick/qquickwindow.h>
 #include <QtGui/QOpenGLShaderProgram>
 #include <QtGui/QOpenGLContext>
+#include <QtGui/QOpenGLFramebufferObject>
+#include <QtGui/QFontMetricsF>
 #include <QtCore/qmath.h>
 #include <QDateTime>
+#include <QThread>
+#include <QDebug>
+
+static const int MaxLeafDrawables = 32;    // maximum number of line drawables in a leaf of the hierarchy
+static const int RenderSamples = 4;        // multisampling of the render target, resolved by QQuickFramebufferObject
+static const int SelectionSize = 5;        // size of the picked region, only odd sizes make sense
+static const int ParametersStackSize = 16;  // preallocated nesting depth of unions
+static const int HoverTolerance = 5;       // maximum distance in pixels between cursor and hovered line
+static const int MaxArcSegments = 256;     // segments of the shared segment buffer, the most one arc is drawn with
+static const qreal ArcTolerance = 0.5;     // maximum distance in pixels between an arc and its segments
+static const int PickArcSegments = 64;     // segments per revolution used for hover picking of arcs
+static const int ModelLevelCount = 4;      // round models are meshed with 8, 16, 32 and 64 segments
+static const int MinModelDetail = 8;
+static const qreal ModelTolerance = 0.5;   // maximum distance in pixels between a round model and its facets
+static const int AsyncUploadSize = 4 * 1024 * 1024; // line stores of at least this many bytes are uploaded by the upload thread
+static const qreal LineLevelTolerance = 1.0;         // maximum distance in pixels between a simplified level and its paths
+static const qreal InteractionLevelTolerance = 3.0;  // same while the camera is moving
+static const float DefaultVertexResolution = 0.001f;    // quantization step of line vertices, 1 um in scene units of mm
 
 QGLView::QGLView(QQuickItem *parent)
-    : QQuickPaintedItem(parent)
+    : QQuickFramebufferObject(parent)
     , m_initialized(false)
     , m_modelProgram(0)
     , m_lineProgram(0)
     , m_textProgram(0)
+    , m_arcProgram(0)
+    , m_selectionFramebuffer(0)
     , m_projectionAspectRatio(1.0)
+    , m_drawArraysInstanced(NULL)
+    , m_drawElementsInstanced(NULL)
+    , m_vertexAttribDivisor(NULL)
     , m_backgroundColor(QColor(Qt::black))
+    , m_thread_lightAttenuation(0.0)
+    , m_thread_lightAmbientCoefficient(0.0)
+    , m_thread_lightEnabled(false)
+    , m_dirtyFlags(NotDirty)
+    , m_thread_dirtyFlags(NotDirty)
+    , m_updatePending(false)
+    , m_framesRendered(0)
+    , m_framesSkipped(0)
+    , m_thread_framesRendered(0)
+    , m_frameStatisticsChanged(false)
+    , m_adaptiveQuality(false)
+    , m_interactionTimeout(300)
+    , m_interactionRenderScale(0.5)
+    , m_interacting(false)
+    , m_thread_interacting(false)
+    , m_thread_interactionRenderScale(1.0)
+    , m_vertexResolution(DefaultVertexResolution)
+    , m_thread_vertexResolution(DefaultVertexResolution)
+    , m_renderFramebuffer(NULL)
+    , m_layerCacheFramebuffer(NULL)
+    , m_layerCacheValid(false)
+    , m_paintLayers(AllLayers)
+    , m_thread_dynamicTypes(0)
+    , m_viewChanged(false)
+    , m_linePool(Line)
+    , m_textPool(Text)
+    , m_arcPool(Arc)
+    , m_lineGeometryChanged(false)
+    , m_lineColorDirtyFirst(-1)
+    , m_lineColorDirtyLast(-1)
+    , m_lineLevelColorDirtyFirst(-1)
+    , m_lineLevelColorDirtyLast(-1)
+    , m_lineLevelChunkPool(LevelChunk)
+    , m_uploadSurface(NULL)
+    , m_uploadThread(NULL)
+    , m_bufferUploader(NULL)
+    , m_lineUploadJob(NULL)
     , m_pathEnabled(false)
-    , m_selectionModeActive(false)
+    , m_parametersStackDepth(1)
+    , m_glyphTexture(0)
+    , m_textGeometryChanged(false)
+    , m_arcInstancesChanged(false)
+    , m_selectionRequested(false)
+    , m_thread_selectionModeActive(false)
+    , m_pickDataChanged(false)
+    , m_hoveredDrawable(0)
     , m_currentGlItem(NULL)
     , m_propertySignalMapper(new QSignalMapper(this))
     , m_camera(new QGLCamera(this))
@@ -48,17 +118,19 @@ QGLView::QGLView(QQuickItem *parent)
     connect(this, SIGNAL(windowChanged(QQuickWindow*)), this, SLOT(handleWindowChanged(QQuickWindow*)));
     connect(this, SIGNAL(childrenChanged()), this, SLOT(updateChildren()));
     connect(m_propertySignalMapper, SIGNAL(mapped(QObject*)), this, SLOT(updateItem(QObject*)));
-    //connect(this, SIGNAL(initialized()), this, SLOT(updateItems()), Qt::QueuedConnection);
 
-    setRenderTarget(QQuickPaintedItem::InvertedYFramebufferObject);
-    setMipmap(true);
-    //setAntialiasing(true);
+    // the renderer sizes the render target itself, it is scaled down while interacting
+    setTextureFollowsItemSize(false);
+    m_interactionTimer.setSingleShot(true);
+    connect(&m_interactionTimer, SIGNAL(timeout()), this, SLOT(interactionFinished()));
+    //connect(this, SIGNAL(initialized()), this, SLOT(updateItems()), Qt::QueuedConnection);
 }
 
 QGLView::~QGLView()
 {
-    clearDrawables();
-    qDeleteAll(m_drawableMap);
+    qDeleteAll(m_modelPoolMap);
+    qDeleteAll(m_drawableListMap);
+    delete m_uploadSurface;
 }
 
 void QGLView::setBackgroundColor(const QColor &t)
@@ -67,31 +139,88 @@ void QGLView::setBackgroundColor(const QColor &t)
         return;
     m_backgroundColor = t;
     emit backgroundColorChanged();
-    update();
+    invalidate(ViewDirty);
+}
+
+void QGLView::setAdaptiveQuality(bool adaptiveQuality)
+{
+    if (adaptiveQuality == m_adaptiveQuality)
+        return;
+    m_adaptiveQuality = adaptiveQuality;
+    emit adaptiveQualityChanged(adaptiveQuality);
+
+    if (!m_adaptiveQuality && m_interacting)
+    {
+        m_interactionTimer.stop();
+        interactionFinished();
+    }
+}
+
+void QGLView::setInteractionTimeout(int interactionTimeout)
+{
+    if (interactionTimeout == m_interactionTimeout)
+        return;
+    m_interactionTimeout = interactionTimeout;
+    emit interactionTimeoutChanged(interactionTimeout);
+}
+
+void QGLView::setInteractionRenderScale(qreal interactionRenderScale)
+{
+    interactionRenderScale = qBound(0.1, interactionRenderScale, 1.0);
+    if (interactionRenderScale == m_interactionRenderScale)
+        return;
+    m_interactionRenderScale = interactionRenderScale;
+    emit interactionRenderScaleChanged(interactionRenderScale);
+
+    if (m_interacting)
+    {
+        invalidate(ViewDirty);
+    }
+}
+
+void QGLView::setVertexResolution(qreal vertexResolution)
+{
+    if ((vertexResolution <= 0.0) || (vertexResolution == m_vertexResolution))
+        return;
+    m_vertexResolution = vertexResolution;
+    emit vertexResolutionChanged(vertexResolution);
+    invalidate(ViewDirty);  // the line store is quantized again in the next sync
 }
 
 void QGLView::readPixel(int x, int y)
 {
-    m_selectionPoint = QPoint(x, window()->height() - y);
-    m_selectionModeActive = true;
-    update();
+    m_selectionPoint = QPoint(x, this->height() - y);
+    m_selectionRequested = true;
+    invalidate(SelectionDirty);
+}
+
+void QGLView::hoverPixel(int x, int y)
+{
+    QGLDrawableHandle handle = pickLine(QPointF(x, y));
+
+    if (handle != m_hoveredDrawable)
+    {
+        m_hoveredDrawable = handle;
+        emit drawableHovered(handle);
+    }
 }
 
 void QGLView::handleWindowChanged(QQuickWindow *win)
 {
     if (win) {
-        // Connect the beforeRendering signal to our paint function.
-        // Since this call is executed on the rendering thread it must be
-        // a Qt::DirectConnection
-        connect(win, SIGNAL(beforeSynchronizing()), this, SLOT(sync()), Qt::DirectConnection);
+        // sync and paint are driven by the renderer on the rendering thread
         connect(this, SIGNAL(widthChanged()), this, SLOT(updatePerspectiveAspectRatio()));
         connect(this, SIGNAL(heightChanged()), this, SLOT(updatePerspectiveAspectRatio()));
 
         updatePerspectiveAspectRatio(); // set current aspect ratio since signals will only be handled on change
 
-        // If we allow QML to do the clearing, they would clear what we paint
-        // and nothing would show.
-        //win->setClearBeforeRendering(true);
+        // the surface of the upload context must be created on the gui thread
+        if (m_uploadSurface == NULL)
+        {
+            m_uploadSurface = new QOffscreenSurface();
+            m_uploadSurface->setFormat(win->requestedFormat());
+            m_uploadSurface->create();
+        }
     }
 }
 
@@ -124,22 +253,58 @@ void QGLView::updatePerspectiveAspectRatio()
 
 void QGLView::updateViewMatrix()
 {
-    m_viewMatrix = m_camera->modelViewMatrix();
+    QMatrix4x4 viewMatrix = m_camera->modelViewMatrix();
+
+    if (viewMatrix == m_viewMatrix) {
+        return;
+    }
+    m_viewMatrix = viewMatrix;
 
     if (m_initialized) {
-        update();
+        startInteraction();
+        invalidate(ViewDirty);
     }
 }
 
 void QGLView::updateProjectionMatrix()
 {
-    m_projectionMatrix = m_camera->projectionMatrix(m_projectionAspectRatio);
+    QMatrix4x4 projectionMatrix = m_camera->projectionMatrix(m_projectionAspectRatio);
+
+    if (projectionMatrix == m_projectionMatrix) {
+        return;
+    }
+    m_projectionMatrix = projectionMatrix;
 
     if (m_initialized) {
-        update();
+        startInteraction();
+        invalidate(ViewDirty);
+    }
+}
+
+void QGLView::interactionFinished()
+{
+    if (!m_interacting)
+    {
+        return;
+    }
+
+    m_interacting = false;
+    emit interactingChanged(false);
+    invalidate(ViewDirty);  // render the last view again in full quality
+}
+
+void QGLView::updateLight()
+{
+    if (m_initialized) {
+        invalidate(ViewDirty);
     }
 }
 
+void QGLView::lineUploadFinished()
+{
+    invalidate(ItemsDirty); // the next frame swaps in the uploaded buffers
+}
+
 void QGLView::updateItems()
 {
     if (!m_initialized) {
@@ -147,7 +312,7 @@ void QGLView::updateItems()
     }
 
     updateGLItems();
-    update();
+    invalidate(ItemsDirty);
 }
 
 void QGLView::updateItem(QObject *item)
@@ -158,7 +323,24 @@ void QGLView::updateItem(QObject *item)
     }
 
     updateGLItem(static_cast<QGLItem*>(item));
-    update();
+    invalidate(ItemsDirty);
+}
+
+void QGLView::invalidate(DirtyFlag flag)
+{
+    m_dirtyFlags |= flag;
+
+    // the scene graph renders at most once per vsync, one request is enough
+    if (!m_updatePending)
+    {
+        m_updatePending = true;
+        update();
+    }
+    else
+    {
+        m_framesSkipped++;
+        m_frameStatisticsChanged = true;
+    }
 }
 
 void QGLView::updateChildren()
@@ -196,69 +378,108 @@ void QGLView::updateChildren()
     }
 }
 
-void QGLView::addDrawableList(QGLView::ModelType type)
+int QGLView::drawableCount(QGLView::ModelType type) const
 {
-    QList<Parameters*> *parametersList = new QList<Parameters*>();
-    m_drawableMap.insert(type, parametersList);
+    switch (type)
+    {
+    case Line:
+        return m_linePool.size();
+    case Text:
+        return m_textPool.size();
+    case Arc:
+        return m_arcPool.size();
+    default:
+        if (m_modelPoolMap.contains(type))
+        {
+            return m_modelPoolMap.value(type)->size();
+        }
+        return 0;
+    }
 }
 
-QList<QGLView::Parameters *> *QGLView::getDrawableList(QGLView::ModelType type)
+QGLDrawableHandle QGLView::addDrawableData(const QGLView::LineParameters &parameters)
 {
-    return m_drawableMap.value(type);
-}
+    QGLDrawableHandle handle;
+    LineParameters *lineParameters;
 
-QGLView::Parameters* QGLView::addDrawableData(const QGLView::LineParameters &parameters)
-{
     // add parameter
-    QList<Parameters*> *parametersList = m_drawableMap.value(Line);
-    LineParameters *lineParameters = new LineParameters(parameters);
-    lineParameters->creator = m_currentGlItem;
-    parametersList->append(lineParameters);
+    handle = m_linePool.append(parameters);
+    lineParameters = &m_linePool[m_linePool.size() - 1];
+    lineParameters->type = Line;
+    appendLineVertices(lineParameters);
+    if (!m_modifiedLineItems.contains(m_currentGlItem))
+    {
+        m_modifiedLineItems.append(m_currentGlItem);
+    }
 
     // add drawable to list
-    Drawable drawable;
-    drawable.type = Line;
-    drawable.parameters = lineParameters;
-    m_currentDrawableList->append(drawable);
+    m_currentDrawableList->append(handle);
+
+    return handle;
+}
+
+QGLDrawableHandle QGLView::addDrawableData(const QGLView::TextParameters &parameters)
+{
+    QGLDrawableHandle handle;
+
+    handle = m_textPool.append(parameters);
+    m_textPool[m_textPool.size() - 1].type = Text;
+    m_textGeometryChanged = true;
 
-    return lineParameters;
+    m_currentDrawableList->append(handle);
+
+    return handle;
 }
 
-QGLView::Parameters* QGLView::addDrawableData(const QGLView::TextParameters &parameters)
+QGLDrawableHandle QGLView::addDrawableData(const QGLView::ArcParameters &parameters)
 {
-    QList<Parameters*> *parametersList = m_drawableMap.value(Text);
-    TextParameters *textParameters = new TextParameters(parameters);
-    textParameters->creator = m_currentGlItem;
-    parametersList->append(textParameters);
+    QGLDrawableHandle handle;
+    ArcParameters *arcParameters;
+
+    handle = m_arcPool.append(parameters);
+    arcParameters = &m_arcPool[m_arcPool.size() - 1];
+    arcParameters->type = Arc;
+    arcParameters->item = m_currentGlItem;
 
-    Drawable drawable;
-    drawable.type = Text;
-    drawable.parameters = textParameters;
-    m_currentDrawableList->append(drawable);
+    // the largest scale of the transformation, the segment count must not be too low
+    arcParameters->worldRadius = 0.0;
+    for (int i = 0; i < 3; ++i)
+    {
+        qreal scale = arcParameters->modelMatrix.column(i).toVector3D().length();
+        arcParameters->worldRadius = qMax(arcParameters->worldRadius, (GLfloat)(scale * arcParameters->radius));
+    }
+    appendArcInstance(*arcParameters);
+    m_pickDataChanged = true;
 
-    return textParameters;
+    m_currentDrawableList->append(handle);
+
+    return handle;
 }
 
-QGLView::Parameters* QGLView::addDrawableData(QGLView::ModelType type, const QGLView::Parameters &parameters)
+QGLDrawableHandle QGLView::addDrawableData(QGLView::ModelType type, const QGLView::Parameters &parameters)
 {
-    QList<Parameters*> *parametersList = m_drawableMap.value(type);
-    Parameters *modelParameters = new Parameters(parameters);
-    modelParameters->creator = m_currentGlItem;
-    parametersList->append(modelParameters);
+    QGLDrawablePool<Parameters> *modelPool = m_modelPoolMap.value(type);
+    QGLDrawableHandle handle;
+    Parameters *modelParameters;
+
+    handle = modelPool->append(parameters);
+    modelParameters = &(*modelPool)[modelPool->size() - 1];
+    modelParameters->type = type;
+    appendModelInstance(*modelParameters);
 
-    Drawable drawable;
-    drawable.type = type;
-    drawable.parameters = modelParameters;
-    m_currentDrawableList->append(drawable);
+    m_currentDrawableList->append(handle);
 
-    return modelParameters;
+    return handle;
 }
 
 void QGLView::drawDrawables(QGLView::ModelType type)
 {
     if (type == NoType)
     {
-        QMapIterator<ModelType, QList<Parameters*>* > i(m_drawableMap);
+        drawDrawables(Line);
+        drawDrawables(Arc);
+        drawDrawables(Text);
+        QMapIterator<ModelType, QGLDrawablePool<Parameters>* > i(m_modelPoolMap);
         while (i.hasNext()) {
             i.next();
             drawDrawables(i.key());
@@ -272,7 +493,10 @@ void QGLView::drawDrawables(QGLView::ModelType type)
         case Cylinder:
         case Cone:
         case Sphere:
-            drawModelVertices(type);
+            if (isLayerPainted(type))
+            {
+                drawModelVertices(type);
+            }
             break;
         case Text:
             drawTexts();
@@ -280,133 +504,411 @@ void QGLView::drawDrawables(QGLView::ModelType type)
         case Line:
             drawLines();
             break;
+        case Arc:
+            drawArcs();
+            break;
         default:
             return;
         }
     }
 }
 
-void QGLView::clearDrawables()
+void QGLView::clearDrawables(ModelType type)
 {
-    QMapIterator<ModelType, QList<Parameters*>* > i(m_drawableMap);
-    while (i.hasNext()) {
-        i.next();
-        QList<Parameters*> * parametersList = i.value();
-        for (int j = 0; j < i.value()->size(); ++j)
+    if (type == Line)
+    {
+        m_linePool.clear();
+        m_lineVertices.resize(0);
+        m_lineIndices.resize(0);
+        m_lineStagingVertices.resize(0);
+        m_lineColors.resize(0);
+        m_lineGroups.clear();
+        m_lineBatches.clear();
+        m_lineLevelChunkPool.clear();
+        m_dirtyLineLevelChunks.clear();
+        m_lineGeometryChanged = true;
+        m_lineColorDirtyFirst = -1;
+        m_lineColorDirtyLast = -1;
+        m_lineLevelColorDirtyFirst = -1;
+        m_lineLevelColorDirtyLast = -1;
+    }
+    else if (type == Text)
+    {
+        m_textPool.clear();
+        m_textVertices.resize(0);
+        m_textGeometryChanged = true;
+    }
+    else if (type == Arc)
+    {
+        m_arcPool.clear();
+        m_arcInstances.resize(0);
+        m_arcBounds.resize(0);
+        m_arcInstancesChanged = true;
+        m_pickDataChanged = true;
+    }
+    else if (m_modelPoolMap.contains(type))
+    {
+        ModelInstances *modelInstances = m_modelInstancesMap.value(type);
+
+        m_modelPoolMap.value(type)->clear();
+        modelInstances->instances.resize(0);
+        modelInstances->bounds.resize(0);
+        modelInstances->dirtyFirst = -1;
+        modelInstances->dirtyLast = -1;
+    }
+}
+
+void QGLView::removeDrawable(QGLDrawableHandle handle)
+{
+    ModelType type = (ModelType)drawableHandleType(handle);
+
+    if (type == Line)
+    {
+        if (m_linePool.remove(handle))
+        {
+            m_lineGeometryChanged = true;   // removed vertices are dropped when the store is packed
+        }
+    }
+    else if (type == Text)
+    {
+        if (m_textPool.remove(handle))
+        {
+            m_textGeometryChanged = true;
+        }
+    }
+    else if (type == Arc)
+    {
+        int index = m_arcPool.indexOf(handle);
+
+        if (index != -1)
+        {
+            m_arcPool.remove(handle);
+            removeArcInstance(index);
+            m_pickDataChanged = true;
+        }
+    }
+    else if (m_modelPoolMap.contains(type))
+    {
+        QGLDrawablePool<Parameters> *modelPool = m_modelPoolMap.value(type);
+        int index = modelPool->indexOf(handle);
+
+        if (index != -1)
         {
-            Parameters *parameters = parametersList->takeAt(j);
-            delete parameters;
+            modelPool->remove(handle);
+            removeModelInstance(type, index);
         }
     }
 }
 
-void QGLView::cleanupDrawables(ModelType type)
+void QGLView::removeDrawables(QGLItem *item)
 {
-    QList<Parameters*> * parametersList = m_drawableMap.value(type);
+    QVector<QGLDrawableHandle> *drawableList = m_drawableListMap.value(item);
+    QMap<ModelType, int> typeCounts;
 
-    for (int i = (parametersList->size()-1); i >= 0; i--)
+    for (int i = 0; i < drawableList->size(); ++i)
     {
-        Parameters *parameters = parametersList->at(i);
-        if (parameters->deleteFlag)
+        ModelType type = (ModelType)drawableHandleType(drawableList->at(i));
+        typeCounts[type] = typeCounts.value(type, 0) + 1;
+    }
+
+    // an item owning all drawables of a type frees the whole pool at once
+    QMapIterator<ModelType, int> i(typeCounts);
+    while (i.hasNext()) {
+        i.next();
+        if (i.value() == drawableCount(i.key()))
+        {
+            clearDrawables(i.key());
+        }
+        else
         {
-            delete parametersList->takeAt(i);
+            for (int j = (drawableList->size() - 1); j >= 0; j--)
+            {
+                if (drawableHandleType(drawableList->at(j)) == i.key())
+                {
+                    removeDrawable(drawableList->at(j));
+                }
+            }
         }
     }
+
+    if (typeCounts.contains(Line) && !m_modifiedLineItems.contains(item))
+    {
+        m_modifiedLineItems.append(item);
+    }
+
+    drawableList->resize(0);    // keeps the allocated memory for the next paint
+}
+
+void QGLView::updateFrustum(const QMatrix4x4 &projectionMatrix)
+{
+    calculateFrustumPlanes(projectionMatrix * m_thread_viewMatrix, m_frustumPlanes);
+}
+
+void QGLView::calculateFrustumPlanes(const QMatrix4x4 &matrix, QVector4D *planes) const
+{
+    QVector4D row0 = matrix.row(0);
+    QVector4D row1 = matrix.row(1);
+    QVector4D row2 = matrix.row(2);
+    QVector4D row3 = matrix.row(3);
+
+    // planes point to the inside of the view frustum
+    planes[0] = row3 + row0;   // left
+    planes[1] = row3 - row0;   // right
+    planes[2] = row3 + row1;   // bottom
+    planes[3] = row3 - row1;   // top
+    planes[4] = row3 + row2;   // near
+    planes[5] = row3 - row2;   // far
 }
 
-void QGLView::removeDrawables(QList<QGLView::Drawable> *drawableList)
+QGLView::CullResult QGLView::cullBoundingBox(const QGLView::BoundingBox &bounds, const QVector4D *planes) const
 {
-    QList<ModelType> types;
+    CullResult result = Inside;
 
-    for (int i = (drawableList->size() - 1); i >= 0; i--)
+    for (int i = 0; i < 6; ++i)
     {
-        Drawable drawable = drawableList->at(i);
-        drawable.parameters->deleteFlag = true; // mark for deletion
-        if (!types.contains(drawable.type)) {
-            types.append(drawable.type);
+        const QVector4D &plane = planes[i];
+        QVector3D positive;
+        QVector3D negative;
+
+        // corners of the box furthest along and against the plane normal
+        positive.setX((plane.x() >= 0.0) ? bounds.maximum.x() : bounds.minimum.x());
+        positive.setY((plane.y() >= 0.0) ? bounds.maximum.y() : bounds.minimum.y());
+        positive.setZ((plane.z() >= 0.0) ? bounds.maximum.z() : bounds.minimum.z());
+        negative.setX((plane.x() >= 0.0) ? bounds.minimum.x() : bounds.maximum.x());
+        negative.setY((plane.y() >= 0.0) ? bounds.minimum.y() : bounds.maximum.y());
+        negative.setZ((plane.z() >= 0.0) ? bounds.minimum.z() : bounds.maximum.z());
+
+        if ((QVector3D::dotProduct(plane.toVector3D(), positive) + plane.w()) < 0.0)
+        {
+            return Outside;
+        }
+        if ((QVector3D::dotProduct(plane.toVector3D(), negative) + plane.w()) < 0.0)
+        {
+            result = Intersecting;
         }
     }
 
-    for (int i = 0; i < types.size(); ++i) {
-        cleanupDrawables(types.at(i));
-    }
+    return result;
+}
 
-    drawableList->clear();
+void QGLView::expandBoundingBox(QGLView::BoundingBox *bounds, const QVector3D &point) const
+{
+    bounds->minimum.setX(qMin(bounds->minimum.x(), point.x()));
+    bounds->minimum.setY(qMin(bounds->minimum.y(), point.y()));
+    bounds->minimum.setZ(qMin(bounds->minimum.z(), point.z()));
+    bounds->maximum.setX(qMax(bounds->maximum.x(), point.x()));
+    bounds->maximum.setY(qMax(bounds->maximum.y(), point.y()));
+    bounds->maximum.setZ(qMax(bounds->maximum.z(), point.z()));
 }
 
-void QGLView::initializeVertexBuffer(ModelType type, const QVector<ModelVertex> &vertices)
+QGLView::BoundingBox QGLView::transformBoundingBox(const QGLView::BoundingBox &bounds, const QMatrix4x4 &matrix) const
 {
-    initializeVertexBuffer(type, vertices.data(), vertices.length() * sizeof(ModelVertex));
+    BoundingBox transformedBounds;
+
+    for (int i = 0; i < 8; ++i)
+    {
+        QVector3D corner((i & 1) ? bounds.maximum.x() : bounds.minimum.x(),
+                         (i & 2) ? bounds.maximum.y() : bounds.minimum.y(),
+                         (i & 4) ? bounds.maximum.z() : bounds.minimum.z());
+        corner = matrix.map(corner);
+
+        if (i == 0)
+        {
+            transformedBounds.minimum = corner;
+            transformedBounds.maximum = corner;
+        }
+        else
+        {
+            expandBoundingBox(&transformedBounds, corner);
+        }
+    }
+
+    return transformedBounds;
 }
 
-void QGLView::initializeVertexBuffer(ModelType type, const void *bufferData, int bufferLength)
+void QGLView::initializeModelBuffers(ModelType type)
 {
-    QOpenGLBuffer *glBuffer = new QOpenGLBuffer(QOpenGLBuffer::VertexBuffer);
-    glBuffer->create();
-    glBuffer->setUsagePattern(QOpenGLBuffer::StaticDraw);
-    glBuffer->bind();
-    glBuffer->allocate(bufferData, bufferLength);
-    glBuffer->release();
+    const ModelMesh &mesh = modelMesh(type);
+    QOpenGLBuffer *vertexBuffer = new QOpenGLBuffer(QOpenGLBuffer::VertexBuffer);
+    QOpenGLBuffer *indexBuffer = new QOpenGLBuffer(QOpenGLBuffer::IndexBuffer);
+
+    vertexBuffer->create();
+    vertexBuffer->setUsagePattern(QOpenGLBuffer::StaticDraw);
+    vertexBuffer->bind();
+    vertexBuffer->allocate(mesh.vertices.constData(), mesh.vertices.size() * sizeof(ModelVertex));
+    vertexBuffer->release();
+
+    // all levels share one index buffer, a level is selected by its index range
+    indexBuffer->create();
+    indexBuffer->setUsagePattern(QOpenGLBuffer::StaticDraw);
+    indexBuffer->bind();
+    indexBuffer->allocate(mesh.indices.constData(), mesh.indices.size() * sizeof(GLushort));
+    indexBuffer->release();
 
-    m_vertexBufferMap.insert(type, glBuffer);
+    m_vertexBufferMap.insert(type, vertexBuffer);
+    m_indexBufferMap.insert(type, indexBuffer);
 }
 
 void QGLView::setupVBOs()
 {
-    setupCube();
-    setupCylinder(1.0, QVector3D(0,0,0),
-                  1.0, QVector3D(0,0,1),
-                  16, Cylinder);
-    setupCylinder(1.0, QVector3D(0,0,0),
-                  0.0, QVector3D(0,0,1),
-                  16, Cone);
-    setupSphere(16);
+    initializeModelBuffers(Cube);
+    initializeModelBuffers(Cylinder);
+    initializeModelBuffers(Cone);
+    initializeModelBuffers(Sphere);
+    setupModelInstances(Cube);
+    setupModelInstances(Cylinder);
+    setupModelInstances(Cone);
+    setupModelInstances(Sphere);
     setupLineVertexBuffer();
     setupTextVertexBuffer();
+    setupArcVertexBuffer();
 }
 
-void QGLView::setupLineVertexBuffer()
+void QGLView::setupModelInstances(ModelType type)
+{
+    ModelInstances *modelInstances = new ModelInstances();
+    modelInstances->buffer = new QOpenGLBuffer(QOpenGLBuffer::VertexBuffer);
+    modelInstances->buffer->create();
+    modelInstances->buffer->setUsagePattern(QOpenGLBuffer::DynamicDraw);
+    modelInstances->dirtyFirst = -1;
+    modelInstances->dirtyLast = -1;
+
+    // bounds of the unit models created in the setup functions
+    switch (type)
+    {
+    case Cube:
+        modelInstances->modelBounds.minimum = QVector3D(0.0, 0.0, 0.0);
+        modelInstances->modelBounds.maximum = QVector3D(1.0, 1.0, 1.0);
+        break;
+    case Cylinder:
+    case Cone:
+        modelInstances->modelBounds.minimum = QVector3D(-1.0, -1.0, 0.0);
+        modelInstances->modelBounds.maximum = QVector3D(1.0, 1.0, 1.0);
+        break;
+    default:
+        modelInstances->modelBounds.minimum = QVector3D(-1.0, -1.0, -1.0);
+        modelInstances->modelBounds.maximum = QVector3D(1.0, 1.0, 1.0);
+    }
+
+    m_modelInstancesMap.insert(type, modelInstances);
+    m_modelPoolMap.insert(type, new QGLDrawablePool<Parameters>(type));
+}
+
+void QGLView::setupInstancing()
 {
-    const int MaxLinesPerPath = 100;
+    QOpenGLContext *context = QOpenGLContext::currentContext();
+    QSurfaceFormat format = context->format();
+    QByteArray suffix;
+
+    // instanced drawing is core in OpenGL 3.3 and OpenGL ES 3.0, older versions need an extension
+    if (((format.renderableType() == QSurfaceFormat::OpenGLES) && (format.majorVersion() >= 3))
+        || (format.majorVersion() > 3)
+        || ((format.majorVersion() == 3) && (format.minorVersion() >= 3)))
+    {
+        suffix = "";
+    }
+    else if (context->hasExtension("GL_ARB_instanced_arrays"))
+    {
+        suffix = "ARB";
+    }
+    else if (context->hasExtension("GL_ANGLE_instanced_arrays"))
+    {
+        suffix = "ANGLE";
+    }
+    else if (context->hasExtension("GL_EXT_instanced_arrays"))
+    {
+        suffix = "EXT";
+    }
+    else
+    {
+        return; // not supported, drawModelVertices falls back to one draw call per instance
+    }
+
+    m_drawArraysInstanced = reinterpret_cast<DrawArraysInstancedFunction>(context->getProcAddress(QByteArray("glDrawArraysInstanced") + suffix));
+    m_drawElementsInstanced = reinterpret_cast<DrawElementsInstancedFunction>(context->getProcAddress(QByteArray("glDrawElementsInstanced") + suffix));
+    m_vertexAttribDivisor = reinterpret_cast<VertexAttribDivisorFunction>(context->getProcAddress(QByteArray("glVertexAttribDivisor") + suffix));
+
+    if ((m_drawArraysInstanced == NULL) || (m_drawElementsInstanced == NULL) || (m_vertexAttribDivisor == NULL))
+    {
+        m_drawArraysInstanced = NULL;
+        m_drawElementsInstanced = NULL;
+        m_vertexAttribDivisor = NULL;
+    }
+}
 
+void QGLView::setupLineVertexBuffer()
+{
+    // the buffer is allocated when the line vertex store is packed
     m_lineVertexBuffer = new QOpenGLBuffer(QOpenGLBuffer::VertexBuffer);
     m_lineVertexBuffer->create();
     m_lineVertexBuffer->setUsagePattern(QOpenGLBuffer::StaticDraw);
-    m_lineVertexBuffer->bind();
-    m_lineVertexBuffer->allocate(MaxLinesPerPath*sizeof(GLvector3D));
-    m_lineVertexBuffer->release();
+    m_lineIndexBuffer = new QOpenGLBuffer(QOpenGLBuffer::IndexBuffer);
+    m_lineIndexBuffer->create();
+    m_lineIndexBuffer->setUsagePattern(QOpenGLBuffer::StaticDraw);
+
+    // colors change with the program progress, they are kept in a separate buffer
+    m_lineColorBuffer = new QOpenGLBuffer(QOpenGLBuffer::VertexBuffer);
+    m_lineColorBuffer->create();
+    m_lineColorBuffer->setUsagePattern(QOpenGLBuffer::DynamicDraw);
+}
+
+void QGLView::setupBufferUploader()
+{
+    if ((m_uploadSurface == NULL) || !m_uploadSurface->isValid())
+    {
+        return; // everything is uploaded on the render thread
+    }
 
-    addDrawableList(Line);
+    m_bufferUploader = new QGLBufferUploader(QOpenGLContext::currentContext(), m_uploadSurface);
+    if (!m_bufferUploader->isValid())
+    {
+        delete m_bufferUploader;
+        m_bufferUploader = NULL;
+        return;
+    }
+
+    m_uploadThread = new QThread();
+    m_bufferUploader->moveToThread(m_uploadThread);
+    connect(m_bufferUploader, SIGNAL(jobFinished()),
+            this, SLOT(lineUploadFinished()), Qt::QueuedConnection);
+    m_uploadThread->start();
 }
 
 void QGLView::setupTextVertexBuffer()
 {
-    static const TextVertex vertices[] = {
-        {{0.0f, 1.0f, 0.0f}, {0.0f, 0.0f}},
-        {{0.0f, 0.0f, 0.0f}, {0.0f, 1.0f}},
-        {{1.0f, 1.0f, 0.0f}, {1.0f, 0.0f}},
-        {{0.0f, 0.0f, 0.0f}, {0.0f, 1.0f}},
-        {{1.0f, 0.0f, 0.0f}, {1.0f, 1.0f}},
-        {{1.0f, 1.0f, 0.0f}, {1.0f, 0.0f}},
-        {{1.0f, 1.0f, 0.0f}, {0.0f, 0.0f}},
-        {{1.0f, 0.0f, 0.0f}, {0.0f, 1.0f}},
-        {{0.0f, 1.0f, 0.0f}, {1.0f, 0.0f}},
-        {{1.0f, 0.0f, 0.0f}, {0.0f, 1.0f}},
-        {{0.0f, 0.0f, 0.0f}, {1.0f, 1.0f}},
-        {{0.0f, 1.0f, 0.0f}, {1.0f, 0.0f}},
-    };
-
+    // filled with the glyph quads of all texts
     m_textVertexBuffer = new QOpenGLBuffer(QOpenGLBuffer::VertexBuffer);
     m_textVertexBuffer->create();
-    m_textVertexBuffer->setUsagePattern(QOpenGLBuffer::StaticDraw);
-    m_textVertexBuffer->bind();
-    m_textVertexBuffer->allocate(vertices, sizeof(vertices));
-    m_textVertexBuffer->release();
+    m_textVertexBuffer->setUsagePattern(QOpenGLBuffer::DynamicDraw);
+}
+
+void QGLView::setupArcVertexBuffer()
+{
+    QVector<GLfloat> segments;
+
+    // end point indices of GL_LINES pairs, the shader divides them by the segment count of the draw call
+    segments.reserve(MaxArcSegments * 2);
+    for (int i = 0; i < MaxArcSegments; ++i)
+    {
+        segments.append(i);
+        segments.append(i + 1);
+    }
 
-    addDrawableList(Text);
+    m_arcSegmentBuffer = new QOpenGLBuffer(QOpenGLBuffer::VertexBuffer);
+    m_arcSegmentBuffer->create();
+    m_arcSegmentBuffer->setUsagePattern(QOpenGLBuffer::StaticDraw);
+    m_arcSegmentBuffer->bind();
+    m_arcSegmentBuffer->allocate(segments.constData(), segments.size() * sizeof(GLfloat));
+    m_arcSegmentBuffer->release();
+
+    // all arcs ordered by batch, rewritten only when the arc store changes
+    m_arcInstanceBuffer = new QOpenGLBuffer(QOpenGLBuffer::VertexBuffer);
+    m_arcInstanceBuffer->create();
+    m_arcInstanceBuffer->setUsagePattern(QOpenGLBuffer::DynamicDraw);
+    m_arcInstancesChanged = true;
 }
 
-void QGLView::setupCube()
+void QGLView::appendCubeLevel(ModelMesh *mesh)
 {
     static const ModelVertex vertices[] = {
         // Front face
@@ -457,10 +959,19 @@ void QGLView::setupCube()
         {{0.0f, 0.0f, 1.0f}, {0.0f, 0.0f, 0.0f}},
         {{0.0f, 0.0f, 0.0f}, {0.0f, 0.0f, 0.0f}}
     };
-
-    initializeVertexBuffer(Cube, vertices, sizeof(vertices));
-
-    addDrawableList(Cube);
+    ModelLevel level;
+    int vertexCount = sizeof(vertices) / sizeof(ModelVertex);
+
+    // the faces do not share normals, so each vertex is used once
+    level.firstIndex = mesh->indices.size();
+    level.indexCount = vertexCount;
+    level.detail = 0;
+    for (int i = 0; i < vertexCount; ++i)
+    {
+        mesh->indices.append(mesh->vertices.size());
+        mesh->vertices.append(vertices[i]);
+    }
+    mesh->levels.append(level);
 }
 
 void QGLView::setupShaders()
@@ -473,16 +984,17 @@ void QGLView::setupShaders()
 
     m_positionLocation = m_modelProgram->attributeLocation("position");
     m_normalLocation = m_modelProgram->attributeLocation("normal");
-    m_colorLocation = m_modelProgram->uniformLocation("color");
+    m_colorLocation = m_modelProgram->attributeLocation("color");
     m_lightPositionLocation = m_modelProgram->uniformLocation("light.position");
     m_lightIntensitiesLocation = m_modelProgram->uniformLocation("light.intensities");
     m_lightAttenuationLocation = m_modelProgram->uniformLocation("light.attenuation");
     m_lightAmbientCoefficientLocation = m_modelProgram->uniformLocation("light.ambientCoefficient");
     m_lightEnabledLocation = m_modelProgram->uniformLocation("light.enabled");
-    m_modelMatrixLocation = m_modelProgram->uniformLocation("modelMatrix");
+    m_modelMatrixLocation = m_modelProgram->attributeLocation("modelMatrix");
+    m_pickIdLocation = m_modelProgram->attributeLocation("pickId");
     m_viewMatrixLocation = m_modelProgram->uniformLocation("viewMatrix");
     m_projectionMatrixLocation = m_modelProgram->uniformLocation("projectionMatrix");
-    m_idColorLocation = m_modelProgram->uniformLocation("idColor");
+    m_idOffsetLocation = m_modelProgram->uniformLocation("idOffset");
     m_selectionModeLocation = m_modelProgram->uniformLocation("selectionMode");
 
     // line shader
@@ -492,12 +1004,17 @@ void QGLView::setupShaders()
     m_lineProgram->link();
 
     m_linePositionLocation = m_lineProgram->attributeLocation("position");
+    m_lineColorLocation = m_lineProgram->attributeLocation("color");
+    m_lineBackplotColorLocation = m_lineProgram->attributeLocation("backplotColor");
+    m_lineSequenceLocation = m_lineProgram->attributeLocation("sequence");
+    m_lineChunkOriginLocation = m_lineProgram->uniformLocation("chunkOrigin");
+    m_lineChunkStippleOriginLocation = m_lineProgram->uniformLocation("chunkStippleOrigin");
+    m_lineChunkStippleLengthLocation = m_lineProgram->uniformLocation("chunkStippleLength");
+    m_lineVertexResolutionLocation = m_lineProgram->uniformLocation("vertexResolution");
+    m_lineChunkSequenceOriginLocation = m_lineProgram->uniformLocation("chunkSequenceOrigin");
+    m_lineExecutedSequenceLocation = m_lineProgram->uniformLocation("executedSequence");
     m_lineProjectionMatrixLocation = m_lineProgram->uniformLocation("projectionMatrix");
     m_lineViewMatrixLocation = m_lineProgram->uniformLocation("viewMatrix");
-    m_lineModelMatrixLocation = m_lineProgram->uniformLocation("modelMatrix");
-    m_lineColorLocation = m_lineProgram->uniformLocation("color");
-    m_lineStippleLocation = m_lineProgram->uniformLocation("stipple");
-    m_lineStippleLengthLocation = m_lineProgram->uniformLocation("stippleLength");
     m_lineIdColorLocation = m_lineProgram->uniformLocation("idColor");
     m_lineSelectionModeLocation = m_lineProgram->uniformLocation("selectionMode");
 
@@ -509,32 +1026,56 @@ void QGLView::setupShaders()
 
     m_textPositionLocation = m_textProgram->attributeLocation("position");
     m_textTexCoordinateLocation = m_textProgram->attributeLocation("texCoordinate");
+    m_textColorLocation = m_textProgram->attributeLocation("color");
+    m_textPickIdLocation = m_textProgram->attributeLocation("pickId");
     m_textProjectionMatrixLocation = m_textProgram->uniformLocation("projectionMatrix");
     m_textViewMatrixLocation = m_textProgram->uniformLocation("viewMatrix");
-    m_textModelMatrixLocation = m_textProgram->uniformLocation("modelMatrix");
-    m_textColorLocation = m_textProgram->uniformLocation("color");
     m_textTextureLocation = m_textProgram->uniformLocation("texture");
-    m_textAspectRatioLocation = m_textProgram->uniformLocation("aspectRatio");
-    m_textAlignmentLocation = m_textProgram->uniformLocation("alignment");
-    m_textIdColorLocation = m_textProgram->uniformLocation("idColor");
+    m_textTextureScaleLocation = m_textProgram->uniformLocation("textureScale");
+    m_textIdOffsetLocation = m_textProgram->uniformLocation("idOffset");
     m_textSelectionModeLocation = m_textProgram->uniformLocation("selectionMode");
+
+    // arc shader
+    m_arcProgram = new QOpenGLShaderProgram();
+    m_arcProgram->addShaderFromSourceFile(QOpenGLShader::Vertex, ":/shaders/ArcVertexShader.glsl");
+    m_arcProgram->addShaderFromSourceFile(QOpenGLShader::Fragment, ":/shaders/ArcFragmentShader.glsl");
+    m_arcProgram->link();
+
+    m_arcSegmentLocation = m_arcProgram->attributeLocation("segment");
+    m_arcModelRowLocation[0] = m_arcProgram->attributeLocation("modelRow0");
+    m_arcModelRowLocation[1] = m_arcProgram->attributeLocation("modelRow1");
+    m_arcModelRowLocation[2] = m_arcProgram->attributeLocation("modelRow2");
+    m_arcLocation = m_arcProgram->attributeLocation("arc");
+    m_arcSweepLocation = m_arcProgram->attributeLocation("sweep");
+    m_arcColorLocation = m_arcProgram->attributeLocation("color");
+    m_arcBackplotColorLocation = m_arcProgram->attributeLocation("backplotColor");
+    m_arcSequenceLocation = m_arcProgram->attributeLocation("sequence");
+    m_arcProjectionMatrixLocation = m_arcProgram->uniformLocation("projectionMatrix");
+    m_arcViewMatrixLocation = m_arcProgram->uniformLocation("viewMatrix");
+    m_arcSegmentCountLocation = m_arcProgram->uniformLocation("segmentCount");
+    m_arcPixelScaleLocation = m_arcProgram->uniformLocation("pixelScale");
+    m_arcToleranceLocation = m_arcProgram->uniformLocation("arcTolerance");
+    m_arcIdOffsetLocation = m_arcProgram->uniformLocation("idOffset");
+    m_arcSelectionModeLocation = m_arcProgram->uniformLocation("selectionMode");
+    m_arcExecutedSequenceLocation = m_arcProgram->uniformLocation("executedSequence");
 }
 
 void QGLView::setupWindow()
 {
     connect(window()->openglContext(), SIGNAL(aboutToBeDestroyed()),
             this, SLOT(cleanup()), Qt::DirectConnection);
-
-    QSurfaceFormat format = window()->format();
-    format.setDepthBufferSize(24);
-    format.setSamples(4);
-    window()->setFormat(format);
 }
 
-void QGLView::setupCylinder(GLfloat r2, QVector3D P2, GLfloat r1, QVector3D P1, int detail, ModelType type)
+void QGLView::appendCylinderLevel(ModelMesh *mesh, GLfloat r2, QVector3D P2, GLfloat r1, QVector3D P1, int detail)
 {
-    QVector<ModelVertex> vertices;
     QVector3D normal;
+    QVector3D upVector(0,0,1);
+    QVector3D downVector(0,0,-1);
+    QVector3D resultVector;
+    ModelLevel level;
+    int first = mesh->vertices.size();
+    int topCenter;
+    int bottomCenter;
 
     // normal pointing from origin point to end point
     normal = P2 - P1;
@@ -555,22 +1096,17 @@ void QGLView::setupCylinder(GLfloat r2, QVector3D P2, GLfloat r1, QVector3D P1,
     perp.normalize();
     q.normalize();
 
-    // calculate vertices
+    // calculate vertices, one top and one bottom vertex per step around the circle
     GLfloat twoPi = 2 * M_PI;
     for (int i = 0; i < detail; ++i)
     {
-        GLfloat theta1 = (GLfloat)i / (GLfloat)detail * twoPi; // go around circle and get points
-        GLfloat theta2 = (GLfloat)(i+1) / (GLfloat)detail * twoPi;
-        ModelVertex vertex[6];
-
-        QVector3D upVector(0,0,1);
-        QVector3D downVector(0,0,-1);
-        QVector3D resultVector;
+        GLfloat theta = (GLfloat)i / (GLfloat)detail * twoPi; // go around circle and get points
+        ModelVertex vertex[2];
 
         // normals
-        normal.setX(qCos(theta1) * perp.x() + qSin(theta1) * q.x());
-        normal.setY(qCos(theta1) * perp.y() + qSin(theta1) * q.y());
-        normal.setZ(qCos(theta1) * perp.z() + qSin(theta1) * q.z());
+        normal.setX(qCos(theta) * perp.x() + qSin(theta) * q.x());
+        normal.setY(qCos(theta) * perp.y() + qSin(theta) * q.y());
+        normal.setZ(qCos(theta) * perp.z() + qSin(theta) * q.z());
 
         // top vertex
         vertex[0].position.x = P1.x() + r1 * normal.x();
@@ -581,7 +1117,6 @@ void QGLView::setupCylinder(GLfloat r2, QVector3D P2, GLfloat r1, QVector3D P1,
         vertex[0].normal.y = resultVector.y();
         vertex[0].normal.z = resultVector.z();
 
-
         // bottom vertex
         vertex[1].position.x = P2.x() + r2 * normal.x();
         vertex[1].position.y = P2.y() + r2 * normal.y();
@@ -591,74 +1126,68 @@ void QGLView::setupCylinder(GLfloat r2, QVector3D P2, GLfloat r1, QVector3D P1,
         vertex[1].normal.y = resultVector.y();
         vertex[1].normal.z = resultVector.z();
 
-        // normals
-        normal.setX(qCos(theta2) * perp.x() + qSin(theta2) * q.x());
-        normal.setY(qCos(theta2) * perp.y() + qSin(theta2) * q.y());
-        normal.setZ(qCos(theta2) * perp.z() + qSin(theta2) * q.z());
-
-        vertex[2].position.x = P2.x() + r2 * normal.x();
-        vertex[2].position.y = P2.y() + r2 * normal.y();
-        vertex[2].position.z = P2.z() + r2 * normal.z();
-        resultVector = (downVector + normal).normalized();
-        vertex[2].normal.x = resultVector.x();
-        vertex[2].normal.y = resultVector.y();
-        vertex[2].normal.z = resultVector.z();
+        mesh->vertices.append(vertex[0]);
+        mesh->vertices.append(vertex[1]);
+    }
 
-        vertex[3].position.x = P1.x() + r1 * normal.x();
-        vertex[3].position.y = P1.y() + r1 * normal.y();
-        vertex[3].position.z = P1.z() + r1 * normal.z();
-        resultVector = (upVector + normal).normalized();
-        vertex[3].normal.x = resultVector.x();
-        vertex[3].normal.y = resultVector.y();
-        vertex[3].normal.z = resultVector.z();
+    // center vertices of the caps
+    ModelVertex centerVertex;
+    centerVertex.position.x = P1.x();
+    centerVertex.position.y = P1.y();
+    centerVertex.position.z = P1.z();
+    centerVertex.normal.x = upVector.x();
+    centerVertex.normal.y = upVector.y();
+    centerVertex.normal.z = upVector.z();
+    topCenter = mesh->vertices.size();
+    mesh->vertices.append(centerVertex);
+    centerVertex.position.x = P2.x();
+    centerVertex.position.y = P2.y();
+    centerVertex.position.z = P2.z();
+    centerVertex.normal.x = downVector.x();
+    centerVertex.normal.y = downVector.y();
+    centerVertex.normal.z = downVector.z();
+    bottomCenter = mesh->vertices.size();
+    mesh->vertices.append(centerVertex);
+
+    level.firstIndex = mesh->indices.size();
+    level.detail = detail;
+    for (int i = 0; i < detail; ++i)
+    {
+        int top1 = first + 2 * i;
+        int bottom1 = top1 + 1;
+        int top2 = first + 2 * ((i + 1) % detail);
+        int bottom2 = top2 + 1;
 
         if (r2 != 0.0)
         {
-            vertex[5].position.x = P2.x();
-            vertex[5].position.y = P2.y();
-            vertex[5].position.z = P2.z();
-            vertex[5].normal.x = downVector.x();
-            vertex[5].normal.y = downVector.y();
-            vertex[5].normal.z = downVector.z();
-
-            vertices.append(vertex[5]);
-            vertices.append(vertex[2]);
-            vertices.append(vertex[1]);
+            mesh->indices.append(bottomCenter);
+            mesh->indices.append(bottom2);
+            mesh->indices.append(bottom1);
         }
 
         if (r1 != 0.0)
         {
-            vertex[4].position.x = P1.x();
-            vertex[4].position.y = P1.y();
-            vertex[4].position.z = P1.z();
-            vertex[4].normal.x = upVector.x();
-            vertex[4].normal.y = upVector.y();
-            vertex[4].normal.z = upVector.z();
-
-            vertices.append(vertex[4]);
-            vertices.append(vertex[0]);
-            vertices.append(vertex[3]);
+            mesh->indices.append(topCenter);
+            mesh->indices.append(top1);
+            mesh->indices.append(top2);
         }
 
-         // append vertex
-        vertices.append(vertex[0]);
-        vertices.append(vertex[1]);
-        vertices.append(vertex[2]);
+        mesh->indices.append(top1);
+        mesh->indices.append(bottom1);
+        mesh->indices.append(bottom2);
 
-        vertices.append(vertex[0]);
-        vertices.append(vertex[2]);
-        vertices.append(vertex[3]);
+        mesh->indices.append(top1);
+        mesh->indices.append(bottom2);
+        mesh->indices.append(top2);
     }
-
-    initializeVertexBuffer(type, vertices);
-
-    addDrawableList(type);
+    level.indexCount = mesh->indices.size() - level.firstIndex;
+    mesh->levels.append(level);
 }
 
-void QGLView::setupSphere(int detail)
+void QGLView::appendSphereLevel(ModelMesh *mesh, int detail)
 {
-    QVector<ModelVertex> rawVertices;
-    QVector<ModelVertex> vertices;
+    ModelLevel level;
+    int firstVertex = mesh->vertices.size();
     int latitudeBands = detail;
     int longitudeBands = detail;
     GLfloat radius = 1.0;
@@ -688,464 +1217,2139 @@ void QGLView::setupSphere(int detail)
             modelVertex.position.y = radius * y;
             modelVertex.position.z = radius * z;
 
-            rawVertices.append(modelVertex);
+            mesh->vertices.append(modelVertex);
         }
     }
 
+    level.firstIndex = mesh->indices.size();
+    level.detail = detail;
     for (int latNumber = 0; latNumber < latitudeBands; latNumber++) {
         for (int longNumber = 0; longNumber < longitudeBands; longNumber++) {
-            int first = (latNumber * (longitudeBands + 1)) + longNumber;
+            int first = firstVertex + (latNumber * (longitudeBands + 1)) + longNumber;
             int second = first + longitudeBands + 1;
-            vertices.append(rawVertices.at(first));
-            vertices.append(rawVertices.at(first + 1));
-            vertices.append(rawVertices.at(second));
-            vertices.append(rawVertices.at(second));
-            vertices.append(rawVertices.at(first + 1));
-            vertices.append(rawVertices.at(second + 1));
+            mesh->indices.append(first);
+            mesh->indices.append(first + 1);
+            mesh->indices.append(second);
+            mesh->indices.append(second);
+            mesh->indices.append(first + 1);
+            mesh->indices.append(second + 1);
         }
     }
+    level.indexCount = mesh->indices.size() - level.firstIndex;
+    mesh->levels.append(level);
+}
 
-    initializeVertexBuffer(Sphere, vertices);
+const QGLView::ModelMesh &QGLView::modelMesh(ModelType type)
+{
+    // initialized once on first use, the initialization is thread safe
+    static const QMap<ModelType, ModelMesh> meshes = createModelMeshes();
 
-    addDrawableList(Sphere);
+    return *meshes.constFind(type);
 }
 
-void QGLView::setupStack()
+QMap<QGLView::ModelType, QGLView::ModelMesh> QGLView::createModelMeshes()
 {
-    m_modelParametersStack.push(new Parameters());
-    m_modelParameters = new Parameters();
+    QMap<ModelType, ModelMesh> meshes;
+    ModelMesh cube;
+    ModelMesh cylinder;
+    ModelMesh cone;
+    ModelMesh sphere;
+
+    appendCubeLevel(&cube);
+    for (int i = 0; i < ModelLevelCount; ++i)
+    {
+        int detail = MinModelDetail << i;
+
+        appendCylinderLevel(&cylinder, 1.0, QVector3D(0,0,0),
+                            1.0, QVector3D(0,0,1),
+                            detail);
+        appendCylinderLevel(&cone, 1.0, QVector3D(0,0,0),
+                            0.0, QVector3D(0,0,1),
+                            detail);
+        appendSphereLevel(&sphere, detail);
+    }
+
+    meshes.insert(Cube, cube);
+    meshes.insert(Cylinder, cylinder);
+    meshes.insert(Cone, cone);
+    meshes.insert(Sphere, sphere);
+
+    return meshes;
+}
 
-    m_lineParametersStack.push(new LineParameters());
-    m_lineParameters = new LineParameters();
+void QGLView::setupStack()
+{
+    // entries are overwritten instead of allocated, deeper nesting grows the stack
+    m_modelParametersStack.resize(ParametersStackSize);
+    m_lineParametersStack.resize(ParametersStackSize);
+    m_textParametersStack.resize(ParametersStackSize);
+    m_parametersStackDepth = 1;
 
-    m_textParametersStack.push(new TextParameters());
-    m_textParameters = new TextParameters();
+    resetTransformations();
 }
 
 void QGLView::drawModelVertices(ModelType type)
 {
     QOpenGLBuffer *vertexBuffer = m_vertexBufferMap[type];
-    QList<Parameters*> *modelParametersList = getDrawableList(type);
+    QOpenGLBuffer *indexBuffer = m_indexBufferMap[type];
+    ModelInstances *modelInstances = m_modelInstancesMap[type];
+    QGLDrawablePool<Parameters> *modelPool = m_modelPoolMap[type];
+    const ModelMesh &mesh = modelMesh(type);
+    QMatrix4x4 viewProjectionMatrix = m_thread_projectionMatrix * m_thread_viewMatrix;
+    QList<InstanceRange> visibleRanges;
 
-    if (modelParametersList->isEmpty())
+    updateModelInstanceBuffer(type);
+
+    if (modelPool->isEmpty())
     {
         return;
     }
 
+    // ranges of consecutive instances inside the view frustum drawn with the same detail level
+    for (int i = 0; i < modelInstances->bounds.size(); ++i)
+    {
+        const BoundingBox &bounds = modelInstances->bounds.at(i);
+        int level;
+
+        if (cullBoundingBox(bounds, m_frustumPlanes) == Outside)
+        {
+            continue;
+        }
+
+        level = selectModelLevel(mesh, bounds, viewProjectionMatrix);
+        if (!visibleRanges.isEmpty()
+                && ((visibleRanges.last().first + visibleRanges.last().count) == i)
+                && (visibleRanges.last().level == level))
+        {
+            visibleRanges.last().count++;
+        }
+        else
+        {
+            InstanceRange range;
+            range.first = i;
+            range.count = 1;
+            range.level = level;
+            visibleRanges.append(range);
+        }
+    }
+
+    if (m_thread_selectionModeActive)  // selection mode active
+    {
+        // the instances are ordered like the drawables, the shader adds the instance index to the offset
+        m_modelProgram->setUniformValue(m_idOffsetLocation, (GLfloat)m_currentDrawableId);
+        m_selectionTypeMap.insert(m_currentDrawableId, type);
+        m_currentDrawableId += modelPool->size();
+    }
+
     vertexBuffer->bind();
     m_modelProgram->enableAttributeArray(m_positionLocation);
     m_modelProgram->enableAttributeArray(m_normalLocation);
     m_modelProgram->setAttributeBuffer(m_positionLocation, GL_FLOAT, 0, 3, sizeof(ModelVertex));
     m_modelProgram->setAttributeBuffer(m_normalLocation, GL_FLOAT, 3*sizeof(GLfloat), 3, sizeof(ModelVertex));
+    vertexBuffer->release();
+
+    indexBuffer->bind();    // stays bound while drawing, the element array binding is not part of the attributes
 
-    for (int i = 0; i < modelParametersList->size(); ++i)
+    if (m_drawElementsInstanced != NULL)
     {
-        Parameters *modelParameters = static_cast<Parameters*>(modelParametersList->at(i));
-        m_modelProgram->setUniformValue(m_colorLocation, modelParameters->color);
-        m_modelProgram->setUniformValue(m_modelMatrixLocation, modelParameters->modelMatrix);
+        modelInstances->buffer->bind();
+        for (int i = 0; i < 4; ++i)    // a mat4 attribute uses one location per column
+        {
+            m_modelProgram->enableAttributeArray(m_modelMatrixLocation + i);
+            m_vertexAttribDivisor(m_modelMatrixLocation + i, 1);
+        }
+        m_modelProgram->enableAttributeArray(m_colorLocation);
+        m_vertexAttribDivisor(m_colorLocation, 1);
+        m_modelProgram->enableAttributeArray(m_pickIdLocation);
+        m_vertexAttribDivisor(m_pickIdLocation, 1);
 
-        if (m_selectionModeActive)  // selection mode active
+        // the instance attributes start at the first instance of each visible range
+        for (int i = 0; i < visibleRanges.size(); ++i)
         {
-            m_modelProgram->setUniformValue(m_idColorLocation, QColor(0xFF000000u + m_currentDrawableId));    // color for selection mode
-            m_drawableIdMap.insert(m_currentDrawableId, modelParameters);
-            m_currentDrawableId++;
+            const InstanceRange &range = visibleRanges.at(i);
+            const ModelLevel &level = mesh.levels.at(range.level);
+            int offset = range.first * sizeof(ModelInstance);
+
+            for (int j = 0; j < 4; ++j)
+            {
+                m_modelProgram->setAttributeBuffer(m_modelMatrixLocation + j, GL_FLOAT, offset + j*4*sizeof(GLfloat), 4, sizeof(ModelInstance));
+            }
+            m_modelProgram->setAttributeBuffer(m_colorLocation, GL_UNSIGNED_BYTE, offset + 16*sizeof(GLfloat), 4, sizeof(ModelInstance));
+            m_modelProgram->setAttributeBuffer(m_pickIdLocation, GL_FLOAT, offset + 16*sizeof(GLfloat) + sizeof(GLcolorRGBA), 1, sizeof(ModelInstance));
+
+            m_drawElementsInstanced(GL_TRIANGLES, level.indexCount, GL_UNSIGNED_SHORT,
+                                    (const GLvoid*)(level.firstIndex * sizeof(GLushort)), range.count);
         }
 
-        glDrawArrays(GL_TRIANGLES, 0, vertexBuffer->size()/sizeof(ModelVertex));
+        for (int i = 0; i < 4; ++i)
+        {
+            m_vertexAttribDivisor(m_modelMatrixLocation + i, 0);
+            m_modelProgram->disableAttributeArray(m_modelMatrixLocation + i);
+        }
+        m_vertexAttribDivisor(m_colorLocation, 0);
+        m_modelProgram->disableAttributeArray(m_colorLocation);
+        m_vertexAttribDivisor(m_pickIdLocation, 0);
+        m_modelProgram->disableAttributeArray(m_pickIdLocation);
+        modelInstances->buffer->release();
     }
+    else    // no instancing available, use constant attributes per instance
+    {
+        for (int i = 0; i < visibleRanges.size(); ++i)
+        {
+            const InstanceRange &range = visibleRanges.at(i);
+            const ModelLevel &level = mesh.levels.at(range.level);
 
-    m_modelProgram->disableAttributeArray(m_positionLocation);
-    m_modelProgram->disableAttributeArray(m_normalLocation);
-    vertexBuffer->release();
-}
+            for (int j = range.first; j < (range.first + range.count); ++j)
+            {
+                const ModelInstance &modelInstance = modelInstances->instances.at(j);
 
-void QGLView::drawLines()
+                m_modelProgram->setAttributeValue(m_modelMatrixLocation, modelInstance.modelMatrix, 4, 4);
+                m_modelProgram->setAttributeValue(m_colorLocation, modelPool->at(j).color);
+                m_modelProgram->setAttributeValue(m_pickIdLocation, modelInstance.pickId);
+
+                glDrawElements(GL_TRIANGLES, level.indexCount, GL_UNSIGNED_SHORT,
+                               (const GLvoid*)(level.firstIndex * sizeof(GLushort)));
+            }
+        }
+    }
+
+    indexBuffer->release();
+
+    m_modelProgram->disableAttributeArray(m_positionLocation);
+    m_modelProgram->disableAttributeArray(m_normalLocation);
+}
+
+int QGLView::selectModelLevel(const ModelMesh &mesh, const BoundingBox &bounds, const QMatrix4x4 &viewProjectionMatrix) const
 {
-    QList<Parameters*>* parametersList = getDrawableList(Line);
+    QVector4D center;
+    QVector3D size;
+    qreal radius;
+    qreal pixelRadius;
+    qreal segments;
 
-    if (parametersList->isEmpty())
+    if (mesh.levels.size() == 1)
     {
-        return;
+        return 0;
     }
 
-    m_lineVertexBuffer->bind();
-    m_lineProgram->enableAttributeArray(m_linePositionLocation);
-    m_lineProgram->setAttributeBuffer(m_linePositionLocation, GL_FLOAT, 0, 3);
-
-    for (int i = 0; i < parametersList->size(); ++i)
+    center = viewProjectionMatrix * QVector4D((bounds.minimum + bounds.maximum) / 2.0, 1.0);
+    if (center.w() <= 0.0)  // at or behind the camera, use full detail
     {
-        LineParameters *lineParameters = static_cast<LineParameters*>(parametersList->at(i));
-        m_lineVertexBuffer->write(0, lineParameters->vertices.data(), lineParameters->vertices.size() * sizeof(GLvector3D));
-        m_lineProgram->setUniformValue(m_lineColorLocation, lineParameters->color);
-        m_lineProgram->setUniformValue(m_lineModelMatrixLocation, lineParameters->modelMatrix);
-        m_lineProgram->setUniformValue(m_lineStippleLocation, lineParameters->stipple);
-        m_lineProgram->setUniformValue(m_lineStippleLengthLocation, lineParameters->stippleLength);
+        return mesh.levels.size() - 1;
+    }
+
+    size = bounds.maximum - bounds.minimum;
+    radius = qMax(size.x(), qMax(size.y(), size.z())) / 2.0;
+    pixelRadius = radius * qAbs(m_thread_projectionMatrix(1, 1)) * m_viewportSize.height() / 2.0 / center.w();
 
-        if (m_selectionModeActive)  // selection mode active
+    // segments needed to keep the chord error below the tolerance, same rule as for arcs
+    segments = 2.0 * M_PI * qSqrt(pixelRadius / (8.0 * ModelTolerance));
+    for (int i = 0; i < mesh.levels.size(); ++i)
+    {
+        if (mesh.levels.at(i).detail >= segments)
         {
-            m_lineProgram->setUniformValue(m_lineIdColorLocation, QColor(0xFF000000u + m_currentDrawableId));    // color for selection mode
-            m_drawableIdMap.insert(m_currentDrawableId, lineParameters);
-            m_currentDrawableId++;
+            return i;
         }
-
-        glLineWidth(lineParameters->width);
-        glDrawArrays(GL_LINE_STRIP, 0, lineParameters->vertices.size());
     }
 
-    m_lineProgram->disableAttributeArray(m_linePositionLocation);
-    m_lineVertexBuffer->release();
+    return mesh.levels.size() - 1;
 }
 
-void QGLView::drawTexts()
+void QGLView::appendModelInstance(const Parameters &parameters)
 {
-    QList<Parameters*>* parametersList = getDrawableList(Text);
+    ModelInstances *modelInstances = m_modelInstancesMap.value(parameters.type);
+    ModelInstance modelInstance;
+    const float *matrixData = parameters.modelMatrix.constData();
+    int index = modelInstances->instances.size();
 
-    if (parametersList->isEmpty())
+    for (int i = 0; i < 16; ++i)
     {
-        return;
+        modelInstance.modelMatrix[i] = matrixData[i];
     }
+    modelInstance.color.r = parameters.color.red();
+    modelInstance.color.g = parameters.color.green();
+    modelInstance.color.b = parameters.color.blue();
+    modelInstance.color.a = parameters.color.alpha();
+    modelInstance.pickId = index;
 
-    m_textVertexBuffer->bind();
-    m_textProgram->enableAttributeArray(m_textPositionLocation);
-    m_textProgram->enableAttributeArray(m_textTexCoordinateLocation);
-    m_textProgram->setAttributeBuffer(m_textPositionLocation, GL_FLOAT, 0, 3, sizeof(TextVertex));
-    m_textProgram->setAttributeBuffer(m_textTexCoordinateLocation, GL_FLOAT, 3*sizeof(GLfloat), 2, sizeof(TextVertex));
+    modelInstances->instances.append(modelInstance);
+    modelInstances->bounds.append(transformBoundingBox(modelInstances->modelBounds, parameters.modelMatrix));
 
-    for (int i = 0; i < parametersList->size(); ++i)
+    if (modelInstances->dirtyFirst == -1)
     {
-        TextParameters *textParameters = static_cast<TextParameters*>(parametersList->at(i));
-        QStaticText staticText = textParameters->staticText;
-        int textureIndex;
-        QOpenGLTexture *texture;
-        float aspectRatio;
+        modelInstances->dirtyFirst = index;
+    }
+    modelInstances->dirtyLast = index + 1;
+}
+
+void QGLView::removeModelInstance(ModelType type, int index)
+{
+    ModelInstances *modelInstances = m_modelInstancesMap.value(type);
+    QVector<ModelInstance> &instances = modelInstances->instances;
+    int lastIndex = instances.size() - 1;
 
-        textureIndex = m_textTextList.indexOf(staticText);
-        texture = m_textTextureList.at(textureIndex);
-        aspectRatio = m_textAspectRatioList.at(textureIndex);
+    // mirrors the swap remove of the drawable pool
+    if (index != lastIndex)
+    {
+        instances[index] = instances.at(lastIndex);
+        instances[index].pickId = index;
+        modelInstances->bounds[index] = modelInstances->bounds.at(lastIndex);
 
-        if (!texture->isCreated()) // initialize texture on first use
+        if ((modelInstances->dirtyFirst == -1) || (index < modelInstances->dirtyFirst))
         {
-            createTextTexture(textParameters);
+            modelInstances->dirtyFirst = index;
         }
-
-        m_textProgram->setUniformValue(m_textAspectRatioLocation, aspectRatio);
-        m_textProgram->setUniformValue(m_textAlignmentLocation, (GLint)textParameters->alignment);
-        m_textProgram->setUniformValue(m_textColorLocation, textParameters->color);
-        m_textProgram->setUniformValue(m_textModelMatrixLocation, textParameters->modelMatrix);
-        m_textProgram->setUniformValue(m_textTextureLocation, texture->textureId());
-
-        if (m_selectionModeActive)  // selection mode active
+        if ((index + 1) > modelInstances->dirtyLast)
         {
-            m_textProgram->setUniformValue(m_textIdColorLocation, QColor(0xFF000000u + m_currentDrawableId));    // color for selection mode
-            m_drawableIdMap.insert(m_currentDrawableId, textParameters);
-            m_currentDrawableId++;
+            modelInstances->dirtyLast = index + 1;
         }
-
-        texture->bind(texture->textureId());
-        glDrawArrays(GL_TRIANGLES, 0, m_textVertexBuffer->size()/sizeof(TextVertex));
-        texture->release(texture->textureId());
     }
-
-    m_textProgram->disableAttributeArray(m_textPositionLocation);
-    m_textProgram->disableAttributeArray(m_textTexCoordinateLocation);
-    m_textVertexBuffer->release();
+    instances.removeLast();
+    modelInstances->bounds.removeLast();
 }
 
-void QGLView::prepareTextTexture(const QStaticText &staticText, QFont font)
+void QGLView::updateModelInstanceColor(ModelType type, int index)
 {
-    if (m_textTextList.contains(staticText))
+    ModelInstances *modelInstances = m_modelInstancesMap.value(type);
+    const QColor &parametersColor = m_modelPoolMap.value(type)->at(index).color;
+    GLcolorRGBA &color = modelInstances->instances[index].color;
+
+    color.r = parametersColor.red();
+    color.g = parametersColor.green();
+    color.b = parametersColor.blue();
+    color.a = parametersColor.alpha();
+
+    if ((modelInstances->dirtyFirst == -1) || (index < modelInstances->dirtyFirst))
     {
-        return;
+        modelInstances->dirtyFirst = index;
     }
-
-    if (m_textTextureList.size() > 100) // maximum of 100 rendered texts TODO: make parameter
+    if ((index + 1) > modelInstances->dirtyLast)
     {
-        clearTextTextures();
+        modelInstances->dirtyLast = index + 1;
     }
+}
 
-    QPixmap pixmap(QSize(qCeil(staticText.size().width()), qCeil(staticText.size().height())));
-    pixmap.fill(QColor(Qt::transparent));
-
-    QPainter painter(&pixmap);
-    painter.setPen(Qt::white);
-    painter.setFont(font);
-    painter.drawStaticText(0, 0, staticText);
+void QGLView::updateModelInstanceBuffer(ModelType type)
+{
+    ModelInstances *modelInstances = m_modelInstancesMap.value(type);
+    QOpenGLBuffer *buffer = modelInstances->buffer;
+    int size;
 
-    QOpenGLTexture *texture = new QOpenGLTexture(QOpenGLTexture::Target2D);
-    float aspectRatio = staticText.size().width()/staticText.size().height();
+    if (modelInstances->dirtyFirst == -1)
+    {
+        return;
+    }
 
-    m_textTextList.append(staticText);
-    m_textTextureList.append(texture);
-    m_textAspectRatioList.append(aspectRatio);
-    m_textImageList.append(pixmap.toImage());
-}
+    modelInstances->dirtyLast = qMin(modelInstances->dirtyLast, modelInstances->instances.size());   // instances may have been removed since
 
-void QGLView::createTextTexture(TextParameters *textParameters)
-{
-    int textureIndex = m_textTextList.indexOf(textParameters->staticText);
-    QOpenGLTexture *texture = m_textTextureList.at(textureIndex);
+    size = modelInstances->instances.size() * sizeof(ModelInstance);
+    buffer->bind();
+    if (buffer->size() < size)
+    {
+        // grow with headroom to avoid reallocating for every new instance
+        buffer->allocate(size * 2);
+        buffer->write(0, modelInstances->instances.constData(), size);
+    }
+    else if (modelInstances->dirtyLast > modelInstances->dirtyFirst)
+    {
+        buffer->write(modelInstances->dirtyFirst * sizeof(ModelInstance),
+                      modelInstances->instances.constData() + modelInstances->dirtyFirst,
+                      (modelInstances->dirtyLast - modelInstances->dirtyFirst) * sizeof(ModelInstance));
+    }
+    buffer->release();
 
-    texture->create();
-    texture->setMinificationFilter(QOpenGLTexture::Nearest);
-    texture->setMagnificationFilter(QOpenGLTexture::Nearest);
-    texture->setWrapMode(QOpenGLTexture::ClampToEdge);
-    texture->setData(m_textImageList.at(textureIndex));
+    modelInstances->dirtyFirst = -1;
+    modelInstances->dirtyLast = -1;
 }
 
-void QGLView::clearTextTextures()
+void QGLView::drawLines()
 {
-    QList<int> usedIndexes;
-    QList<Parameters*>* parametersList = getDrawableList(Text);
+    updateLineVertexBuffer();
 
-
-    // search for indexes still in use
-    for (int i = 0; i < parametersList->size(); ++i)
+    if (m_lineBufferGroups.isEmpty())
     {
-        TextParameters *textParameters = static_cast<TextParameters*>(parametersList->at(i));
+        return;
+    }
+
+    m_lineProgram->enableAttributeArray(m_linePositionLocation);
+    m_lineProgram->enableAttributeArray(m_lineColorLocation);
+    m_lineProgram->enableAttributeArray(m_lineBackplotColorLocation);
+    m_lineProgram->enableAttributeArray(m_lineSequenceLocation);
+    m_lineIndexBuffer->bind();  // the attribute buffers are set per chunk
 
-        if (m_textTextList.contains(textParameters->staticText))
+    if (!m_thread_selectionModeActive)
+    {
+        // only the ranges of the hierarchy inside the view frustum are drawn
+        for (int i = 0; i < m_lineBufferGroups.size(); ++i)
         {
-            usedIndexes.append(i);
+            const LineGroup &lineGroup = m_lineBufferGroups.at(i);
+
+            if (lineGroup.nodes.isEmpty() || !isLayerPainted(lineGroup.item))
+            {
+                continue;
+            }
+
+            m_lineBatches.clear();
+            cullLineNodes(lineGroup, 0, false);
+            if (m_lineBatches.isEmpty())
+            {
+                continue;
+            }
+
+            glLineWidth(lineGroup.width);
+            m_lineProgram->setUniformValue(m_lineVertexResolutionLocation, lineGroup.resolution);
+            m_lineProgram->setUniformValue(m_lineExecutedSequenceLocation, m_backplotSequences.value(lineGroup.item, 0.0));
+            for (int j = 0; j < m_lineBatches.size(); ++j)
+            {
+                const LineBatch &lineBatch = m_lineBatches.at(j);
+                drawLineRange(lineGroup, lineBatch.first - lineGroup.first, lineBatch.count);
+            }
         }
     }
-
-    // remove all textures that are not in use anymore
-    for (int i = (m_textTextureList.size()-1); i >= 0; i--)
+    else    // selection mode active, every drawable needs its own id color
     {
-        if (!usedIndexes.contains(i))
+        // the offsets come from the groups, the buffers may still hold the previous store
+        m_selectionTypeMap.insert(m_currentDrawableId, Line);
+        m_lineSelectionHandles.clear();
+        for (int i = 0; i < m_lineBufferGroups.size(); ++i)
         {
-            m_textTextList.removeAt(i);
-            m_textAspectRatioList.removeAt(i);
-            m_textTextureList.at(i)->destroy();
-            delete m_textTextureList.at(i);
-            m_textTextureList.removeAt(i);
-            m_textImageList.removeAt(i);
+            const LineGroup &lineGroup = m_lineBufferGroups.at(i);
+
+            glLineWidth(lineGroup.width);
+            m_lineProgram->setUniformValue(m_lineVertexResolutionLocation, lineGroup.resolution);
+            m_lineProgram->setUniformValue(m_lineExecutedSequenceLocation, m_backplotSequences.value(lineGroup.item, 0.0));
+            for (int j = 0; j < lineGroup.drawables.size(); ++j)
+            {
+                int index = m_linePool.indexOf(lineGroup.drawables.at(j));
+                int offset = lineGroup.drawableOffsets.at(j);
+                int count = ((j + 1) < lineGroup.drawableOffsets.size()) ? lineGroup.drawableOffsets.at(j + 1) - offset : lineGroup.count - offset;
+
+                if ((index == -1) || (count == 0) || (cullBoundingBox(m_linePool.at(index).bounds, m_frustumPlanes) == Outside))
+                {
+                    continue;
+                }
+
+                m_lineProgram->setUniformValue(m_lineIdColorLocation, QColor(0xFF000000u + m_currentDrawableId + m_lineSelectionHandles.size()));    // color for selection mode
+                m_lineSelectionHandles.append(lineGroup.drawables.at(j));
+                drawLineRange(lineGroup, offset, count);
+            }
         }
+        m_currentDrawableId += m_lineSelectionHandles.size();
     }
+
+    m_lineIndexBuffer->release();
+    m_lineProgram->disableAttributeArray(m_linePositionLocation);
+    m_lineProgram->disableAttributeArray(m_lineColorLocation);
+    m_lineProgram->disableAttributeArray(m_lineBackplotColorLocation);
+    m_lineProgram->disableAttributeArray(m_lineSequenceLocation);
 }
 
-void QGLView::updateGLItems()
+void QGLView::appendLineVertices(LineParameters *lineParameters)
 {
-    for (int i = 0; i < m_glItems.size(); ++i)
+    const QVector<GLvector3D> &vertices = lineParameters->vertices;
+    const QMatrix4x4 &modelMatrix = lineParameters->modelMatrix;
+    QVector3D origin;
+    QVector3D position;
+    LineVertex lineVertex;
+    int segmentCount;
+
+    // the stored vertices are already transformed, so every line can be drawn in one batch
+    origin = modelMatrix.map(QVector3D(0.0, 0.0, 0.0));
+    lineVertex.stippleOrigin.x = origin.x();
+    lineVertex.stippleOrigin.y = origin.y();
+    lineVertex.stippleOrigin.z = origin.z();
+    lineVertex.stippleLength = lineParameters->stipple ? lineParameters->stippleLength : 0.0;
+    lineVertex.sequence = 0.0;  // plain lines are never part of the backplot
+    lineParameters->bounds.minimum = origin;
+    lineParameters->bounds.maximum = origin;
+
+    // the vertices are staged until the next repack quantizes them, the colors are written there too
+    segmentCount = qMax(vertices.size() - 1, 0);
+    lineParameters->vertexOffset = m_lineStagingVertices.size();
+    lineParameters->vertexCount = segmentCount * 2;
+    lineParameters->packed = false;
+    m_lineStagingVertices.reserve(m_lineStagingVertices.size() + lineParameters->vertexCount);
+
+    // line strips are staged as GL_LINES pairs like the scene paths, packing joins them again
+    for (int i = 0; i < segmentCount; ++i)
     {
-        updateGLItem(m_glItems.at(i));
+        for (int j = i; j <= (i + 1); ++j)
+        {
+            position = modelMatrix.map(QVector3D(vertices.at(j).x, vertices.at(j).y, vertices.at(j).z));
+            if ((i == 0) && (j == 0))
+            {
+                lineParameters->bounds.minimum = position;
+                lineParameters->bounds.maximum = position;
+            }
+            else
+            {
+                expandBoundingBox(&lineParameters->bounds, position);
+            }
+            lineVertex.position.x = position.x();
+            lineVertex.position.y = position.y();
+            lineVertex.position.z = position.z();
+            m_lineStagingVertices.append(lineVertex);
+        }
     }
-}
 
-void QGLView::clearGLItem(QGLItem *item)
-{
-    removeDrawables(m_drawableListMap.value(item));
+    lineParameters->vertices.clear();   // the vertex store holds the geometry from now on
+    m_lineGeometryChanged = true;
 }
 
-void QGLView::updateGLItem(QGLItem *item)
+void QGLView::updateLineVertexColor(LineParameters *lineParameters)
 {
-    m_modifiedGlItems.append(item);
-}
+    int first = lineParameters->packedVertexOffset;
+    int last = lineParameters->packedVertexOffset + lineParameters->packedVertexCount;
+    LineColor color;
+    LineColor *colorData;
 
-void QGLView::paintGLItems()
-{
-    for (int i = 0; i < m_modifiedGlItems.size(); ++i)
+    if (!lineParameters->packed)
     {
-        paintGLItem(m_modifiedGlItems.at(i));
+        return; // the color is written when the staged vertices are packed
     }
-    m_modifiedGlItems.clear();
-}
 
-void QGLView::paintGLItem(QGLItem *item)
-{
-    if (item->isVisible())
+    color = lineColor(*lineParameters);
+    colorData = m_lineColors.data();
+    for (int i = first; i < last; ++i)
     {
-        item->paint(this);
+        colorData[i] = color;
+    }
+
+    // consecutive drawables, e.g. backplot progress, merge into one buffer update
+    if (lineParameters->level != -1)
+    {
+        if ((m_lineLevelColorDirtyFirst == -1) || (first < m_lineLevelColorDirtyFirst))
+        {
+            m_lineLevelColorDirtyFirst = first;
+        }
+        if (last > m_lineLevelColorDirtyLast)
+        {
+            m_lineLevelColorDirtyLast = last;
+        }
     }
     else
     {
-        removeDrawables(m_drawableListMap.value(item));     // if the item is not visible we remove all drawables
+        if ((m_lineColorDirtyFirst == -1) || (first < m_lineColorDirtyFirst))
+        {
+            m_lineColorDirtyFirst = first;
+        }
+        if (last > m_lineColorDirtyLast)
+        {
+            m_lineColorDirtyLast = last;
+        }
     }
 }
 
-quint32 QGLView::getSelection()
+QGLView::LineColor QGLView::lineColor(const QGLView::LineParameters &lineParameters)
+{
+    const QColor &backplotColor = lineParameters.backplotColor.isValid() ? lineParameters.backplotColor : lineParameters.color;
+    LineColor color;
+
+    color.color.r = lineParameters.color.red();
+    color.color.g = lineParameters.color.green();
+    color.color.b = lineParameters.color.blue();
+    color.color.a = lineParameters.color.alpha();
+    color.backplotColor.r = backplotColor.red();
+    color.backplotColor.g = backplotColor.green();
+    color.backplotColor.b = backplotColor.blue();
+    color.backplotColor.a = backplotColor.alpha();
+
+    return color;
+}
+
+void QGLView::updateLineVertexBuffer()
 {
-    QList<quint32> ids;
-    QList<quint32> sortedIds;
-    int selectionSize = 5;  // only odd selection sizes make sense
-    int sizeOffset;
-    QPoint correctedSelectionPoint;
+    finishLineUpload();
 
-    sizeOffset = qFloor((float)selectionSize/2.0);  // calculate the offset
+    if (m_lineUploadJob != NULL)
+    {
+        return; // changes are applied once the running upload is finished
+    }
 
-    // correct the position of the selection to center the mouse click
-    correctedSelectionPoint.setX(qMin(qMax(m_selectionPoint.x() - sizeOffset, 0), window()->width() - selectionSize));
-    correctedSelectionPoint.setY(qMin(qMax(m_selectionPoint.y() - sizeOffset, 0), window()->height() - selectionSize));
+    updateLineLevelColors();
 
-    // read the data
-    for (int i = 0; i < (selectionSize * selectionSize); ++i)
+    if (m_lineGeometryChanged)
     {
-        GLcolorRGB colorRGB;
-        quint32 id;
+        QVector<PackedLineVertex> vertices;
+        QVector<GLushort> indices;
+        QVector<LineColor> colors;
+        QList<LineGroup> lineGroups;
+        QList<GLfloat> widths;
 
-        glReadPixels(correctedSelectionPoint.x() + (i % selectionSize), correctedSelectionPoint.y() + (i / selectionSize), 1, 1, GL_RGB, GL_UNSIGNED_BYTE, &colorRGB);
-        id = ((quint32)colorRGB.r << 16) + ((quint32)colorRGB.g << 8) + (quint32)colorRGB.b;
+        updateLineLevelChunks();
 
-        if ((id != 0) && (!ids.contains(id)))   // collect all ids in selection
+        // all lines with the same width are drawn in one batch
+        for (int i = 0; i < m_linePool.size(); ++i)
         {
-            ids.append(id);
+            GLfloat width = m_linePool.at(i).width;
+            if (!widths.contains(width))
+            {
+                widths.append(width);
+            }
         }
-    }
 
-    int maxCount = 0;
+        // pack the vertices of all live drawables, removed drawables are dropped
+        vertices.reserve(m_lineVertices.size() + m_lineStagingVertices.size());
+        indices.reserve(m_lineIndices.size() + m_lineStagingVertices.size());
+        colors.reserve(m_lineColors.size() + m_lineStagingVertices.size());
+        for (int i = 0; i < widths.size(); ++i)
+        {
+            for (int j = 0; j < m_glItems.size(); ++j)
+            {
+                QGLItem *item = m_glItems.at(j);
+                QVector<QGLDrawableHandle> *drawableList = m_drawableListMap.value(item);
+                QVector<int> drawables;
+                LineGroup lineGroup;
+                int previousGroup = -1;
+
+                for (int k = 0; k < drawableList->size(); ++k)
+                {
+                    int index = m_linePool.indexOf(drawableList->at(k));
+                    if ((index != -1) && (m_linePool.at(index).width == widths.at(i)))
+                    {
+                        drawables.append(index);
+                    }
+                }
+
+                if (drawables.isEmpty())
+                {
+                    continue;
+                }
+
+                lineGroup.item = item;
+                lineGroup.width = widths.at(i);
+                lineGroup.first = indices.size();
+                lineGroup.firstVertex = vertices.size();
+
+                for (int k = 0; k < m_lineGroups.size(); ++k)
+                {
+                    if ((m_lineGroups.at(k).item == item) && (m_lineGroups.at(k).width == lineGroup.width))
+                    {
+                        previousGroup = k;
+                        break;
+                    }
+                }
+
+                if ((previousGroup != -1) && !m_modifiedLineItems.contains(item))
+                {
+                    // unmodified item, quantized vertices, indices, chunks and hierarchy are moved as they are
+                    const LineGroup &oldGroup = m_lineGroups.at(previousGroup);
+                    int offset = lineGroup.first - oldGroup.first;
+                    int vertexOffset = lineGroup.firstVertex - oldGroup.firstVertex;
+
+                    vertices += m_lineVertices.mid(oldGroup.firstVertex, oldGroup.vertexCount);
+                    indices += m_lineIndices.mid(oldGroup.first, oldGroup.count);
+                    colors += m_lineColors.mid(oldGroup.firstVertex, oldGroup.vertexCount);
+                    lineGroup.nodes = oldGroup.nodes;
+                    lineGroup.drawables = oldGroup.drawables;
+                    lineGroup.drawableOffsets = oldGroup.drawableOffsets;
+                    lineGroup.chunks = oldGroup.chunks;
+                    lineGroup.resolution = oldGroup.resolution;
+                    lineGroup.levels = oldGroup.levels;
+                    for (int k = 0; k < drawables.size(); ++k)
+                    {
+                        m_linePool[drawables.at(k)].vertexOffset += offset;
+                        m_linePool[drawables.at(k)].packedVertexOffset += vertexOffset;
+                    }
+                }
+                else
+                {
+                    QVector<LineVertex> groupVertices;
+                    QVector<int> nodeDrawables;
+                    QVector<int> levelDrawables;
+                    QVector<int> drawableOffsets;
+                    QGLLinePacker packer(m_thread_vertexResolution);
+
+                    // packed drawables of a modified item are staged again and packed together with the new ones
+                    for (int k = 0; k < drawables.size(); ++k)
+                    {
+                        LineParameters *lineParameters = &m_linePool[drawables.at(k)];
+                        if (lineParameters->packed)
+                        {
+                            int offset = m_lineStagingVertices.size();
+                            unpackLineVertices(m_lineGroups.at(previousGroup), m_lineVertices, m_lineIndices,
+                                               lineParameters->vertexOffset, lineParameters->vertexCount, m_lineStagingVertices);
+                            lineParameters->vertexOffset = offset;
+                            lineParameters->packed = false;
+                        }
+                    }
+
+                    // a valid level chunk enters the hierarchy as one element, represented by its first drawable
+                    for (int k = 0; k < drawables.size(); ++k)
+                    {
+                        LineParameters *lineParameters = &m_linePool[drawables.at(k)];
+                        int chunkIndex = m_lineLevelChunkPool.indexOf(lineParameters->levelChunk);
+                        bool valid = (chunkIndex != -1) && m_lineLevelChunkPool.at(chunkIndex).valid;
+
+                        if (lineParameters->level != -1)
+                        {
+                            if (valid)
+                            {
+                                levelDrawables.append(drawables.at(k));
+                            }
+                            else
+                            {
+                                lineParameters->vertexCount = 0;    // never drawn, dropped from the store
+                            }
+                        }
+                        else if (!valid || (representedLineLevelChunk(drawables.at(k)) != NULL))
+                        {
+                            nodeDrawables.append(drawables.at(k));
+                        }
+                    }
+
+                    // the hierarchy is built relative to the group and quantized afterwards
+                    lineGroup.first = 0;
+                    if (!nodeDrawables.isEmpty())
+                    {
+                        buildLineNodes(&lineGroup, nodeDrawables, 0, nodeDrawables.size(), groupVertices);
+                    }
+
+                    // the simplified drawables follow the hierarchy, they are only drawn instead of their leaf
+                    for (int k = 0; k < levelDrawables.size(); ++k)
+                    {
+                        LineParameters *lineParameters = &m_linePool[levelDrawables.at(k)];
+                        int offset = groupVertices.size();
+
+                        packer.appendSplitSegments(m_lineStagingVertices, lineParameters->vertexOffset,
+                                                   lineParameters->vertexCount, groupVertices);
+                        lineParameters->vertexOffset = offset;
+                        lineParameters->vertexCount = groupVertices.size() - offset;
+                    }
+                    for (int k = 0; k < lineGroup.levels.size(); ++k)
+                    {
+                        LineLevel &lineLevel = lineGroup.levels[k];
+                        const LineLevelChunk *levelChunk = m_lineLevelChunkPool.value(lineLevel.chunk);
+
+                        for (int level = 0; level < QGLSceneBuffer::LevelCount; ++level)
+                        {
+                            const LineParameters *lineParameters = m_linePool.value(levelChunk->levels[level]);
+
+                            lineLevel.first[level] = (lineParameters != NULL) ? lineParameters->vertexOffset : 0;
+                            lineLevel.count[level] = (lineParameters != NULL) ? lineParameters->vertexCount : 0;
+                            lineLevel.tolerance[level] = levelChunk->tolerances[level];
+                        }
+                    }
+
+                    // connected segments share their vertices, but never across drawables
+                    drawableOffsets = lineGroup.drawableOffsets;
+                    for (int k = 0; k < levelDrawables.size(); ++k)
+                    {
+                        drawableOffsets.append(m_linePool.at(levelDrawables.at(k)).vertexOffset);
+                    }
+
+                    lineGroup.first = indices.size();
+                    lineGroup.firstVertex = vertices.size();
+                    lineGroup.resolution = m_thread_vertexResolution;
+                    lineGroup.chunks.clear();
+                    packer.pack(groupVertices, drawableOffsets, lineGroup.chunks, vertices, indices);
+
+                    // the vertices are in leaf order followed by the levels, the color of a drawable is uniform
+                    for (int k = 0; k < (lineGroup.drawables.size() + levelDrawables.size()); ++k)
+                    {
+                        LineParameters *lineParameters = (k < lineGroup.drawables.size())
+                                ? m_linePool.value(lineGroup.drawables.at(k))
+                                : &m_linePool[levelDrawables.at(k - lineGroup.drawables.size())];
+                        lineParameters->vertexOffset += lineGroup.first;
+                        lineParameters->packedVertexOffset = colors.size();
+                        lineParameters->packedVertexCount = 0;
+                        if (lineParameters->vertexCount > 0)
+                        {
+                            // the strip vertices of a drawable are continuous, the last index refers to the last one
+                            int last = lineParameters->vertexOffset + lineParameters->vertexCount - 1 - lineGroup.first;
+                            int lastVertex = QGLLinePacker::vertexAt(lineGroup.chunks, indices.constData() + lineGroup.first, last);
+                            lineParameters->packedVertexCount = lineGroup.firstVertex + lastVertex + 1 - colors.size();
+                        }
+                        colors.insert(colors.size(), lineParameters->packedVertexCount, lineColor(*lineParameters));
+                        lineParameters->packed = true;
+                    }
+                }
+
+                lineGroup.count = indices.size() - lineGroup.first;
+                lineGroup.vertexCount = vertices.size() - lineGroup.firstVertex;
+                lineGroups.append(lineGroup);
+            }
+        }
+        m_lineVertices = vertices;
+        m_lineIndices = indices;
+        m_lineColors = colors;
+        m_lineGroups = lineGroups;
+        m_lineStagingVertices.clear();
+        m_modifiedLineItems.clear();
+
+        if ((m_bufferUploader != NULL)
+            && (((m_lineVertices.size() * (int)sizeof(PackedLineVertex)) + (m_lineIndices.size() * (int)sizeof(GLushort))) >= AsyncUploadSize))
+        {
+            startLineUpload();
+        }
+        else
+        {
+            m_lineVertexBuffer->bind();
+            m_lineVertexBuffer->allocate(m_lineVertices.constData(), m_lineVertices.size() * sizeof(PackedLineVertex));
+            m_lineVertexBuffer->release();
+            m_lineIndexBuffer->bind();
+            m_lineIndexBuffer->allocate(m_lineIndices.constData(), m_lineIndices.size() * sizeof(GLushort));
+            m_lineIndexBuffer->release();
+            m_lineColorBuffer->bind();
+            m_lineColorBuffer->allocate(m_lineColors.constData(), m_lineColors.size() * sizeof(LineColor));
+            m_lineColorBuffer->release();
+            m_lineBufferGroups = m_lineGroups;
+        }
 
-    // find the id that is most common in the selection
-    foreach(quint32 id, ids)
+        m_lineGeometryChanged = false;
+        m_pickDataChanged = true;
+        m_lineColorDirtyFirst = -1;
+        m_lineColorDirtyLast = -1;
+        m_lineLevelColorDirtyFirst = -1;
+        m_lineLevelColorDirtyLast = -1;
+    }
+    else if ((m_lineColorDirtyFirst != -1) || (m_lineLevelColorDirtyFirst != -1))
     {
-        int count = 0;
-        qCount(ids.begin(), ids.end(), id, count);
-        if (count > maxCount) {
-            sortedIds.prepend(id);
-            maxCount = count;
+        // recoloring only touches the color stream of the modified ranges
+        m_lineColorBuffer->bind();
+        if (m_lineColorDirtyFirst != -1)
+        {
+            m_lineColorBuffer->write(m_lineColorDirtyFirst * sizeof(LineColor),
+                                     m_lineColors.constData() + m_lineColorDirtyFirst,
+                                     (m_lineColorDirtyLast - m_lineColorDirtyFirst) * sizeof(LineColor));
         }
-        else {
-            sortedIds.append(id);
+        if (m_lineLevelColorDirtyFirst != -1)
+        {
+            m_lineColorBuffer->write(m_lineLevelColorDirtyFirst * sizeof(LineColor),
+                                     m_lineColors.constData() + m_lineLevelColorDirtyFirst,
+                                     (m_lineLevelColorDirtyLast - m_lineLevelColorDirtyFirst) * sizeof(LineColor));
         }
+        m_lineColorBuffer->release();
+
+        m_lineColorDirtyFirst = -1;
+        m_lineColorDirtyLast = -1;
+        m_lineLevelColorDirtyFirst = -1;
+        m_lineLevelColorDirtyLast = -1;
+    }
+}
+
+void QGLView::startLineUpload()
+{
+    QGLBufferUploader::Upload vertexUpload;
+    QGLBufferUploader::Upload colorUpload;
+    QGLBufferUploader::Upload indexUpload;
+
+    // the buffers are created here and filled by the upload context
+    vertexUpload.buffer = new QOpenGLBuffer(QOpenGLBuffer::VertexBuffer);
+    vertexUpload.buffer->create();
+    vertexUpload.buffer->setUsagePattern(QOpenGLBuffer::StaticDraw);
+    colorUpload.buffer = new QOpenGLBuffer(QOpenGLBuffer::VertexBuffer);
+    colorUpload.buffer->create();
+    colorUpload.buffer->setUsagePattern(QOpenGLBuffer::DynamicDraw);
+    indexUpload.buffer = new QOpenGLBuffer(QOpenGLBuffer::IndexBuffer);
+    indexUpload.buffer->create();
+    indexUpload.buffer->setUsagePattern(QOpenGLBuffer::StaticDraw);
+
+    // implicitly shared, later changes of the store detach from the uploaded data
+    m_lineUploadVertices = m_lineVertices;
+    m_lineUploadColors = m_lineColors;
+    m_lineUploadIndices = m_lineIndices;
+    m_lineUploadGroups = m_lineGroups;
+    vertexUpload.data = m_lineUploadVertices.constData();
+    vertexUpload.size = m_lineUploadVertices.size() * sizeof(PackedLineVertex);
+    colorUpload.data = m_lineUploadColors.constData();
+    colorUpload.size = m_lineUploadColors.size() * sizeof(LineColor);
+    indexUpload.data = m_lineUploadIndices.constData();
+    indexUpload.size = m_lineUploadIndices.size() * sizeof(GLushort);
+
+    m_lineUploadJob = new QGLBufferUploader::Job();
+    m_lineUploadJob->uploads.append(vertexUpload);
+    m_lineUploadJob->uploads.append(colorUpload);
+    m_lineUploadJob->uploads.append(indexUpload);
+    m_bufferUploader->start(m_lineUploadJob);
+}
+
+void QGLView::finishLineUpload()
+{
+    int state;
+
+    if (m_lineUploadJob == NULL)
+    {
+        return;
+    }
+
+    state = m_lineUploadJob->state.loadAcquire();
+    if (state == QGLBufferUploader::Pending)
+    {
+        return; // the previous buffers are drawn until the upload is finished
     }
 
-    if (sortedIds.size() > 0)
+    if (state == QGLBufferUploader::Failed)
     {
-        return sortedIds.first();
+        // the upload context could not be used, upload on the render thread
+        m_lineVertexBuffer->bind();
+        m_lineVertexBuffer->allocate(m_lineUploadVertices.constData(), m_lineUploadVertices.size() * sizeof(PackedLineVertex));
+        m_lineVertexBuffer->release();
+        m_lineColorBuffer->bind();
+        m_lineColorBuffer->allocate(m_lineUploadColors.constData(), m_lineUploadColors.size() * sizeof(LineColor));
+        m_lineColorBuffer->release();
+        m_lineIndexBuffer->bind();
+        m_lineIndexBuffer->allocate(m_lineUploadIndices.constData(), m_lineUploadIndices.size() * sizeof(GLushort));
+        m_lineIndexBuffer->release();
+        delete m_lineUploadJob->uploads.at(0).buffer;
+        delete m_lineUploadJob->uploads.at(1).buffer;
+        delete m_lineUploadJob->uploads.at(2).buffer;
     }
     else
     {
-        return 0;   // nothing selected
+        delete m_lineVertexBuffer;
+        delete m_lineColorBuffer;
+        delete m_lineIndexBuffer;
+        m_lineVertexBuffer = m_lineUploadJob->uploads.at(0).buffer;
+        m_lineColorBuffer = m_lineUploadJob->uploads.at(1).buffer;
+        m_lineIndexBuffer = m_lineUploadJob->uploads.at(2).buffer;
     }
+
+    m_lineBufferGroups = m_lineUploadGroups;
+    m_lineUploadGroups.clear();
+    m_layerCacheValid = false;
+    m_lineUploadVertices.clear();
+    m_lineUploadColors.clear();
+    m_lineUploadIndices.clear();
+    delete m_lineUploadJob;
+    m_lineUploadJob = NULL;
 }
 
-void QGLView::addGlItem(QGLItem *item)
+int QGLView::buildLineNodes(QGLView::LineGroup *lineGroup, QVector<int> &drawables, int begin, int end,
+                            QVector<LineVertex> &vertices)
 {
-    m_glItems.append(item);
+    QGLLinePacker packer(m_thread_vertexResolution);
+    BoundingNode node;
+    int nodeIndex;
+    bool containsLevels = false;
 
-    QList<Drawable> *drawableList = new QList<Drawable>();
-    m_drawableListMap.insert(item, drawableList);
+    // level chunks are elements of their own, their bounds cover all drawables of the chunk
+    for (int i = begin; i < end; ++i)
+    {
+        const LineLevelChunk *levelChunk = representedLineLevelChunk(drawables.at(i));
+        const BoundingBox &bounds = (levelChunk != NULL) ? levelChunk->bounds : m_linePool.at(drawables.at(i)).bounds;
 
-    if (m_initialized) {
-        updateGLItem(item);
-        update();
+        if (i == begin)
+        {
+            node.bounds = bounds;
+        }
+        else
+        {
+            expandBoundingBox(&node.bounds, bounds.minimum);
+            expandBoundingBox(&node.bounds, bounds.maximum);
+        }
+        containsLevels |= (levelChunk != NULL);
+    }
+    node.first = vertices.size() - lineGroup->first;
+    node.count = 0;
+    node.left = -1;
+    node.right = -1;
+    node.firstDrawable = lineGroup->drawables.size();
+    node.drawableCount = 0;
+    node.level = -1;
+    node.hasLevels = false;
+    nodeIndex = lineGroup->nodes.size();
+    lineGroup->nodes.append(node);
+
+    // a level chunk gets a leaf of its own, so the leaf can be replaced by a simplified level
+    if (((end - begin) == 1) || (((end - begin) <= MaxLeafDrawables) && !containsLevels))
+    {
+        // the vertices are stored in leaf order, so every node covers a continuous range
+        for (int i = begin; i < end; ++i)
+        {
+            const LineLevelChunk *levelChunk = representedLineLevelChunk(drawables.at(i));
+            QVector<int> leafDrawables;
+
+            if (levelChunk != NULL)
+            {
+                LineLevel lineLevel;
+
+                lineLevel.chunk = m_linePool.at(drawables.at(i)).levelChunk;
+                lineGroup->nodes[nodeIndex].level = lineGroup->levels.size();
+                lineGroup->nodes[nodeIndex].hasLevels = true;
+                lineGroup->levels.append(lineLevel);
+                for (int j = 0; j < levelChunk->drawables.size(); ++j)
+                {
+                    leafDrawables.append(m_linePool.indexOf(levelChunk->drawables.at(j)));
+                }
+            }
+            else
+            {
+                leafDrawables.append(drawables.at(i));
+            }
+
+            for (int j = 0; j < leafDrawables.size(); ++j)
+            {
+                LineParameters *lineParameters = &m_linePool[leafDrawables.at(j)];
+                int offset = vertices.size();
+
+                lineGroup->drawables.append(m_linePool.handleAt(leafDrawables.at(j)));
+                lineGroup->drawableOffsets.append(offset - lineGroup->first);
+                packer.appendSplitSegments(m_lineStagingVertices, lineParameters->vertexOffset,
+                                           lineParameters->vertexCount, vertices);
+                lineParameters->vertexOffset = offset;
+                lineParameters->vertexCount = vertices.size() - offset;
+            }
+        }
+    }
+    else
+    {
+        QVector3D size = node.bounds.maximum - node.bounds.minimum;
+        QList<QPair<float, int> > centers;
+        int middle = begin + (end - begin) / 2;
+        int left;
+        int right;
+
+        // split at the median center along the longest axis
+        for (int i = begin; i < end; ++i)
+        {
+            const LineLevelChunk *levelChunk = representedLineLevelChunk(drawables.at(i));
+            const BoundingBox &bounds = (levelChunk != NULL) ? levelChunk->bounds : m_linePool.at(drawables.at(i)).bounds;
+            QVector3D center = (bounds.minimum + bounds.maximum) / 2.0;
+            float value;
+
+            if ((size.x() >= size.y()) && (size.x() >= size.z()))
+            {
+                value = center.x();
+            }
+            else if (size.y() >= size.z())
+            {
+                value = center.y();
+            }
+            else
+            {
+                value = center.z();
+            }
+            centers.append(qMakePair(value, drawables.at(i)));
+        }
+        qSort(centers.begin(), centers.end());
+        for (int i = 0; i < centers.size(); ++i)
+        {
+            drawables[begin + i] = centers.at(i).second;
+        }
+
+        left = buildLineNodes(lineGroup, drawables, begin, middle, vertices);
+        right = buildLineNodes(lineGroup, drawables, middle, end, vertices);
+        lineGroup->nodes[nodeIndex].left = left;
+        lineGroup->nodes[nodeIndex].right = right;
+        lineGroup->nodes[nodeIndex].hasLevels = lineGroup->nodes.at(left).hasLevels || lineGroup->nodes.at(right).hasLevels;
     }
 
-    m_propertySignalMapper->setMapping(item, item);
-    connect(item, SIGNAL(needsUpdate()), m_propertySignalMapper, SLOT(map()));
-    connect(this, SIGNAL(drawableSelected(void*)), item, SLOT(selectDrawable(void*)), Qt::QueuedConnection);
-    emit glItemsChanged(glItems());
+    lineGroup->nodes[nodeIndex].count = vertices.size() - lineGroup->first - node.first;
+    lineGroup->nodes[nodeIndex].drawableCount = lineGroup->drawables.size() - node.firstDrawable;
+
+    return nodeIndex;
 }
 
-void QGLView::removeGlItem(int index)
+void QGLView::unpackLineVertices(const QGLView::LineGroup &lineGroup, const QVector<PackedLineVertex> &packedVertices,
+                                 const QVector<GLushort> &indices, int first, int count, QVector<LineVertex> &vertices) const
 {
-    QGLItem *item = m_glItems.takeAt(index);
+    QGLLinePacker(lineGroup.resolution).unpack(lineGroup.chunks, packedVertices.constData() + lineGroup.firstVertex,
+                                               indices.constData() + lineGroup.first, first - lineGroup.first, count, vertices);
+}
 
-    if (m_initialized) {
-        clearGLItem(item);
-        update();
-    }
+void QGLView::setLineAttributeBuffers(int firstVertex)
+{
+    // ES2 has no base vertex, the attributes of every chunk start at its first vertex instead
+    m_lineVertexBuffer->bind();
+    // the quantized values are passed as they are, setAttributeBuffer would normalize them
+    glVertexAttribPointer(m_linePositionLocation, 3, GL_UNSIGNED_SHORT, GL_FALSE, sizeof(PackedLineVertex),
+                          (const void *)(firstVertex * sizeof(PackedLineVertex)));
+    glVertexAttribPointer(m_lineSequenceLocation, 1, GL_UNSIGNED_SHORT, GL_FALSE, sizeof(PackedLineVertex),
+                          (const void *)(firstVertex * sizeof(PackedLineVertex) + 3*sizeof(GLushort)));
+    m_lineVertexBuffer->release();
+    m_lineColorBuffer->bind();
+    m_lineProgram->setAttributeBuffer(m_lineColorLocation, GL_UNSIGNED_BYTE,
+                                      firstVertex * sizeof(LineColor), 4, sizeof(LineColor));
+    m_lineProgram->setAttributeBuffer(m_lineBackplotColorLocation, GL_UNSIGNED_BYTE,
+                                      firstVertex * sizeof(LineColor) + sizeof(GLcolorRGBA), 4, sizeof(LineColor));
+    m_lineColorBuffer->release();
+}
 
-    delete m_drawableListMap.take(item);
+void QGLView::drawLineRange(const QGLView::LineGroup &lineGroup, int first, int count)
+{
+    int chunkIndex = QGLLinePacker::chunkAt(lineGroup.chunks, first);
+    int end = first + count;
 
-    m_propertySignalMapper->removeMappings(item);
-    disconnect(item, SIGNAL(propertyChanged()), m_propertySignalMapper, SLOT(map()));
-    disconnect(this, SIGNAL(drawableSelected(void*)), item, SLOT(selectDrawable(void*)));
-    emit glItemsChanged(glItems());
+    // every chunk has its own quantization range and index base, ranges crossing chunks are split
+    while (first < end)
+    {
+        const VertexChunk &chunk = lineGroup.chunks.at(chunkIndex);
+        int chunkEnd = ((chunkIndex + 1) < lineGroup.chunks.size()) ? lineGroup.chunks.at(chunkIndex + 1).first : lineGroup.count;
+        int drawEnd = qMin(end, chunkEnd);
+
+        setLineAttributeBuffers(lineGroup.firstVertex + chunk.firstVertex);
+        m_lineProgram->setUniformValue(m_lineChunkOriginLocation, chunk.origin);
+        m_lineProgram->setUniformValue(m_lineChunkStippleOriginLocation, chunk.stippleOrigin);
+        m_lineProgram->setUniformValue(m_lineChunkStippleLengthLocation, chunk.stippleLength);
+        m_lineProgram->setUniformValue(m_lineChunkSequenceOriginLocation, chunk.sequenceOrigin);
+        glDrawElements(GL_LINES, drawEnd - first, GL_UNSIGNED_SHORT,
+                       (const void *)((lineGroup.first + first) * sizeof(GLushort)));
+
+        first = drawEnd;
+        chunkIndex++;
+    }
 }
 
-void QGLView::removeGlItem(QGLItem *item)
+void QGLView::cullLineNodes(const QGLView::LineGroup &lineGroup, int nodeIndex, bool inside)
 {
-    for (int i = 0; i < m_glItems.size(); ++i)
+    const BoundingNode &node = lineGroup.nodes.at(nodeIndex);
+
+    if (!inside)
     {
-        if (m_glItems.at(i) == item)
+        CullResult result = cullBoundingBox(node.bounds, m_frustumPlanes);
+        if (result == Outside)
         {
-            removeGlItem(i);
             return;
         }
+        inside = (result == Inside);
     }
-}
 
-void QGLView::clearGlItems()
-{
-    for (int i = (m_glItems.size()-1); i >= 0; i--)
+    if ((inside && !node.hasLevels) || ((node.left == -1) && (node.level == -1)))
     {
-        removeGlItem(i);
+        appendLineBatch(lineGroup.width, lineGroup.first + node.first, node.count);
     }
-}
+    else if (node.left == -1)
+    {
+        // a level chunk is replaced by the coarsest level that stays below the pixel tolerance
+        const LineLevel &lineLevel = lineGroup.levels.at(node.level);
+        int level = selectLineLevel(lineLevel);
 
-void QGLView::prepare(QGLItem *glItem)
-{
-    m_currentDrawableList = m_drawableListMap.value(glItem);
-    m_currentGlItem = glItem;
-    resetTransformations(true); // reset all tranformations for a clean start
-    translate(glItem->position());
-    rotate(glItem->rotation());
-    scale(glItem->scale());
+        if (level == -1)
+        {
+            appendLineBatch(lineGroup.width, lineGroup.first + node.first, node.count);
+        }
+        else
+        {
+            appendLineBatch(lineGroup.width, lineGroup.first + lineLevel.first[level], lineLevel.count[level]);
+        }
+    }
+    else
+    {
+        cullLineNodes(lineGroup, node.left, inside);
+        cullLineNodes(lineGroup, node.right, inside);
+    }
 }
 
-QQmlListProperty<QGLItem> QGLView::glItems()
+const QGLView::LineLevelChunk *QGLView::representedLineLevelChunk(int index) const
 {
-    return QQmlListProperty<QGLItem>(this, m_glItems);
-}
+    const LineParameters &lineParameters = m_linePool.at(index);
+    int chunkIndex;
 
-int QGLView::glItemCount() const
-{
-    return m_glItems.count();
-}
+    if ((lineParameters.levelChunk == 0) || (lineParameters.level != -1))
+    {
+        return NULL;
+    }
 
-QGLItem *QGLView::glItem(int index) const
-{
-    return m_glItems.at(index);
-}
+    chunkIndex = m_lineLevelChunkPool.indexOf(lineParameters.levelChunk);
+    if (chunkIndex == -1)
+    {
+        return NULL;
+    }
 
-void QGLView::paint(QPainter *painter)
-{
-    painter->beginNativePainting();
-    paint();
-    painter->endNativePainting();
-}
+    // only the first drawable of a valid chunk represents it
+    const LineLevelChunk &levelChunk = m_lineLevelChunkPool.at(chunkIndex);
+    if (!levelChunk.valid || (levelChunk.drawables.first() != m_linePool.handleAt(index)))
+    {
+        return NULL;
+    }
 
-void QGLView::color(float r, float g, float b, float a)
-{
-    color(QColor((int)(255.0*r), (int)(255.0*g), (int)(255.0*b), (int)(255.0*a)));
+    return &levelChunk;
 }
 
-void QGLView::color(const QColor &color)
+void QGLView::updateLineLevelChunks()
 {
-    m_modelParameters->color = color;
-    m_lineParameters->color = color;
-    m_textParameters->color = color;
-}
+    // removing a drawable invalidates its chunk, chunks without simplified drawables belong to removed items
+    for (int i = (m_lineLevelChunkPool.size() - 1); i >= 0; --i)
+    {
+        LineLevelChunk &levelChunk = m_lineLevelChunkPool[i];
+        bool levelsAlive = false;
 
-void QGLView::translate(float x, float y, float z)
-{
-    translate(QVector3D(x, y, z));
-}
+        levelChunk.valid = true;
+        for (int level = 0; level < QGLSceneBuffer::LevelCount; ++level)
+        {
+            if (levelChunk.levels[level] == 0)
+            {
+                continue;
+            }
+
+            if (m_linePool.indexOf(levelChunk.levels[level]) != -1)
+            {
+                levelsAlive = true;
+            }
+            else
+            {
+                levelChunk.valid = false;
+            }
+        }
 
-void QGLView::translate(const QVector3D &vector)
-{
-    m_modelParameters->modelMatrix.translate(vector);
-    m_lineParameters->modelMatrix.translate(vector);
-    m_textParameters->modelMatrix.translate(vector);
-}
+        if (!levelsAlive)
+        {
+            m_lineLevelChunkPool.remove(m_lineLevelChunkPool.handleAt(i));
+            continue;
+        }
 
-void QGLView::rotate(float angle, float x, float y, float z)
-{
-    rotate(angle, QVector3D(x, y, z));
+        for (int j = 0; (j < levelChunk.drawables.size()) && levelChunk.valid; ++j)
+        {
+            levelChunk.valid = (m_linePool.indexOf(levelChunk.drawables.at(j)) != -1);
+        }
+    }
 }
 
-void QGLView::rotate(float angle, const QVector3D &axis)
+void QGLView::updateLineLevelColors()
 {
-    m_modelParameters->modelMatrix.rotate(angle, axis);
-    m_lineParameters->modelMatrix.rotate(angle, axis);
-    m_textParameters->modelMatrix.rotate(angle, axis);
-}
+    // chunks with mixed colors, e.g. with selected or active lines, are drawn at full detail
+    for (int i = 0; i < m_dirtyLineLevelChunks.size(); ++i)
+    {
+        LineLevelChunk *levelChunk = m_lineLevelChunkPool.value(m_dirtyLineLevelChunks.at(i));
+        QColor color;
+        QColor backplotColor;
+        bool first = true;
 
-void QGLView::rotate(const QQuaternion &quaternion)
+        if (levelChunk == NULL)
+        {
+            continue;
+        }
+
+        levelChunk->colorDirty = false;
+        levelChunk->uniform = true;
+        for (int j = 0; j < levelChunk->drawables.size(); ++j)
+        {
+            const LineParameters *lineParameters = m_linePool.value(levelChunk->drawables.at(j));
+
+            if (lineParameters == NULL)
+            {
+                continue;
+            }
+
+            if (first)
+            {
+                color = lineParameters->color;
+                backplotColor = lineParameters->backplotColor;
+                first = false;
+            }
+            else if ((lineParameters->color != color) || (lineParameters->backplotColor != backplotColor))
+            {
+                levelChunk->uniform = false;
+                break;
+            }
+        }
+
+        if (!levelChunk->uniform)
+        {
+            continue;
+        }
+
+        // the simplified drawables take the common colors, the backplot itself is resolved in the shader
+        for (int level = 0; level < QGLSceneBuffer::LevelCount; ++level)
+        {
+            LineParameters *lineParameters = m_linePool.value(levelChunk->levels[level]);
+
+            if ((lineParameters != NULL)
+                && ((lineParameters->color != color) || (lineParameters->backplotColor != backplotColor)))
+            {
+                lineParameters->color = color;
+                lineParameters->backplotColor = backplotColor;
+                updateLineVertexColor(lineParameters);
+            }
+        }
+    }
+    m_dirtyLineLevelChunks.clear();
+}
+
+int QGLView::selectLineLevel(const QGLView::LineLevel &lineLevel) const
 {
-    m_modelParameters->modelMatrix.rotate(quaternion);
-    m_lineParameters->modelMatrix.rotate(quaternion);
-    m_textParameters->modelMatrix.rotate(quaternion);
+    QMatrix4x4 viewProjectionMatrix = m_thread_projectionMatrix * m_thread_viewMatrix;
+    qreal pixelScale = qAbs(m_thread_projectionMatrix(1, 1)) * m_viewportSize.height() / 2.0;
+    qreal tolerance = m_thread_interacting ? InteractionLevelTolerance : LineLevelTolerance;
+    int chunkIndex = m_lineLevelChunkPool.indexOf(lineLevel.chunk);
+    qreal nearestDepth = 0.0;
+    int level = -1;
+
+    if ((chunkIndex == -1) || !m_lineLevelChunkPool.at(chunkIndex).uniform)
+    {
+        return -1;
+    }
+
+    // the nearest corner of the bounds gives the largest projected size of the tolerance
+    const BoundingBox &bounds = m_lineLevelChunkPool.at(chunkIndex).bounds;
+    for (int i = 0; i < 8; ++i)
+    {
+        QVector4D corner((i & 1) ? bounds.maximum.x() : bounds.minimum.x(),
+                         (i & 2) ? bounds.maximum.y() : bounds.minimum.y(),
+                         (i & 4) ? bounds.maximum.z() : bounds.minimum.z(),
+                         1.0);
+        qreal depth = (viewProjectionMatrix * corner).w();
+
+        if ((i == 0) || (depth < nearestDepth))
+        {
+            nearestDepth = depth;
+        }
+    }
+
+    if (nearestDepth <= 0.0)
+    {
+        return -1;  // the camera is inside of the bounds
+    }
+
+    for (int i = 0; i < QGLSceneBuffer::LevelCount; ++i)
+    {
+        if ((lineLevel.count[i] > 0) && ((lineLevel.tolerance[i] * pixelScale / nearestDepth) < tolerance))
+        {
+            level = i;
+        }
+    }
+
+    return level;
+}
+
+void QGLView::appendLineBatch(GLfloat width, int first, int count)
+{
+    if (count == 0)
+    {
+        return;
+    }
+
+    // neighboring ranges are merged into one draw call
+    if (!m_lineBatches.isEmpty())
+    {
+        LineBatch &lastBatch = m_lineBatches.last();
+        if ((lastBatch.width == width) && ((lastBatch.first + lastBatch.count) == first))
+        {
+            lastBatch.count += count;
+            return;
+        }
+    }
+
+    LineBatch lineBatch;
+    lineBatch.width = width;
+    lineBatch.first = first;
+    lineBatch.count = count;
+    m_lineBatches.append(lineBatch);
+}
+
+void QGLView::drawArcs()
+{
+    QMatrix4x4 viewProjectionMatrix = m_thread_projectionMatrix * m_thread_viewMatrix;
+    qreal pixelScale = qAbs(m_thread_projectionMatrix(1, 1)) * m_viewportSize.height() / 2.0;
+    QVector<int> batchSegments;
+    bool visible = false;
+
+    updateArcInstanceBuffer();
+
+    // whole batches are culled, the shader reduces the segments of every arc to its projected radius
+    batchSegments.resize(m_arcBatches.size());
+    for (int i = 0; i < m_arcBatches.size(); ++i)
+    {
+        const ArcBatch &arcBatch = m_arcBatches.at(i);
+
+        if (cullBoundingBox(arcBatch.bounds, m_frustumPlanes) == Outside)
+        {
+            batchSegments[i] = 0;
+        }
+        else
+        {
+            batchSegments[i] = arcBatchSegments(arcBatch, viewProjectionMatrix, pixelScale);
+            visible = true;
+        }
+    }
+
+    if (!visible)
+    {
+        return;
+    }
+
+    if (m_thread_selectionModeActive)
+    {
+        // the instances carry their pool index, the shader adds it to the offset
+        m_arcProgram->setUniformValue(m_arcIdOffsetLocation, (GLfloat)m_currentDrawableId);
+        m_selectionTypeMap.insert(m_currentDrawableId, Arc);
+        m_currentDrawableId += m_arcPool.size();
+    }
+
+    m_arcProgram->setUniformValue(m_arcPixelScaleLocation, (GLfloat)pixelScale);
+    m_arcProgram->setUniformValue(m_arcToleranceLocation, (GLfloat)ArcTolerance);
+
+    m_arcSegmentBuffer->bind();
+    m_arcProgram->enableAttributeArray(m_arcSegmentLocation);
+    m_arcProgram->setAttributeBuffer(m_arcSegmentLocation, GL_FLOAT, 0, 1, sizeof(GLfloat));
+    m_arcSegmentBuffer->release();
+
+    if (m_drawArraysInstanced != NULL)
+    {
+        m_arcInstanceBuffer->bind();
+        for (int i = 0; i < 3; ++i)
+        {
+            m_arcProgram->enableAttributeArray(m_arcModelRowLocation[i]);
+            m_vertexAttribDivisor(m_arcModelRowLocation[i], 1);
+        }
+        m_arcProgram->enableAttributeArray(m_arcLocation);
+        m_vertexAttribDivisor(m_arcLocation, 1);
+        m_arcProgram->enableAttributeArray(m_arcSweepLocation);
+        m_vertexAttribDivisor(m_arcSweepLocation, 1);
+        m_arcProgram->enableAttributeArray(m_arcColorLocation);
+        m_vertexAttribDivisor(m_arcColorLocation, 1);
+        m_arcProgram->enableAttributeArray(m_arcBackplotColorLocation);
+        m_vertexAttribDivisor(m_arcBackplotColorLocation, 1);
+        m_arcProgram->enableAttributeArray(m_arcSequenceLocation);
+        m_vertexAttribDivisor(m_arcSequenceLocation, 1);
+
+        // one draw call per batch, the instance attributes start at the first arc of the batch
+        for (int i = 0; i < m_arcBatches.size(); ++i)
+        {
+            const ArcBatch &arcBatch = m_arcBatches.at(i);
+            int offset = arcBatch.first * sizeof(ArcInstance);
+
+            if (batchSegments.at(i) == 0)
+            {
+                continue;
+            }
+
+            for (int j = 0; j < 3; ++j)
+            {
+                m_arcProgram->setAttributeBuffer(m_arcModelRowLocation[j], GL_FLOAT, offset + j*4*sizeof(GLfloat), 4, sizeof(ArcInstance));
+            }
+            m_arcProgram->setAttributeBuffer(m_arcLocation, GL_FLOAT, offset + 12*sizeof(GLfloat), 4, sizeof(ArcInstance));
+            m_arcProgram->setAttributeBuffer(m_arcSweepLocation, GL_FLOAT, offset + 16*sizeof(GLfloat), 4, sizeof(ArcInstance));
+            m_arcProgram->setAttributeBuffer(m_arcColorLocation, GL_UNSIGNED_BYTE, offset + 20*sizeof(GLfloat), 4, sizeof(ArcInstance));
+            m_arcProgram->setAttributeBuffer(m_arcBackplotColorLocation, GL_UNSIGNED_BYTE, offset + 20*sizeof(GLfloat) + sizeof(GLcolorRGBA), 4, sizeof(ArcInstance));
+            m_arcProgram->setAttributeBuffer(m_arcSequenceLocation, GL_FLOAT, offset + 20*sizeof(GLfloat) + 2*sizeof(GLcolorRGBA), 1, sizeof(ArcInstance));
+            m_arcProgram->setUniformValue(m_arcSegmentCountLocation, (GLfloat)batchSegments.at(i));
+            m_arcProgram->setUniformValue(m_arcExecutedSequenceLocation, m_backplotSequences.value(arcBatch.item, 0.0));
+            glLineWidth(arcBatch.width);
+
+            m_drawArraysInstanced(GL_LINES, 0, batchSegments.at(i) * 2, arcBatch.count);
+        }
+
+        for (int i = 0; i < 3; ++i)
+        {
+            m_vertexAttribDivisor(m_arcModelRowLocation[i], 0);
+            m_arcProgram->disableAttributeArray(m_arcModelRowLocation[i]);
+        }
+        m_vertexAttribDivisor(m_arcLocation, 0);
+        m_arcProgram->disableAttributeArray(m_arcLocation);
+        m_vertexAttribDivisor(m_arcSweepLocation, 0);
+        m_arcProgram->disableAttributeArray(m_arcSweepLocation);
+        m_vertexAttribDivisor(m_arcColorLocation, 0);
+        m_arcProgram->disableAttributeArray(m_arcColorLocation);
+        m_vertexAttribDivisor(m_arcBackplotColorLocation, 0);
+        m_arcProgram->disableAttributeArray(m_arcBackplotColorLocation);
+        m_vertexAttribDivisor(m_arcSequenceLocation, 0);
+        m_arcProgram->disableAttributeArray(m_arcSequenceLocation);
+        m_arcInstanceBuffer->release();
+    }
+    else    // no instancing available, use constant attributes per arc
+    {
+        for (int i = 0; i < m_arcBatches.size(); ++i)
+        {
+            const ArcBatch &arcBatch = m_arcBatches.at(i);
+
+            if (batchSegments.at(i) == 0)
+            {
+                continue;
+            }
+
+            m_arcProgram->setUniformValue(m_arcSegmentCountLocation, (GLfloat)batchSegments.at(i));
+            m_arcProgram->setUniformValue(m_arcExecutedSequenceLocation, m_backplotSequences.value(arcBatch.item, 0.0));
+            glLineWidth(arcBatch.width);
+            for (int j = arcBatch.first; j < (arcBatch.first + arcBatch.count); ++j)
+            {
+                const ArcInstance &arcInstance = m_arcInstances.at(m_arcBatchIndices.at(j));
+                const GLfloat *rows = arcInstance.modelRows;
+
+                for (int k = 0; k < 3; ++k)
+                {
+                    m_arcProgram->setAttributeValue(m_arcModelRowLocation[k], rows[k*4], rows[k*4 + 1], rows[k*4 + 2], rows[k*4 + 3]);
+                }
+                m_arcProgram->setAttributeValue(m_arcLocation, arcInstance.arc[0], arcInstance.arc[1], arcInstance.arc[2], arcInstance.arc[3]);
+                m_arcProgram->setAttributeValue(m_arcSweepLocation, arcInstance.sweep[0], arcInstance.sweep[1], arcInstance.sweep[2], arcInstance.sweep[3]);
+                m_arcProgram->setAttributeValue(m_arcColorLocation, QColor(arcInstance.color.r, arcInstance.color.g, arcInstance.color.b, arcInstance.color.a));
+                m_arcProgram->setAttributeValue(m_arcBackplotColorLocation, QColor(arcInstance.backplotColor.r, arcInstance.backplotColor.g,
+                                                                                   arcInstance.backplotColor.b, arcInstance.backplotColor.a));
+                m_arcProgram->setAttributeValue(m_arcSequenceLocation, arcInstance.sequence);
+
+                glDrawArrays(GL_LINES, 0, batchSegments.at(i) * 2);
+            }
+        }
+    }
+
+    m_arcProgram->disableAttributeArray(m_arcSegmentLocation);
+}
+
+void QGLView::appendArcInstance(const ArcParameters &parameters)
+{
+    ArcInstance arcInstance;
+
+    for (int i = 0; i < 3; ++i)
+    {
+        for (int j = 0; j < 4; ++j)
+        {
+            arcInstance.modelRows[i*4 + j] = parameters.modelMatrix(i, j);
+        }
+    }
+    arcInstance.arc[0] = parameters.x;
+    arcInstance.arc[1] = parameters.y;
+    arcInstance.arc[2] = parameters.radius;
+    arcInstance.arc[3] = parameters.startAngle;
+    arcInstance.sweep[0] = parameters.sweepAngle;
+    arcInstance.sweep[1] = parameters.helixOffset;
+    arcInstance.sweep[2] = parameters.stippleLength;
+    arcInstance.sweep[3] = m_arcInstances.size();
+    arcInstance.sequence = parameters.sequence;
+
+    m_arcInstances.append(arcInstance);
+    m_arcBounds.append(arcBounds(parameters));
+    updateArcInstanceColor(m_arcInstances.size() - 1);
+}
+
+void QGLView::removeArcInstance(int index)
+{
+    int lastIndex = m_arcInstances.size() - 1;
+
+    // mirrors the swap remove of the drawable pool
+    if (index != lastIndex)
+    {
+        m_arcInstances[index] = m_arcInstances.at(lastIndex);
+        m_arcInstances[index].sweep[3] = index;
+        m_arcBounds[index] = m_arcBounds.at(lastIndex);
+    }
+    m_arcInstances.removeLast();
+    m_arcBounds.removeLast();
+    m_arcInstancesChanged = true;
+}
+
+void QGLView::updateArcInstanceColor(int index)
+{
+    const ArcParameters &arcParameters = m_arcPool.at(index);
+    const QColor &backplotColor = arcParameters.backplotColor.isValid() ? arcParameters.backplotColor : arcParameters.color;
+    ArcInstance &arcInstance = m_arcInstances[index];
+
+    arcInstance.color.r = arcParameters.color.red();
+    arcInstance.color.g = arcParameters.color.green();
+    arcInstance.color.b = arcParameters.color.blue();
+    arcInstance.color.a = arcParameters.color.alpha();
+    arcInstance.backplotColor.r = backplotColor.red();
+    arcInstance.backplotColor.g = backplotColor.green();
+    arcInstance.backplotColor.b = backplotColor.blue();
+    arcInstance.backplotColor.a = backplotColor.alpha();
+    m_arcInstancesChanged = true;
+}
+
+void QGLView::updateArcInstanceBuffer()
+{
+    QVector<int> insertPositions;
+    QVector<ArcInstance> instances;
+
+    if (!m_arcInstancesChanged)
+    {
+        return;
+    }
+
+    // arcs are grouped by width and item, the widths and items of a view are few
+    m_arcBatches.clear();
+    for (int i = 0; i < m_arcInstances.size(); ++i)
+    {
+        const ArcParameters &arcParameters = m_arcPool.at(i);
+        const BoundingBox &bounds = m_arcBounds.at(i);
+        int batchIndex = -1;
+
+        for (int j = 0; j < m_arcBatches.size(); ++j)
+        {
+            if ((m_arcBatches.at(j).width == arcParameters.width) && (m_arcBatches.at(j).item == arcParameters.item))
+            {
+                batchIndex = j;
+                break;
+            }
+        }
+
+        if (batchIndex == -1)
+        {
+            ArcBatch arcBatch;
+            arcBatch.width = arcParameters.width;
+            arcBatch.item = arcParameters.item;
+            arcBatch.first = 0;
+            arcBatch.count = 0;
+            arcBatch.bounds = bounds;
+            arcBatch.worldRadius = 0.0;
+            arcBatch.sweepAngle = 0.0;
+            m_arcBatches.append(arcBatch);
+            batchIndex = m_arcBatches.size() - 1;
+        }
+
+        ArcBatch &arcBatch = m_arcBatches[batchIndex];
+        arcBatch.count++;
+        expandBoundingBox(&arcBatch.bounds, bounds.minimum);
+        expandBoundingBox(&arcBatch.bounds, bounds.maximum);
+        arcBatch.worldRadius = qMax(arcBatch.worldRadius, arcParameters.worldRadius);
+        arcBatch.sweepAngle = qMax(arcBatch.sweepAngle, qAbs(arcParameters.sweepAngle));
+    }
+
+    insertPositions.resize(m_arcBatches.size());
+    for (int i = 0, first = 0; i < m_arcBatches.size(); ++i)
+    {
+        m_arcBatches[i].first = first;
+        insertPositions[i] = first;
+        first += m_arcBatches.at(i).count;
+    }
+
+    // the instances keep their pool index as pick id, only their position in the buffer changes
+    m_arcBatchIndices.resize(m_arcInstances.size());
+    for (int i = 0; i < m_arcInstances.size(); ++i)
+    {
+        const ArcParameters &arcParameters = m_arcPool.at(i);
+
+        for (int j = 0; j < m_arcBatches.size(); ++j)
+        {
+            if ((m_arcBatches.at(j).width == arcParameters.width) && (m_arcBatches.at(j).item == arcParameters.item))
+            {
+                m_arcBatchIndices[insertPositions[j]++] = i;
+                break;
+            }
+        }
+    }
+
+    if (m_drawArraysInstanced != NULL)
+    {
+        instances.resize(m_arcBatchIndices.size());
+        for (int i = 0; i < m_arcBatchIndices.size(); ++i)
+        {
+            instances[i] = m_arcInstances.at(m_arcBatchIndices.at(i));
+        }
+
+        m_arcInstanceBuffer->bind();
+        m_arcInstanceBuffer->allocate(instances.constData(), instances.size() * sizeof(ArcInstance));
+        m_arcInstanceBuffer->release();
+    }
+
+    m_arcInstancesChanged = false;
+}
+
+int QGLView::arcBatchSegments(const ArcBatch &arcBatch, const QMatrix4x4 &viewProjectionMatrix, qreal pixelScale) const
+{
+    qreal nearest = 0.0;
+    qreal pixelRadius;
+    int segments;
+
+    // the corner closest to the camera limits the segments any arc of the batch can need
+    for (int i = 0; i < 8; ++i)
+    {
+        QVector4D corner((i & 1) ? arcBatch.bounds.maximum.x() : arcBatch.bounds.minimum.x(),
+                         (i & 2) ? arcBatch.bounds.maximum.y() : arcBatch.bounds.minimum.y(),
+                         (i & 4) ? arcBatch.bounds.maximum.z() : arcBatch.bounds.minimum.z(),
+                         1.0);
+        qreal w = (viewProjectionMatrix * corner).w();
+
+        if (w <= 0.0)
+        {
+            return MaxArcSegments;  // the camera is inside of the bounds
+        }
+        nearest = (i == 0) ? w : qMin(nearest, w);
+    }
+
+    // a segment of angle a deviates r * a^2 / 8 from the arc
+    pixelRadius = arcBatch.worldRadius * pixelScale / nearest;
+    segments = qCeil(arcBatch.sweepAngle * qSqrt(pixelRadius / (8.0 * ArcTolerance)));
+
+    return qBound(1, segments, MaxArcSegments);
+}
+
+QGLView::BoundingBox QGLView::arcBounds(const ArcParameters &parameters) const
+{
+    qreal startAngle = parameters.startAngle;
+    qreal endAngle = parameters.startAngle + parameters.sweepAngle;
+    qreal firstAngle = qMin(startAngle, endAngle);
+    qreal lastAngle = qMax(startAngle, endAngle);
+    BoundingBox bounds;
+
+    bounds.minimum = QVector3D(parameters.x + qCos(startAngle) * parameters.radius,
+                               parameters.y + qSin(startAngle) * parameters.radius,
+                               0.0);
+    bounds.maximum = bounds.minimum;
+    expandBoundingBox(&bounds, QVector3D(parameters.x + qCos(endAngle) * parameters.radius,
+                                         parameters.y + qSin(endAngle) * parameters.radius,
+                                         parameters.helixOffset));
+
+    // the extreme points of the circle within the swept range
+    for (int i = qCeil(firstAngle / (M_PI / 2.0)); (i * M_PI / 2.0) <= lastAngle; ++i)
+    {
+        expandBoundingBox(&bounds, QVector3D(parameters.x + qCos(i * M_PI / 2.0) * parameters.radius,
+                                             parameters.y + qSin(i * M_PI / 2.0) * parameters.radius,
+                                             0.0));
+        if ((lastAngle - firstAngle) >= (2.0 * M_PI))
+        {
+            bounds.minimum.setX(parameters.x - parameters.radius);  // full revolution
+            bounds.minimum.setY(parameters.y - parameters.radius);
+            bounds.maximum.setX(parameters.x + parameters.radius);
+            bounds.maximum.setY(parameters.y + parameters.radius);
+            break;
+        }
+    }
+
+    return transformBoundingBox(bounds, parameters.modelMatrix);
+}
+
+QVector3D QGLView::arcPoint(const ArcInstance &instance, qreal t) const
+{
+    // same calculation as the arc vertex shader
+    qreal angle = instance.arc[3] + instance.sweep[0] * t;
+    QVector4D point(instance.arc[0] + instance.arc[2] * qCos(angle),
+                    instance.arc[1] + instance.arc[2] * qSin(angle),
+                    instance.sweep[1] * t,
+                    1.0);
+    const GLfloat *rows = instance.modelRows;
+
+    return QVector3D(QVector4D::dotProduct(QVector4D(rows[0], rows[1], rows[2], rows[3]), point),
+                     QVector4D::dotProduct(QVector4D(rows[4], rows[5], rows[6], rows[7]), point),
+                     QVector4D::dotProduct(QVector4D(rows[8], rows[9], rows[10], rows[11]), point));
+}
+
+void QGLView::drawTexts()
+{
+    if (m_textPool.isEmpty())
+    {
+        return;
+    }
+
+    if (m_thread_selectionModeActive)
+    {
+        m_selectionTypeMap.insert(m_currentDrawableId, Text);
+        m_textProgram->setUniformValue(m_textIdOffsetLocation, (GLfloat)m_currentDrawableId);
+    }
+
+    updateTextVertexBuffer();
+    updateGlyphTexture();
+
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, m_glyphTexture);
+    m_textProgram->setUniformValue(m_textTextureLocation, 0);
+    m_textProgram->setUniformValue(m_textTextureScaleLocation, QVector2D(1.0 / m_glyphTextureSize.width(),
+                                                                         1.0 / m_glyphTextureSize.height()));
+
+    m_textVertexBuffer->bind();
+    m_textProgram->enableAttributeArray(m_textPositionLocation);
+    m_textProgram->enableAttributeArray(m_textTexCoordinateLocation);
+    m_textProgram->enableAttributeArray(m_textColorLocation);
+    m_textProgram->enableAttributeArray(m_textPickIdLocation);
+    m_textProgram->setAttributeBuffer(m_textPositionLocation, GL_FLOAT, 0, 3, sizeof(TextVertex));
+    m_textProgram->setAttributeBuffer(m_textTexCoordinateLocation, GL_FLOAT, 3*sizeof(GLfloat), 2, sizeof(TextVertex));
+    m_textProgram->setAttributeBuffer(m_textColorLocation, GL_UNSIGNED_BYTE, 5*sizeof(GLfloat), 4, sizeof(TextVertex));
+    m_textProgram->setAttributeBuffer(m_textPickIdLocation, GL_FLOAT, 5*sizeof(GLfloat) + sizeof(GLcolorRGBA), 1, sizeof(TextVertex));
+
+    // all texts share the atlas, so they are drawn at once
+    glDrawArrays(GL_TRIANGLES, 0, m_textVertices.size());
+
+    m_textProgram->disableAttributeArray(m_textPositionLocation);
+    m_textProgram->disableAttributeArray(m_textTexCoordinateLocation);
+    m_textProgram->disableAttributeArray(m_textColorLocation);
+    m_textProgram->disableAttributeArray(m_textPickIdLocation);
+    m_textVertexBuffer->release();
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    if (m_thread_selectionModeActive)
+    {
+        m_currentDrawableId += m_textPool.size();
+    }
+}
+
+void QGLView::appendTextVertices(TextParameters *textParameters, const QString &text, const QFont &font)
+{
+    // corners of the two triangles of a quad, 0 is left or bottom
+    static const int corners[6][2] = {{0, 1}, {0, 0}, {1, 1}, {0, 0}, {1, 0}, {1, 1}};
+    QFontMetricsF fontMetrics(m_glyphAtlas.glyphFont(font));
+    QVector<uint> characters = text.toUcs4();
+    QList<QGLGlyphAtlas::Glyph> glyphs;
+    QList<qreal> pens;
+    qreal scale = 1.0 / fontMetrics.height();    // texts are one unit high
+    qreal baseline = fontMetrics.descent();
+    qreal width = 0.0;
+    qreal offset = 0.0;
+
+    for (int i = 0; i < characters.size(); ++i)
+    {
+        QGLGlyphAtlas::Glyph glyph = m_glyphAtlas.glyph(font, characters.at(i));
+        glyphs.append(glyph);
+        pens.append(width);
+        width += glyph.advance;
+    }
+
+    if (textParameters->alignment == AlignCenter)
+    {
+        offset = -width / 2.0;
+    }
+    else if (textParameters->alignment == AlignRight)
+    {
+        offset = -width;
+    }
+
+    textParameters->vertices.clear();
+    textParameters->vertices.reserve(glyphs.size() * 12);
+    for (int i = 0; i < glyphs.size(); ++i)
+    {
+        const QGLGlyphAtlas::Glyph &glyph = glyphs.at(i);
+
+        if (glyph.textureRect.isEmpty())
+        {
+            continue;   // e.g. spaces
+        }
+
+        // the second quad is mirrored, so the text can be read from behind
+        for (int side = 0; side < 2; ++side)
+        {
+            for (int k = 0; k < 6; ++k)
+            {
+                TextVertex textVertex;
+                QVector3D position;
+                qreal x = pens.at(i) + (corners[k][0] ? glyph.bounds.right() : glyph.bounds.left());
+                qreal y = baseline - (corners[k][1] ? glyph.bounds.top() : glyph.bounds.bottom());
+
+                if (side == 1)
+                {
+                    x = width - x;
+                }
+
+                position = textParameters->modelMatrix.map(QVector3D((x + offset) * scale, y * scale, 0.0));
+                textVertex.position.x = position.x();
+                textVertex.position.y = position.y();
+                textVertex.position.z = position.z();
+                textVertex.texCoordinate.x = corners[k][0] ? glyph.textureRect.right() : glyph.textureRect.left();
+                textVertex.texCoordinate.y = corners[k][1] ? glyph.textureRect.top() : glyph.textureRect.bottom();
+                textParameters->vertices.append(textVertex);
+            }
+        }
+    }
+}
+
+void QGLView::updateTextVertexBuffer()
+{
+    if (!m_textGeometryChanged)
+    {
+        return;
+    }
+
+    m_textVertices.resize(0);
+    for (int i = 0; i < m_textPool.size(); ++i)
+    {
+        const TextParameters &textParameters = m_textPool.at(i);
+        int first = m_textVertices.size();
+        GLcolorRGBA color;
+        TextVertex *textVertices;
+
+        color.r = textParameters.color.red();
+        color.g = textParameters.color.green();
+        color.b = textParameters.color.blue();
+        color.a = textParameters.color.alpha();
+
+        m_textVertices += textParameters.vertices;
+        textVertices = m_textVertices.data();
+        for (int j = first; j < m_textVertices.size(); ++j)
+        {
+            textVertices[j].color = color;
+            textVertices[j].pickId = i;
+        }
+    }
+
+    m_textVertexBuffer->bind();
+    m_textVertexBuffer->allocate(m_textVertices.constData(), m_textVertices.size() * sizeof(TextVertex));
+    m_textVertexBuffer->release();
+
+    m_textGeometryChanged = false;
+}
+
+void QGLView::updateGlyphTexture()
+{
+    QSize size = m_glyphAtlas.size();
+
+    if ((m_glyphTexture != 0) && !m_glyphAtlas.isDirty())
+    {
+        return;
+    }
+
+    if (m_glyphTexture == 0)
+    {
+        glGenTextures(1, &m_glyphTexture);
+    }
+
+    glBindTexture(GL_TEXTURE_2D, m_glyphTexture);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    if (m_glyphTextureSize != size)
+    {
+        // linear filtering interpolates the distance field
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_ALPHA, size.width(), size.height(), 0,
+                     GL_ALPHA, GL_UNSIGNED_BYTE, m_glyphAtlas.data());
+        m_glyphTextureSize = size;
+    }
+    else
+    {
+        // only the rows of new glyphs are uploaded
+        glTexSubImage2D(GL_TEXTURE_2D, 0, 0, m_glyphAtlas.dirtyFirst(),
+                        size.width(), m_glyphAtlas.dirtyLast() - m_glyphAtlas.dirtyFirst(),
+                        GL_ALPHA, GL_UNSIGNED_BYTE, m_glyphAtlas.data() + m_glyphAtlas.dirtyFirst() * size.width());
+    }
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    m_glyphAtlas.markClean();
+}
+
+void QGLView::updateGLItems()
+{
+    for (int i = 0; i < m_glItems.size(); ++i)
+    {
+        updateGLItem(m_glItems.at(i));
+    }
+}
+
+void QGLView::clearGLItem(QGLItem *item)
+{
+    removeDrawables(item);
+}
+
+void QGLView::updateGLItem(QGLItem *item)
+{
+    // items may request many updates before the next frame, they are painted once
+    if (!m_modifiedGlItems.contains(item))
+    {
+        m_modifiedGlItems.append(item);
+    }
+}
+
+void QGLView::paintGLItems()
+{
+    for (int i = 0; i < m_modifiedGlItems.size(); ++i)
+    {
+        paintGLItem(m_modifiedGlItems.at(i));
+    }
+    m_modifiedGlItems.clear();
+}
+
+void QGLView::paintGLItem(QGLItem *item)
+{
+    if (item->isCached())
+    {
+        m_layerCacheValid = false;  // the cached layer still shows the previous drawables
+    }
+
+    if (item->isVisible())
+    {
+        item->paint(this);
+    }
+    else
+    {
+        removeDrawables(item);     // if the item is not visible we remove all drawables
+    }
+}
+
+quint32 QGLView::getSelection()
+{
+    GLcolorRGBA pixels[SelectionSize * SelectionSize];
+    QMap<quint32, int> idCounts;
+    quint32 selectedId = 0;
+    int maxCount = 0;
+
+    // read the whole selection region at once
+    glReadPixels(0, 0, SelectionSize, SelectionSize, GL_RGBA, GL_UNSIGNED_BYTE, pixels);
+
+    for (int i = 0; i < (SelectionSize * SelectionSize); ++i)
+    {
+        quint32 id = ((quint32)pixels[i].r << 16) + ((quint32)pixels[i].g << 8) + (quint32)pixels[i].b;
+
+        if (id != 0)    // 0 is the background
+        {
+            idCounts[id] = idCounts.value(id, 0) + 1;
+        }
+    }
+
+    // the id that is most common in the selection wins
+    QMapIterator<quint32, int> i(idCounts);
+    while (i.hasNext()) {
+        i.next();
+        if (i.value() > maxCount)
+        {
+            selectedId = i.key();
+            maxCount = i.value();
+        }
+    }
+
+    return selectedId;
+}
+
+QGLDrawableHandle QGLView::selectedDrawable(quint32 id) const
+{
+    QMap<quint32, ModelType>::const_iterator it;
+    ModelType type;
+    int index;
+
+    it = m_selectionTypeMap.upperBound(id);
+    if ((id == 0) || (it == m_selectionTypeMap.constBegin()))
+    {
+        return 0;   // nothing selected
+    }
+
+    --it;   // the range of drawable type the id belongs to
+    type = it.value();
+    index = id - it.key();
+
+    if (type == Line)
+    {
+        return (index < m_lineSelectionHandles.size()) ? m_lineSelectionHandles.at(index) : 0;
+    }
+    else if (type == Text)
+    {
+        return (index < m_textPool.size()) ? m_textPool.handleAt(index) : 0;
+    }
+    else if (type == Arc)
+    {
+        return (index < m_arcPool.size()) ? m_arcPool.handleAt(index) : 0;
+    }
+    else if (m_modelPoolMap.contains(type))
+    {
+        QGLDrawablePool<Parameters> *modelPool = m_modelPoolMap.value(type);
+        return (index < modelPool->size()) ? modelPool->handleAt(index) : 0;
+    }
+
+    return 0;
+}
+
+void QGLView::addGlItem(QGLItem *item)
+{
+    m_glItems.append(item);
+
+    QVector<QGLDrawableHandle> *drawableList = new QVector<QGLDrawableHandle>();
+    m_drawableListMap.insert(item, drawableList);
+
+    if (m_initialized) {
+        updateGLItem(item);
+        invalidate(ItemsDirty);
+    }
+
+    m_propertySignalMapper->setMapping(item, item);
+    connect(item, SIGNAL(needsUpdate()), m_propertySignalMapper, SLOT(map()));
+    connect(this, SIGNAL(drawableSelected(QGLDrawableHandle)), item, SLOT(selectDrawable(QGLDrawableHandle)));
+    connect(this, SIGNAL(drawableHovered(QGLDrawableHandle)), item, SLOT(hoverDrawable(QGLDrawableHandle)));
+    emit glItemsChanged(glItems());
+}
+
+void QGLView::removeGlItem(int index)
+{
+    QGLItem *item = m_glItems.takeAt(index);
+
+    if (m_initialized) {
+        clearGLItem(item);
+        invalidate(ItemsDirty);
+    }
+
+    delete m_drawableListMap.take(item);
+    m_backplotSequences.remove(item);
+
+    m_propertySignalMapper->removeMappings(item);
+    disconnect(item, SIGNAL(propertyChanged()), m_propertySignalMapper, SLOT(map()));
+    disconnect(this, SIGNAL(drawableSelected(QGLDrawableHandle)), item, SLOT(selectDrawable(QGLDrawableHandle)));
+    disconnect(this, SIGNAL(drawableHovered(QGLDrawableHandle)), item, SLOT(hoverDrawable(QGLDrawableHandle)));
+    emit glItemsChanged(glItems());
+}
+
+void QGLView::removeGlItem(QGLItem *item)
+{
+    for (int i = 0; i < m_glItems.size(); ++i)
+    {
+        if (m_glItems.at(i) == item)
+        {
+            removeGlItem(i);
+            return;
+        }
+    }
+}
+
+void QGLView::clearGlItems()
+{
+    for (int i = (m_glItems.size()-1); i >= 0; i--)
+    {
+        removeGlItem(i);
+    }
+}
+
+void QGLView::prepare(QGLItem *glItem)
+{
+    m_currentDrawableList = m_drawableListMap.value(glItem);
+    m_currentGlItem = glItem;
+    resetTransformations(true); // reset all tranformations for a clean start
+    translate(glItem->position());
+    rotate(glItem->rotation());
+    scale(glItem->scale());
+}
+
+QQmlListProperty<QGLItem> QGLView::glItems()
+{
+    return QQmlListProperty<QGLItem>(this, m_glItems);
+}
+
+int QGLView::glItemCount() const
+{
+    return m_glItems.count();
+}
+
+QGLItem *QGLView::glItem(int index) const
+{
+    return m_glItems.at(index);
+}
+
+QQuickFramebufferObject::Renderer *QGLView::createRenderer() const
+{
+    return new QGLViewRenderer();
+}
+
+void QGLView::color(float r, float g, float b, float a)
+{
+    color(QColor((int)(255.0*r), (int)(255.0*g), (int)(255.0*b), (int)(255.0*a)));
+}
+
+void QGLView::color(const QColor &color)
+{
+    m_modelParameters.color = color;
+    m_lineParameters.color = color;
+    m_textParameters.color = color;
+}
+
+void QGLView::translate(float x, float y, float z)
+{
+    translate(QVector3D(x, y, z));
+}
+
+void QGLView::translate(const QVector3D &vector)
+{
+    m_modelParameters.modelMatrix.translate(vector);
+    m_lineParameters.modelMatrix.translate(vector);
+    m_textParameters.modelMatrix.translate(vector);
+}
+
+void QGLView::rotate(float angle, float x, float y, float z)
+{
+    rotate(angle, QVector3D(x, y, z));
+}
+
+void QGLView::rotate(float angle, const QVector3D &axis)
+{
+    QMatrix4x4 rotation;
+
+    // the rotation is calculated once for all stacks
+    rotation.rotate(angle, axis);
+    m_modelParameters.modelMatrix *= rotation;
+    m_lineParameters.modelMatrix *= rotation;
+    m_textParameters.modelMatrix *= rotation;
+}
+
+void QGLView::rotate(const QQuaternion &quaternion)
+{
+    QMatrix4x4 rotation;
+
+    rotation.rotate(quaternion);
+    m_modelParameters.modelMatrix *= rotation;
+    m_lineParameters.modelMatrix *= rotation;
+    m_textParameters.modelMatrix *= rotation;
 }
 
 void QGLView::scale(float x, float y, float z)
@@ -1155,9 +3359,9 @@ void QGLView::scale(float x, float y, float z)
 
 void QGLView::scale(const QVector3D &vector)
 {
-    m_modelParameters->modelMatrix.scale(vector);
-    m_lineParameters->modelMatrix.scale(vector);
-    m_textParameters->modelMatrix.scale(vector);
+    m_modelParameters.modelMatrix.scale(vector);
+    m_lineParameters.modelMatrix.scale(vector);
+    m_textParameters.modelMatrix.scale(vector);
 }
 
 void QGLView::mirror(float x, float y, float z)
@@ -1171,163 +3375,137 @@ void QGLView::mirror(const QVector3D &vector)
     int y = (int)vector.y();
     int z = (int)vector.z();
 
-    m_modelParameters->modelMatrix.scale((x == 1) ? -1.0 : 1.0,
+    m_modelParameters.modelMatrix.scale((x == 1) ? -1.0 : 1.0,
                                    (y == 1) ? -1.0 : 1.0,
                                    (z == 1) ? -1.0 : 1.0);
-    m_lineParameters->modelMatrix.scale((x == 1) ? -1.0 : 1.0,
+    m_lineParameters.modelMatrix.scale((x == 1) ? -1.0 : 1.0,
                                    (y == 1) ? -1.0 : 1.0,
                                    (z == 1) ? -1.0 : 1.0);
-    m_textParameters->modelMatrix.scale((x == 1) ? -1.0 : 1.0,
+    m_textParameters.modelMatrix.scale((x == 1) ? -1.0 : 1.0,
                                    (y == 1) ? -1.0 : 1.0,
                                    (z == 1) ? -1.0 : 1.0);
 }
 
 void QGLView::resetTransformations(bool hard)
 {
-    if (hard)
-    {
-        delete m_modelParameters;
-        m_modelParameters = m_modelParametersStack.takeFirst();
-        foreach (Parameters *parameters, m_modelParametersStack)
-        {
-            delete parameters;
-        }
-        m_modelParametersStack.clear();
-        m_modelParametersStack.push(new Parameters(m_modelParameters));
+    int top;
 
-        delete m_lineParameters;
-        m_lineParameters = m_lineParametersStack.takeFirst();
-        foreach (LineParameters *parameters, m_lineParametersStack)
-        {
-            delete parameters;
-        }
-        m_lineParametersStack.clear();
-        m_lineParametersStack.push(new LineParameters(m_lineParameters));
-
-        delete m_textParameters;
-        m_textParameters = m_textParametersStack.takeFirst();
-        foreach (TextParameters *parameters, m_textParametersStack)
-        {
-            delete parameters;
-        }
-        m_textParametersStack.clear();
-        m_textParametersStack.push(new TextParameters(m_textParameters));
-    }
-    else
+    if (hard)
     {
-        delete m_modelParameters;
-        m_modelParameters = new Parameters(m_modelParametersStack.top());
-        delete m_lineParameters;
-        m_lineParameters = new LineParameters(m_lineParametersStack.top());
-        delete m_textParameters;
-        m_textParameters = new TextParameters(m_textParametersStack.top());
+        m_parametersStackDepth = 1;
     }
+
+    // plain value copies, the line vertex storage is reused
+    top = m_parametersStackDepth - 1;
+    m_modelParameters = m_modelParametersStack.at(top);
+    m_lineParameters.assign(m_lineParametersStack.at(top));
+    m_textParameters = m_textParametersStack.at(top);
 }
 
-void *QGLView::cube(float w, float l, float h, bool center)
+QGLDrawableHandle QGLView::cube(float w, float l, float h, bool center)
 {
     return cube(QVector3D(w, l, h), center);
 }
 
-void *QGLView::cube(const QVector3D &size, bool center)
+QGLDrawableHandle QGLView::cube(const QVector3D &size, bool center)
 {
     if (center)
     {
-        m_modelParameters->modelMatrix.translate(-size/2.0);
+        m_modelParameters.modelMatrix.translate(-size/2.0);
     }
-    m_modelParameters->modelMatrix.scale(size);
+    m_modelParameters.modelMatrix.scale(size);
 
-    Parameters *parameters = addDrawableData(Cube, m_modelParameters);
+    QGLDrawableHandle handle = addDrawableData(Cube, m_modelParameters);
     resetTransformations();
-    return parameters;
+    return handle;
 }
 
-void *QGLView::cylinder(float r, float h)
+QGLDrawableHandle QGLView::cylinder(float r, float h)
 {
-    m_modelParameters->modelMatrix.scale(r, r, h);
-    Parameters *parameters = addDrawableData(Cylinder, m_modelParameters);
+    m_modelParameters.modelMatrix.scale(r, r, h);
+    QGLDrawableHandle handle = addDrawableData(Cylinder, m_modelParameters);
     resetTransformations();
-    return parameters;
+    return handle;
 }
 
-void *QGLView::cone(float r, float h)
+QGLDrawableHandle QGLView::cone(float r, float h)
 {
-    m_modelParameters->modelMatrix.scale(r, r, h);
-    Parameters *parameters = addDrawableData(Cone, m_modelParameters);
+    m_modelParameters.modelMatrix.scale(r, r, h);
+    QGLDrawableHandle handle = addDrawableData(Cone, m_modelParameters);
     resetTransformations();
-    return parameters;
+    return handle;
 }
 
-void *QGLView::sphere(float r)
+QGLDrawableHandle QGLView::sphere(float r)
 {
-    m_modelParameters->modelMatrix.scale(r,r,r);
-    Parameters *parameters = addDrawableData(Sphere, m_modelParameters);
+    m_modelParameters.modelMatrix.scale(r,r,r);
+    QGLDrawableHandle handle = addDrawableData(Sphere, m_modelParameters);
     resetTransformations();
-    return parameters;
+    return handle;
 }
 
 void QGLView::lineWidth(float width)
 {
-    m_lineParameters->width = width;
+    m_lineParameters.width = width;
 }
 
 void QGLView::lineStipple(float enable, float length)
 {
-    m_lineParameters->stipple = enable;
-    m_lineParameters->stippleLength = length;
+    m_lineParameters.stipple = enable;
+    m_lineParameters.stippleLength = length;
 }
 
-void *QGLView::line(float x, float y, float z)
+QGLDrawableHandle QGLView::line(float x, float y, float z)
 {
     GLvector3D vector;
     vector.x = x;
     vector.y = y;
     vector.z = z;
 
-    m_lineParameters->vertices.append(vector);
+    m_lineParameters.vertices.append(vector);
 
-    Parameters *parameters = addDrawableData(m_lineParameters);
+    QGLDrawableHandle handle = addDrawableData(m_lineParameters);
     resetTransformations();
-    return parameters;
+    return handle;
 }
 
-void *QGLView::line(const QVector3D &vector)
+QGLDrawableHandle QGLView::line(const QVector3D &vector)
 {
     return line(vector.x(), vector.y(), vector.z());
 }
 
-void *QGLView::lineTo(float x, float y, float z)
+QGLDrawableHandle QGLView::lineTo(float x, float y, float z)
 {
     if (!m_pathEnabled)
     {
         GLvector3D lastVector;
         GLvector3D vector;
 
-        if (m_lineParameters->vertices.size() > 1)
+        if (m_lineParameters.vertices.size() > 1)
         {
-            lastVector = m_lineParameters->vertices.takeLast();
+            lastVector = m_lineParameters.vertices.takeLast();
         }
         else
         {
-            lastVector = m_lineParameters->vertices.last();
+            lastVector = m_lineParameters.vertices.last();
         }
 
         vector.x = x - lastVector.x;
         vector.y = y - lastVector.y;
         vector.z = z - lastVector.z;
-        m_lineParameters->vertices.append(vector);
+        m_lineParameters.vertices.append(vector);
 
-        Parameters *parameters = addDrawableData(m_lineParameters);
-        m_lineParameters->modelMatrix.translate(vector.x,
+        QGLDrawableHandle handle = addDrawableData(m_lineParameters);
+        m_lineParameters.modelMatrix.translate(vector.x,
                                                 vector.y,
                                                 vector.z);
         vector.x = x;
         vector.y = y;
         vector.z = z;
-        m_lineParameters->vertices.removeLast();
-        m_lineParameters->vertices.append(vector);
+        m_lineParameters.vertices.removeLast();
+        m_lineParameters.vertices.append(vector);
 
-        return parameters;
+        return handle;
     }
     else
     {
@@ -1335,35 +3513,35 @@ void *QGLView::lineTo(float x, float y, float z)
         vector.x = x;
         vector.y = y;
         vector.z = z;
-        m_lineParameters->vertices.append(vector);
+        m_lineParameters.vertices.append(vector);
     }
 
-    return NULL;
+    return 0;
 }
 
-void *QGLView::lineTo(const QVector3D &vector)
+QGLDrawableHandle QGLView::lineTo(const QVector3D &vector)
 {
     return lineTo(vector.x(), vector.y(), vector.z());
 }
 
-void *QGLView::lineFromTo(float x1, float y1, float z1, float x2, float y2, float z2)
+QGLDrawableHandle QGLView::lineFromTo(float x1, float y1, float z1, float x2, float y2, float z2)
 {
     return lineFromTo(QVector3D(x1, y1, z1), QVector3D(x2, y2, z2));
 }
 
-void *QGLView::lineFromTo(const QVector3D &startPosition, const QVector3D &endPosition)
+QGLDrawableHandle QGLView::lineFromTo(const QVector3D &startPosition, const QVector3D &endPosition)
 {
     QVector3D diffVector = endPosition - startPosition;
     GLvector3D vector;
     vector.x = diffVector.x();
     vector.y = diffVector.y();
     vector.z = diffVector.z();
-    m_lineParameters->vertices.append(vector);
+    m_lineParameters.vertices.append(vector);
 
-    m_lineParameters->modelMatrix.translate(startPosition);
-    Parameters *parameters = addDrawableData(m_lineParameters);
+    m_lineParameters.modelMatrix.translate(startPosition);
+    QGLDrawableHandle handle = addDrawableData(m_lineParameters);
     resetTransformations();
-    return parameters;
+    return handle;
 }
 
 void QGLView::beginPath()
@@ -1371,22 +3549,22 @@ void QGLView::beginPath()
     m_pathEnabled = true;
 }
 
-void *QGLView::endPath()
+QGLDrawableHandle QGLView::endPath()
 {
     m_pathEnabled = false;
-    Parameters *parameters = addDrawableData(m_lineParameters);
+    QGLDrawableHandle handle = addDrawableData(m_lineParameters);
     resetTransformations();
-    return parameters;
+    return handle;
 }
 
-void *QGLView::arc(float x, float y, float radius, float startAngle, float endAngle, bool anticlockwise, float helixOffset)
+QGLDrawableHandle QGLView::arc(float x, float y, float radius, float startAngle, float endAngle, bool anticlockwise, float helixOffset)
 {
     qreal currentX;
     qreal currentY;
     qreal currentZ;
     qreal startX;
     qreal startY;
-    int arcPrecision = 16;  // 16 segments per revolution
+    int arcPrecision = 16;  // 16 segments per revolution, arcs inside of paths are tessellated
     int nSegments;
     qreal totalAngle;
     qreal segmentAngle;
@@ -1395,6 +3573,28 @@ void *QGLView::arc(float x, float y, float radius, float startAngle, float endAn
 
     totalAngle = qAbs(endAngle - startAngle);
 
+    if (!m_pathEnabled)
+    {
+        // a single arc is stored as parameters, the vertex shader calculates the points
+        ArcParameters arcParameters;
+        QGLDrawableHandle handle;
+
+        arcParameters.modelMatrix = m_lineParameters.modelMatrix;
+        arcParameters.color = m_lineParameters.color;
+        arcParameters.width = m_lineParameters.width;
+        arcParameters.stippleLength = m_lineParameters.stipple ? m_lineParameters.stippleLength : 0.0;
+        arcParameters.x = x;
+        arcParameters.y = y;
+        arcParameters.radius = radius;
+        arcParameters.startAngle = startAngle;
+        arcParameters.sweepAngle = anticlockwise ? totalAngle : -totalAngle;
+        arcParameters.helixOffset = helixOffset;
+
+        handle = addDrawableData(arcParameters);
+        resetTransformations();
+        return handle;
+    }
+
     nSegments = qCeil(qAbs(totalAngle) * (qreal)arcPrecision / (2.0*M_PI));
     segmentAngle = totalAngle / (qreal)nSegments;
     if (!anticlockwise) {
@@ -1412,62 +3612,318 @@ void *QGLView::arc(float x, float y, float radius, float startAngle, float endAn
         if (i > 0) {
             lineTo(currentX-startX, currentY-startY, currentZ);
         }
-        else {
-            startX = currentX;
-            startY = currentY;
-            translate(startX, startY, 0);
+        else {
+            startX = currentX;
+            startY = currentY;
+            translate(startX, startY, 0);
+        }
+    }
+
+    if (!inPath)    // if no path was previousle active end the path started in this function
+    {
+        return endPath();
+    }
+    else
+    {
+        return 0;
+    }
+}
+
+QVector<QGLDrawableHandle> QGLView::sceneBuffer(const QGLSceneBuffer &buffer)
+{
+    const QMatrix4x4 &modelMatrix = m_lineParameters.modelMatrix;    // transformation of the item
+    const QVector<QVector3D> &vertices = buffer.vertices();
+    const QVector<int> &levelVertexPaths = buffer.levelVertexPaths();
+    QVector<QGLDrawableHandle> handles;
+    GLfloat scale = 0.0;
+
+    // the geometry is already tessellated, it only has to be staged for the next repack
+    handles.reserve(buffer.pathCount());
+    m_lineStagingVertices.reserve(m_lineStagingVertices.size() + vertices.size() + buffer.levelVertices().size());
+    for (int i = 0; i < buffer.pathCount(); ++i)
+    {
+        const QGLSceneBuffer::Path &path = buffer.path(i);
+
+        if (path.arc != -1)
+        {
+            const QGLSceneBuffer::Arc &arc = buffer.arc(path.arc);
+            ArcParameters arcParameters;
+
+            arcParameters.modelMatrix = modelMatrix * arc.modelMatrix;
+            arcParameters.color = path.color;
+            arcParameters.backplotColor = path.backplotColor;
+            arcParameters.sequence = i;
+            arcParameters.width = path.width;
+            arcParameters.stippleLength = path.stippleLength;
+            arcParameters.x = arc.x;
+            arcParameters.y = arc.y;
+            arcParameters.radius = arc.radius;
+            arcParameters.startAngle = arc.startAngle;
+            arcParameters.sweepAngle = arc.sweepAngle;
+            arcParameters.helixOffset = arc.helixOffset;
+            handles.append(addDrawableData(arcParameters));
+            continue;
+        }
+
+        handles.append(addScenePath(path, vertices, path.first, path.count, i));
+    }
+
+    // the tolerances of the levels grow with the largest scale of the transformation
+    for (int i = 0; i < 3; ++i)
+    {
+        scale = qMax(scale, (GLfloat)modelMatrix.column(i).toVector3D().length());
+    }
+
+    // simplified levels are hidden drawables of the item, they replace the paths of their chunk when far away
+    for (int i = 0; i < buffer.levelChunkCount(); ++i)
+    {
+        const QGLSceneBuffer::LevelChunk &chunk = buffer.levelChunk(i);
+        const QGLSceneBuffer::Path &path = buffer.path(chunk.firstPath);
+        LineLevelChunk levelChunk;
+        QGLDrawableHandle chunkHandle;
+
+        levelChunk.drawables = handles.mid(chunk.firstPath, chunk.pathCount);
+        levelChunk.bounds = m_linePool.value(levelChunk.drawables.first())->bounds;
+        for (int j = 1; j < levelChunk.drawables.size(); ++j)
+        {
+            const BoundingBox &bounds = m_linePool.value(levelChunk.drawables.at(j))->bounds;
+            expandBoundingBox(&levelChunk.bounds, bounds.minimum);
+            expandBoundingBox(&levelChunk.bounds, bounds.maximum);
+        }
+        levelChunk.valid = true;
+        levelChunk.uniform = true;
+        levelChunk.colorDirty = false;
+        for (int level = 0; level < QGLSceneBuffer::LevelCount; ++level)
+        {
+            levelChunk.tolerances[level] = QGLSceneBuffer::levelTolerance(level) * scale;
+            levelChunk.levels[level] = 0;
+            if (chunk.levelCount[level] > 0)
+            {
+                LineParameters *lineParameters;
+
+                levelChunk.levels[level] = addScenePath(path, buffer.levelVertices(),
+                                                        chunk.levelFirst[level], chunk.levelCount[level], chunk.firstPath);
+                lineParameters = m_linePool.value(levelChunk.levels[level]);
+                lineParameters->level = level;
+
+                // a simplified segment replaces several paths, its ends take the sequences of the first and the last one
+                for (int j = 0; j < chunk.levelCount[level]; ++j)
+                {
+                    m_lineStagingVertices[lineParameters->vertexOffset + j].sequence = levelVertexPaths.at(chunk.levelFirst[level] + j);
+                }
+            }
+        }
+
+        chunkHandle = m_lineLevelChunkPool.append(levelChunk);
+        for (int j = 0; j < levelChunk.drawables.size(); ++j)
+        {
+            m_linePool.value(levelChunk.drawables.at(j))->levelChunk = chunkHandle;
+        }
+        for (int level = 0; level < QGLSceneBuffer::LevelCount; ++level)
+        {
+            if (levelChunk.levels[level] != 0)
+            {
+                m_linePool.value(levelChunk.levels[level])->levelChunk = chunkHandle;
+            }
         }
     }
 
-    if (!inPath)    // if no path was previousle active end the path started in this function
+    if (buffer.pathCount() > 0)
     {
-        return endPath();
+        m_lineGeometryChanged = true;
+        if (!m_modifiedLineItems.contains(m_currentGlItem))
+        {
+            m_modifiedLineItems.append(m_currentGlItem);
+        }
     }
-    else
+
+    return handles;
+}
+
+QGLDrawableHandle QGLView::addScenePath(const QGLSceneBuffer::Path &path, const QVector<QVector3D> &vertices, int first, int count, int sequence)
+{
+    const QMatrix4x4 &modelMatrix = m_lineParameters.modelMatrix;
+    bool transformed = !modelMatrix.isIdentity();
+    LineParameters lineParameters(m_lineParameters);
+    LineVertex lineVertex;
+    QVector3D origin;
+    QGLDrawableHandle handle;
+
+    origin = transformed ? modelMatrix.map(path.origin) : path.origin;
+    lineParameters.type = Line;
+    lineParameters.color = path.color;
+    lineParameters.backplotColor = path.backplotColor;
+    lineParameters.width = path.width;
+    lineParameters.stipple = (path.stippleLength > 0.0);
+    lineParameters.stippleLength = path.stippleLength;
+    lineParameters.vertices.clear();
+    lineParameters.vertexOffset = m_lineStagingVertices.size();
+    lineParameters.vertexCount = count;
+    lineParameters.packed = false;
+    lineParameters.level = -1;
+    lineParameters.levelChunk = 0;
+    lineParameters.bounds.minimum = origin;
+    lineParameters.bounds.maximum = origin;
+
+    lineVertex.stippleOrigin.x = origin.x();
+    lineVertex.stippleOrigin.y = origin.y();
+    lineVertex.stippleOrigin.z = origin.z();
+    lineVertex.stippleLength = path.stippleLength;
+    lineVertex.sequence = sequence;
+    for (int i = first; i < (first + count); ++i)
     {
-        return NULL;
+        QVector3D position = transformed ? modelMatrix.map(vertices.at(i)) : vertices.at(i);
+
+        if (i == first)
+        {
+            lineParameters.bounds.minimum = position;
+            lineParameters.bounds.maximum = position;
+        }
+        else
+        {
+            expandBoundingBox(&lineParameters.bounds, position);
+        }
+        lineVertex.position.x = position.x();
+        lineVertex.position.y = position.y();
+        lineVertex.position.z = position.z();
+        m_lineStagingVertices.append(lineVertex);
     }
+
+    handle = m_linePool.append(lineParameters);
+    m_currentDrawableList->append(handle);
+
+    return handle;
 }
 
 void QGLView::text(QString text, TextAlignment alignment , QFont font)
 {
-    QStaticText staticText(text);
-    font.setPixelSize(100);
-    staticText.prepare(QTransform(), font);
-
-    m_textParameters->staticText = staticText;
-    m_textParameters->alignment = alignment;
-    prepareTextTexture(staticText, font);
+    m_textParameters.alignment = alignment;
+    appendTextVertices(&m_textParameters, text, font);
 
     addDrawableData(m_textParameters);
+    m_textParameters.vertices.clear();
     resetTransformations();
 }
 
 void QGLView::beginUnion()
 {
-    m_modelParametersStack.push(new Parameters(m_modelParameters));
-    m_lineParametersStack.push(new LineParameters(m_lineParameters));
-    m_textParametersStack.push(new TextParameters(m_textParameters));
+    int depth = m_parametersStackDepth;
+
+    if (depth == m_modelParametersStack.size())
+    {
+        m_modelParametersStack.append(m_modelParameters);
+        m_lineParametersStack.append(m_lineParameters);
+        m_textParametersStack.append(m_textParameters);
+    }
+    else
+    {
+        m_modelParametersStack[depth] = m_modelParameters;
+        m_lineParametersStack[depth].assign(m_lineParameters);
+        m_textParametersStack[depth] = m_textParameters;
+    }
+
+    m_parametersStackDepth++;
 }
 
 void QGLView::endUnion()
 {
-    delete m_modelParametersStack.pop();
-    m_modelParameters = new Parameters(m_modelParametersStack.top());
+    if (m_parametersStackDepth > 1)
+    {
+        m_parametersStackDepth--;
+    }
+
+    resetTransformations();
+}
+
+void QGLView::updateColor(QGLDrawableHandle handle, const QColor &color, const QColor &backplotColor)
+{
+    ModelType type = (ModelType)drawableHandleType(handle);
+
+    // only scene paths have a backplot color
+    if (type == Line)
+    {
+        LineParameters *lineParameters = m_linePool.value(handle);
+        if (lineParameters != NULL)
+        {
+            lineParameters->backplotColor = backplotColor;
+        }
+    }
+    else if (type == Arc)
+    {
+        ArcParameters *arcParameters = m_arcPool.value(handle);
+        if (arcParameters != NULL)
+        {
+            arcParameters->backplotColor = backplotColor;
+        }
+    }
 
-    delete m_lineParametersStack.pop();
-    m_lineParameters = new LineParameters(m_lineParametersStack.top());
+    updateColor(handle, color);
+}
 
-    delete m_textParametersStack.pop();
-    m_textParameters = new TextParameters(m_textParametersStack.top());
+void QGLView::updateBackplot(QGLItem *item, int executedSequence)
+{
+    if (executedSequence > 0)
+    {
+        m_backplotSequences.insert(item, (GLfloat)executedSequence);
+    }
+    else
+    {
+        m_backplotSequences.remove(item);
+    }
 }
 
-void QGLView::updateColor(void *drawablePointer, const QColor &color)
+void QGLView::updateColor(QGLDrawableHandle handle, const QColor &color)
 {
-    Parameters *parameters;
+    ModelType type = (ModelType)drawableHandleType(handle);
 
-    parameters = static_cast<Parameters*>(drawablePointer);
-    parameters->color = color;
+    if (type == Line)
+    {
+        LineParameters *lineParameters = m_linePool.value(handle);
+        if (lineParameters != NULL)     // stale handles are ignored
+        {
+            lineParameters->color = color;
+            updateLineVertexColor(lineParameters);
+
+            // the simplified levels of the chunk may no longer replace it, checked before the next frame
+            if ((lineParameters->levelChunk != 0) && (lineParameters->level == -1))
+            {
+                LineLevelChunk *levelChunk = m_lineLevelChunkPool.value(lineParameters->levelChunk);
+                if ((levelChunk != NULL) && !levelChunk->colorDirty)
+                {
+                    levelChunk->colorDirty = true;
+                    m_dirtyLineLevelChunks.append(lineParameters->levelChunk);
+                }
+            }
+        }
+    }
+    else if (type == Text)
+    {
+        TextParameters *textParameters = m_textPool.value(handle);
+        if (textParameters != NULL)
+        {
+            textParameters->color = color;
+            m_textGeometryChanged = true;
+        }
+    }
+    else if (type == Arc)
+    {
+        int index = m_arcPool.indexOf(handle);
+        if (index != -1)
+        {
+            m_arcPool[index].color = color;
+            updateArcInstanceColor(index);
+        }
+    }
+    else if (m_modelPoolMap.contains(type))
+    {
+        QGLDrawablePool<Parameters> *modelPool = m_modelPoolMap.value(type);
+        int index = modelPool->indexOf(handle);
+        if (index != -1)
+        {
+            (*modelPool)[index].color = color;
+            updateModelInstanceColor(type, index);
+        }
+    }
 }
 
 void QGLView::paint()
@@ -1488,15 +3944,6 @@ void QGLView::paint()
     //glGetBooleanv(GL_SCISSOR_TEST, &scissorEnabled);
     //glEnable(GL_SCISSOR_TEST);
 
-    //glViewport(0, 0, m_viewportSize.width(), m_viewportSize.height());
-    glViewport(0, 0, this->width(), this->height());
-
-    glClearColor(m_thread_backgroundColor.redF(),
-                 m_thread_backgroundColor.greenF(),
-                 m_thread_backgroundColor.blueF(),
-                 m_thread_backgroundColor.alphaF());
-    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-
     // Enable depth test
     //glGetBooleanv(GL_DEPTH_TEST, &depthTestEnabled);
     glEnable(GL_DEPTH_TEST);
@@ -1509,54 +3956,39 @@ void QGLView::paint()
     //glGetBooleanv(GL_CULL_FACE, &cullFaceEnabled);
     glEnable(GL_CULL_FACE);
 
-    // Enable Alpha blend
-    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
-    glEnable(GL_BLEND);
-
-    if (m_selectionModeActive)
+    if (m_thread_selectionModeActive)
     {
-        m_currentDrawableId = 1;    // we start by one since 0 is the background color
+        paintSelection();
     }
 
-    m_lineProgram->bind();
-    m_lineProgram->setUniformValue(m_lineProjectionMatrixLocation, m_projectionMatrix);
-    m_lineProgram->setUniformValue(m_lineViewMatrixLocation, m_viewMatrix);
-    m_lineProgram->setUniformValue(m_lineSelectionModeLocation, m_selectionModeActive);
-    drawLines();
-    m_lineProgram->release();
+    glViewport(0, 0, m_viewportSize.width(), m_viewportSize.height());
 
-    m_textProgram->bind();
-    m_textProgram->setUniformValue(m_textProjectionMatrixLocation, m_projectionMatrix);
-    m_textProgram->setUniformValue(m_textViewMatrixLocation, m_viewMatrix);
-    m_textProgram->setUniformValue(m_textSelectionModeLocation, m_selectionModeActive);
-    drawTexts();
-    m_textProgram->release();
+    // Enable Alpha blend
+    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+    glEnable(GL_BLEND);
 
-    m_modelProgram->bind();
-    m_modelProgram->setUniformValue(m_projectionMatrixLocation, m_projectionMatrix);
-    m_modelProgram->setUniformValue(m_viewMatrixLocation, m_viewMatrix);
-    m_modelProgram->setUniformValue(m_lightPositionLocation, m_light->position());
-    m_modelProgram->setUniformValue(m_lightIntensitiesLocation, m_light->intensities());
-    m_modelProgram->setUniformValue(m_lightAttenuationLocation, m_light->attenuation());
-    m_modelProgram->setUniformValue(m_lightAmbientCoefficientLocation, m_light->ambientCoefficient());
-    m_modelProgram->setUniformValue(m_lightEnabledLocation, m_light->enabled());
-    m_modelProgram->setUniformValue(m_selectionModeLocation, m_selectionModeActive);
-    drawDrawables(Cube);
-    drawDrawables(Cylinder);
-    drawDrawables(Cone);
-    drawDrawables(Sphere);
-    m_modelProgram->release();
+    finishLineUpload();     // swapped line buffers have to be part of the cached layer
+    updateFrustum(m_thread_projectionMatrix);
 
-    if (m_selectionModeActive)
+    // the cache only pays off while the camera rests, a moving camera draws the whole scene
+    if (!m_thread_cachedItems.isEmpty() && !m_viewChanged && !m_thread_interacting
+            && QOpenGLFramebufferObject::hasOpenGLFramebufferBlit())
     {
-        quint32 id = getSelection();
-        emit drawableSelected(m_drawableIdMap.value(id, NULL));
-
-        m_drawableIdMap.clear();
-        m_selectionModeActive = false;
-        paint();
+        paintLayerCache();
+        m_paintLayers = DynamicLayer;
+    }
+    else
+    {
+        glClearColor(m_thread_backgroundColor.redF(),
+                     m_thread_backgroundColor.greenF(),
+                     m_thread_backgroundColor.blueF(),
+                     m_thread_backgroundColor.alphaF());
+        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
     }
 
+    paintDrawables(m_thread_projectionMatrix);
+    m_paintLayers = AllLayers;
+
     /*if (!scissorEnabled)
     {
         glDisable(GL_SCISSOR_TEST);
@@ -1576,6 +4008,377 @@ void QGLView::paint()
     }*/
 }
 
+void QGLView::startInteraction()
+{
+    if (!m_adaptiveQuality)
+    {
+        return;
+    }
+
+    // every camera change extends the fast mode
+    m_interactionTimer.start(m_interactionTimeout);
+    if (!m_interacting)
+    {
+        m_interacting = true;
+        emit interactingChanged(true);
+    }
+}
+
+qreal QGLView::renderScale() const
+{
+    return m_thread_interacting ? m_thread_interactionRenderScale : 1.0;
+}
+
+int QGLView::renderSamples() const
+{
+    return m_thread_interacting ? 0 : RenderSamples;  // the fast mode renders without multisampling
+}
+
+bool QGLView::paintFrame(QOpenGLFramebufferObject *framebuffer)
+{
+    QSize size = framebuffer->size();
+
+    // the render target still holds the last frame if nothing changed
+    if ((m_thread_dirtyFlags == NotDirty) && (size == m_viewportSize))
+    {
+        return false;
+    }
+
+    // a changed view or target size makes the cached layer obsolete
+    m_viewChanged = ((m_thread_dirtyFlags & ViewDirty) != 0) || (size != m_viewportSize);
+    if (m_viewChanged)
+    {
+        m_layerCacheValid = false;
+    }
+
+    m_viewportSize = size;
+    m_renderFramebuffer = framebuffer;
+    m_thread_dirtyFlags = NotDirty;
+    paint();
+    m_thread_framesRendered++;
+
+    return true;
+}
+
+void QGLView::paintSelection()
+{
+    QMatrix4x4 projectionMatrix;
+    QMatrix4x4 pickMatrix;
+    GLint previousFramebuffer;
+    quint32 id;
+
+    if (m_selectionFramebuffer == NULL)
+    {
+        m_selectionFramebuffer = new QOpenGLFramebufferObject(SelectionSize, SelectionSize, QOpenGLFramebufferObject::Depth);
+    }
+
+    // the pick matrix maps the selection region to the whole off-screen buffer
+    pickMatrix.translate((m_thread_itemSize.width() - 2.0 * (m_thread_selectionPoint.x() + 0.5)) / SelectionSize,
+                         (m_thread_itemSize.height() - 2.0 * (m_thread_selectionPoint.y() + 0.5)) / SelectionSize,
+                         0.0);
+    pickMatrix.scale(m_thread_itemSize.width() / SelectionSize, m_thread_itemSize.height() / SelectionSize, 1.0);
+
+    glGetIntegerv(GL_FRAMEBUFFER_BINDING, &previousFramebuffer);
+    m_selectionFramebuffer->bind();
+    glViewport(0, 0, SelectionSize, SelectionSize);
+    glClearColor(0.0, 0.0, 0.0, 0.0);   // 0 is the background id
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+    glDisable(GL_BLEND);    // ids must not be mixed
+
+    // everything outside of the selection region is culled
+    projectionMatrix = pickMatrix * m_thread_projectionMatrix;
+    m_currentDrawableId = 1;    // we start by one since 0 is the background color
+    updateFrustum(projectionMatrix);
+    paintDrawables(projectionMatrix);
+    id = getSelection();
+
+    m_thread_selectionModeActive = false;
+    glBindFramebuffer(GL_FRAMEBUFFER, previousFramebuffer);
+
+    // the signal is emitted by the gui thread, the receivers do not have to be thread safe
+    QMetaObject::invokeMethod(this, "drawableSelected", Qt::QueuedConnection,
+                              Q_ARG(QGLDrawableHandle, selectedDrawable(id)));
+    m_selectionTypeMap.clear();
+}
+
+QGLDrawableHandle QGLView::pickLine(const QPointF &point) const
+{
+    QMatrix4x4 matrix = m_camera->projectionMatrix(m_projectionAspectRatio) * m_camera->modelViewMatrix();
+    QMatrix4x4 pickMatrix;
+    QVector4D planes[6];
+    QVector<LineVertex> segmentVertices;   // unpacked vertices of the current drawable
+    QGLDrawableHandle handle = 0;
+    qreal width = this->width();
+    qreal height = this->height();
+    qreal pickSize = 2 * HoverTolerance + 1;
+    qreal nearestDistance = HoverTolerance * HoverTolerance;
+    qreal nearestDepth = 1.0;
+
+    if ((width <= 0.0) || (height <= 0.0))
+    {
+        return 0;
+    }
+
+    // a thin frustum around the cursor ray rejects everything far away from the cursor
+    pickMatrix.translate((width - 2.0 * point.x()) / pickSize,
+                         (2.0 * point.y() - height) / pickSize,
+                         0.0);
+    pickMatrix.scale(width / pickSize, height / pickSize, 1.0);
+    calculateFrustumPlanes(pickMatrix * matrix, planes);
+
+    for (int i = 0; i < m_pickLineGroups.size(); ++i)
+    {
+        const LineGroup &lineGroup = m_pickLineGroups.at(i);
+        QStack<int> nodeStack;
+
+        if (lineGroup.nodes.isEmpty())
+        {
+            continue;
+        }
+
+        nodeStack.push(0);
+        while (!nodeStack.isEmpty())
+        {
+            const BoundingNode &node = lineGroup.nodes.at(nodeStack.pop());
+
+            if (cullBoundingBox(node.bounds, planes) == Outside)
+            {
+                continue;
+            }
+
+            if (node.left != -1)
+            {
+                nodeStack.push(node.left);
+                nodeStack.push(node.right);
+                continue;
+            }
+
+            // measure the screen space distance to every segment of the leaf
+            for (int j = node.firstDrawable; j < (node.firstDrawable + node.drawableCount); ++j)
+            {
+                int first = lineGroup.first + lineGroup.drawableOffsets.at(j);
+                int last = ((j + 1) < lineGroup.drawableOffsets.size()) ? (lineGroup.first + lineGroup.drawableOffsets.at(j + 1))
+                                                                        : (lineGroup.first + lineGroup.count);
+
+                segmentVertices.resize(0);
+                unpackLineVertices(lineGroup, m_pickLineVertices, m_pickLineIndices, first, last - first, segmentVertices);
+                for (int k = 0; (k + 1) < segmentVertices.size(); k += 2)
+                {
+                    const QGLLinePacker::Position &start = segmentVertices.at(k).position;
+                    const QGLLinePacker::Position &end = segmentVertices.at(k + 1).position;
+
+                    if (pickSegment(matrix, point, QVector3D(start.x, start.y, start.z), QVector3D(end.x, end.y, end.z),
+                                    &nearestDistance, &nearestDepth))
+                    {
+                        handle = lineGroup.drawables.at(j);
+                    }
+                }
+            }
+        }
+    }
+
+    // arcs are sampled with a fixed resolution, fine enough for the hover tolerance
+    for (int i = 0; i < m_pickArcInstances.size(); ++i)
+    {
+        const ArcInstance &arcInstance = m_pickArcInstances.at(i);
+        int segments;
+        QVector3D start;
+
+        if (cullBoundingBox(m_pickArcBounds.at(i), planes) == Outside)
+        {
+            continue;
+        }
+
+        segments = qBound(1, qCeil(qAbs(arcInstance.sweep[0]) * PickArcSegments / (2.0 * M_PI)), MaxArcSegments);
+        start = arcPoint(arcInstance, 0.0);
+        for (int j = 1; j <= segments; ++j)
+        {
+            QVector3D end = arcPoint(arcInstance, (qreal)j / (qreal)segments);
+
+            if (pickSegment(matrix, point, start, end, &nearestDistance, &nearestDepth))
+            {
+                handle = m_pickArcHandles.at(i);
+            }
+            start = end;
+        }
+    }
+
+    return handle;
+}
+
+bool QGLView::pickSegment(const QMatrix4x4 &matrix, const QPointF &point, const QVector3D &start, const QVector3D &end,
+                          qreal *nearestDistance, qreal *nearestDepth) const
+{
+    QVector4D clipStart = matrix * QVector4D(start, 1.0);
+    QVector4D clipEnd = matrix * QVector4D(end, 1.0);
+    qreal width = this->width();
+    qreal height = this->height();
+    QPointF screenStart;
+    QPointF screenEnd;
+    QPointF direction;
+    qreal length;
+    qreal t;
+    qreal distance;
+    qreal depth;
+
+    if ((clipStart.w() <= 0.0) || (clipEnd.w() <= 0.0))
+    {
+        return false;   // behind the camera
+    }
+
+    screenStart = QPointF((clipStart.x() / clipStart.w() + 1.0) * width / 2.0,
+                          (1.0 - clipStart.y() / clipStart.w()) * height / 2.0);
+    screenEnd = QPointF((clipEnd.x() / clipEnd.w() + 1.0) * width / 2.0,
+                        (1.0 - clipEnd.y() / clipEnd.w()) * height / 2.0);
+    direction = screenEnd - screenStart;
+    length = QPointF::dotProduct(direction, direction);
+    t = 0.0;
+    if (length > 0.0)
+    {
+        t = qBound(0.0, QPointF::dotProduct(point - screenStart, direction) / length, 1.0);
+    }
+    distance = QPointF::dotProduct(point - screenStart - t * direction, point - screenStart - t * direction);
+    depth = (1.0 - t) * clipStart.z() / clipStart.w() + t * clipEnd.z() / clipEnd.w();
+
+    // the closest line wins, lines at the same distance are resolved by depth
+    if ((distance < *nearestDistance) || ((distance == *nearestDistance) && (depth < *nearestDepth)))
+    {
+        *nearestDistance = distance;
+        *nearestDepth = depth;
+        return true;
+    }
+
+    return false;
+}
+
+void QGLView::paintLayerCache()
+{
+    if ((m_layerCacheFramebuffer != NULL)
+            && ((m_layerCacheFramebuffer->size() != m_viewportSize)
+                || (m_layerCacheFramebuffer->format().samples() != m_renderFramebuffer->format().samples())))
+    {
+        delete m_layerCacheFramebuffer;
+        m_layerCacheFramebuffer = NULL;
+    }
+
+    if (m_layerCacheFramebuffer == NULL)
+    {
+        // depth can only be blitted between targets of the same format
+        m_layerCacheFramebuffer = new QOpenGLFramebufferObject(m_viewportSize, m_renderFramebuffer->format());
+        m_layerCacheValid = false;
+    }
+
+    if (!m_layerCacheValid)
+    {
+        m_layerCacheFramebuffer->bind();
+        glClearColor(m_thread_backgroundColor.redF(),
+                     m_thread_backgroundColor.greenF(),
+                     m_thread_backgroundColor.blueF(),
+                     m_thread_backgroundColor.alphaF());
+        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+        m_paintLayers = CachedLayer;
+        paintDrawables(m_thread_projectionMatrix);
+        m_layerCacheValid = true;
+    }
+
+    // the dynamic items are depth tested against the cached depth
+    QOpenGLFramebufferObject::blitFramebuffer(m_renderFramebuffer, m_layerCacheFramebuffer,
+                                              GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT, GL_NEAREST);
+    m_renderFramebuffer->bind();
+}
+
+void QGLView::updateLayers()
+{
+    QSet<QGLItem*> cachedItems;
+    quint32 dynamicTypes = 0;
+
+    for (int i = 0; i < m_glItems.size(); ++i)
+    {
+        QGLItem *item = m_glItems.at(i);
+        QVector<QGLDrawableHandle> *drawableList = m_drawableListMap.value(item);
+
+        if (item->isCached())
+        {
+            cachedItems.insert(item);
+            continue;
+        }
+
+        // batched drawables can only be drawn as a whole, one uncached drawable moves its type to the dynamic layer
+        for (int j = 0; j < drawableList->size(); ++j)
+        {
+            dynamicTypes |= (1u << drawableHandleType(drawableList->at(j)));
+        }
+    }
+
+    if ((cachedItems != m_thread_cachedItems) || (dynamicTypes != m_thread_dynamicTypes))
+    {
+        m_thread_cachedItems = cachedItems;
+        m_thread_dynamicTypes = dynamicTypes;
+        m_layerCacheValid = false;
+    }
+}
+
+bool QGLView::isLayerPainted(QGLView::ModelType type) const
+{
+    int layer = (m_thread_dynamicTypes & (1u << type)) ? DynamicLayer : CachedLayer;
+
+    return (m_paintLayers & layer) != 0;
+}
+
+bool QGLView::isLayerPainted(QGLItem *item) const
+{
+    int layer = m_thread_cachedItems.contains(item) ? CachedLayer : DynamicLayer;
+
+    return (m_paintLayers & layer) != 0;
+}
+
+void QGLView::paintDrawables(const QMatrix4x4 &projectionMatrix)
+{
+    m_lineProgram->bind();
+    m_lineProgram->setUniformValue(m_lineProjectionMatrixLocation, projectionMatrix);
+    m_lineProgram->setUniformValue(m_lineViewMatrixLocation, m_thread_viewMatrix);
+    m_lineProgram->setUniformValue(m_lineSelectionModeLocation, m_thread_selectionModeActive);
+    drawLines();
+    m_lineProgram->release();
+
+    if (isLayerPainted(Arc))
+    {
+        m_arcProgram->bind();
+        m_arcProgram->setUniformValue(m_arcProjectionMatrixLocation, projectionMatrix);
+        m_arcProgram->setUniformValue(m_arcViewMatrixLocation, m_thread_viewMatrix);
+        m_arcProgram->setUniformValue(m_arcSelectionModeLocation, m_thread_selectionModeActive);
+        drawArcs();
+        m_arcProgram->release();
+    }
+
+    // texts are left out while interacting, the selection pass still needs them
+    if (isLayerPainted(Text) && (!m_thread_interacting || m_thread_selectionModeActive))
+    {
+        m_textProgram->bind();
+        m_textProgram->setUniformValue(m_textProjectionMatrixLocation, projectionMatrix);
+        m_textProgram->setUniformValue(m_textViewMatrixLocation, m_thread_viewMatrix);
+        m_textProgram->setUniformValue(m_textSelectionModeLocation, m_thread_selectionModeActive);
+        drawTexts();
+        m_textProgram->release();
+    }
+
+    m_modelProgram->bind();
+    m_modelProgram->setUniformValue(m_projectionMatrixLocation, projectionMatrix);
+    m_modelProgram->setUniformValue(m_viewMatrixLocation, m_thread_viewMatrix);
+    m_modelProgram->setUniformValue(m_lightPositionLocation, m_thread_lightPosition);
+    m_modelProgram->setUniformValue(m_lightIntensitiesLocation, m_thread_lightIntensities);
+    m_modelProgram->setUniformValue(m_lightAttenuationLocation, m_thread_lightAttenuation);
+    m_modelProgram->setUniformValue(m_lightAmbientCoefficientLocation, m_thread_lightAmbientCoefficient);
+    m_modelProgram->setUniformValue(m_lightEnabledLocation, m_thread_lightEnabled);
+    m_modelProgram->setUniformValue(m_selectionModeLocation, m_thread_selectionModeActive);
+    drawDrawables(Cube);
+    drawDrawables(Cylinder);
+    drawDrawables(Cone);
+    drawDrawables(Sphere);
+    m_modelProgram->release();
+}
+
 void QGLView::cleanup()
 {
     if (m_modelProgram) {
@@ -1592,6 +4395,46 @@ void QGLView::cleanup()
         delete m_textProgram;
         m_textProgram = 0;
     }
+
+    if (m_arcProgram) {
+        delete m_arcProgram;
+        m_arcProgram = 0;
+    }
+
+    if (m_selectionFramebuffer) {
+        delete m_selectionFramebuffer;
+        m_selectionFramebuffer = 0;
+    }
+
+    if (m_layerCacheFramebuffer) {
+        delete m_layerCacheFramebuffer;
+        m_layerCacheFramebuffer = 0;
+        m_layerCacheValid = false;
+    }
+
+    if (m_glyphTexture != 0) {
+        glDeleteTextures(1, &m_glyphTexture);
+        m_glyphTexture = 0;
+        m_glyphTextureSize = QSize();
+    }
+
+    if (m_uploadThread) {
+        m_uploadThread->quit(); // a running upload is finished first
+        m_uploadThread->wait();
+        delete m_bufferUploader;
+        delete m_uploadThread;
+        m_bufferUploader = NULL;
+        m_uploadThread = NULL;
+    }
+
+    if (m_lineUploadJob) {
+        for (int i = 0; i < m_lineUploadJob->uploads.size(); ++i)
+        {
+            delete m_lineUploadJob->uploads.at(i).buffer;
+        }
+        delete m_lineUploadJob;
+        m_lineUploadJob = NULL;
+    }
 }
 
 void QGLView::sync()
@@ -1599,9 +4442,11 @@ void QGLView::sync()
     if (!m_initialized)
     {
         initializeOpenGLFunctions();
+        setupInstancing();
         setupShaders();
         setupWindow();
         setupVBOs();
+        setupBufferUploader();
         setupStack();
         m_initialized = true;
         emit initialized();
@@ -1609,11 +4454,68 @@ void QGLView::sync()
     }
 
     m_thread_backgroundColor = m_backgroundColor;
+    m_thread_viewMatrix = m_viewMatrix;
+    m_thread_projectionMatrix = m_projectionMatrix;
+    m_thread_lightPosition = m_light->position();
+    m_thread_lightIntensities = m_light->intensities();
+    m_thread_lightAttenuation = m_light->attenuation();
+    m_thread_lightAmbientCoefficient = m_light->ambientCoefficient();
+    m_thread_lightEnabled = m_light->enabled();
+    m_thread_itemSize = QSizeF(width(), height());
+    if (m_selectionRequested)
+    {
+        // the request is consumed here, the selection pass of the next frame answers it
+        m_thread_selectionPoint = m_selectionPoint;
+        m_thread_selectionModeActive = true;
+        m_selectionRequested = false;
+    }
+    m_thread_interacting = m_interacting;
+    m_thread_interactionRenderScale = m_interactionRenderScale;
+    if (m_thread_vertexResolution != (GLfloat)m_vertexResolution)
+    {
+        // every group is unpacked with the step it was packed with and quantized again
+        m_thread_vertexResolution = m_vertexResolution;
+        for (int i = 0; i < m_lineGroups.size(); ++i)
+        {
+            if (!m_modifiedLineItems.contains(m_lineGroups.at(i).item))
+            {
+                m_modifiedLineItems.append(m_lineGroups.at(i).item);
+            }
+        }
+        m_lineGeometryChanged = true;
+    }
+    m_thread_dirtyFlags |= m_dirtyFlags;
+    m_dirtyFlags = NotDirty;
+    m_updatePending = false;
+    if ((m_framesRendered != m_thread_framesRendered) || m_frameStatisticsChanged)
+    {
+        // statistics of the previous frames, the gui thread is blocked while we copy
+        // and receives the notification once it runs again
+        m_framesRendered = m_thread_framesRendered;
+        m_frameStatisticsChanged = false;
+        QMetaObject::invokeMethod(this, "frameStatisticsChanged", Qt::QueuedConnection);
+    }
+    if (m_pickDataChanged)
+    {
+        // implicitly shared, the gui thread is blocked while we copy
+        m_pickLineVertices = m_lineVertices;
+        m_pickLineIndices = m_lineIndices;
+        m_pickLineGroups = m_lineGroups;
+        m_pickArcInstances = m_arcInstances;
+        m_pickArcBounds = m_arcBounds;
+        m_pickArcHandles.resize(m_arcPool.size());
+        for (int i = 0; i < m_arcPool.size(); ++i)
+        {
+            m_pickArcHandles[i] = m_arcPool.handleAt(i);
+        }
+        m_pickDataChanged = false;
+    }
 
     paintGLItems();
+    updateLayers();
 }
 
 void QGLView::reset()
 {
-    removeDrawables(m_currentDrawableList);
+    removeDrawables(m_currentGlItem);
 }
@@ -23,32 +23,45 @@
 #ifndef QGLVIEW_H
 #define QGLVIEW_H
 
-#include <QtQuick/QQuickPaintedItem>
+#include <QtQuick/QQuickFramebufferObject>
 #include <QtGui/QOpenGLShaderProgram>
 #include <QTimer>
 #include <QOpenGLBuffer>
-#include <QOpenGLTexture>
 #include <QOpenGLFunctions>
+#include <QOpenGLFramebufferObject>
 #include <QStack>
-#include <QStaticText>
+#include <QSet>
 #include <QPainter>
 #include <QQmlListProperty>
 #include <QSignalMapper>
+#include "qgldrawablepool.h"
+#include "qglglyphatlas.h"
+#include "qglbufferuploader.h"
+#include "qglscenebuffer.h"
+#include "qgllinepacker.h"
 #include "qglitem.h"
 #include "qglcamera.h"
 #include "qgllight.h"
 
 class QGLItem;
 
-class QGLView : public QQuickPaintedItem, protected QOpenGLFunctions
+class QGLView : public QQuickFramebufferObject, protected QOpenGLFunctions
 {
     Q_OBJECT
+    friend class QGLViewRenderer;
 
     Q_INTERFACES(QQmlParserStatus)
     Q_PROPERTY(QColor backgroundColor READ backgroundColor WRITE setBackgroundColor NOTIFY backgroundColorChanged)
     Q_PROPERTY(QGLCamera *camera READ camera WRITE setCamera NOTIFY cameraChanged)
     Q_PROPERTY(QGLLight *light READ light WRITE setLight NOTIFY lightChanged)
     Q_PROPERTY(QQmlListProperty<QGLItem> glItems READ glItems NOTIFY glItemsChanged)
+    Q_PROPERTY(int framesRendered READ framesRendered NOTIFY frameStatisticsChanged)
+    Q_PROPERTY(int framesSkipped READ framesSkipped NOTIFY frameStatisticsChanged)
+    Q_PROPERTY(bool adaptiveQuality READ adaptiveQuality WRITE setAdaptiveQuality NOTIFY adaptiveQualityChanged)
+    Q_PROPERTY(int interactionTimeout READ interactionTimeout WRITE setInteractionTimeout NOTIFY interactionTimeoutChanged)
+    Q_PROPERTY(qreal interactionRenderScale READ interactionRenderScale WRITE setInteractionRenderScale NOTIFY interactionRenderScaleChanged)
+    Q_PROPERTY(bool interacting READ interacting NOTIFY interactingChanged)
+    Q_PROPERTY(qreal vertexResolution READ vertexResolution WRITE setVertexResolution NOTIFY vertexResolutionChanged)
     Q_ENUMS(TextAlignment)
 
 public:
@@ -65,6 +78,7 @@ public:
     void setBackgroundColor(const QColor &backgroundColor);
 
     Q_INVOKABLE void readPixel(int x, int y);
+    Q_INVOKABLE void hoverPixel(int x, int y);
 
     QGLCamera* camera()
     {
@@ -76,11 +90,51 @@ public:
         return m_light;
     }
 
+    int framesRendered() const
+    {
+        return m_framesRendered;
+    }
+
+    int framesSkipped() const
+    {
+        return m_framesSkipped;
+    }
+
+    bool adaptiveQuality() const
+    {
+        return m_adaptiveQuality;
+    }
+
+    int interactionTimeout() const
+    {
+        return m_interactionTimeout;
+    }
+
+    qreal interactionRenderScale() const
+    {
+        return m_interactionRenderScale;
+    }
+
+    bool interacting() const
+    {
+        return m_interacting;
+    }
+
+    qreal vertexResolution() const
+    {
+        return m_vertexResolution;
+    }
+
+    void setAdaptiveQuality(bool adaptiveQuality);
+    void setInteractionTimeout(int interactionTimeout);
+    void setInteractionRenderScale(qreal interactionRenderScale);
+    void setVertexResolution(qreal vertexResolution);
+
     QQmlListProperty<QGLItem> glItems();
     int glItemCount() const;
     QGLItem *glItem(int index) const;
 
-    void paint(QPainter * painter);
+    Renderer *createRenderer() const;
 
 signals:
     void backgroundColorChanged();
@@ -88,7 +142,14 @@ signals:
     void glItemsChanged(QQmlListProperty<QGLItem> arg);
     void lightChanged(QGLLight * arg);
     void initialized();
-    void drawableSelected(void *pointer);
+    void frameStatisticsChanged(); // queued from sync, emitted on the gui thread
+    void adaptiveQualityChanged(bool adaptiveQuality);
+    void interactionTimeoutChanged(int interactionTimeout);
+    void interactionRenderScaleChanged(qreal interactionRenderScale);
+    void interactingChanged(bool interacting);
+    void vertexResolutionChanged(qreal vertexResolution);
+    void drawableSelected(QGLDrawableHandle handle);     // emitted on the gui thread once the selection pass is rendered
+    void drawableHovered(QGLDrawableHandle handle);
 
 public slots:
     void paint();
@@ -122,24 +183,28 @@ public slots:
     void resetTransformations(bool hard = false);
 
     // model functions
-    void *cube(float w, float l, float h, bool center = false);
-    void *cube(const QVector3D &size, bool center = false);
-    void *cylinder(float r, float h);
-    void *cone(float r, float h);
-    void *sphere(float r);
+    QGLDrawableHandle cube(float w, float l, float h, bool center = false);
+    QGLDrawableHandle cube(const QVector3D &size, bool center = false);
+    QGLDrawableHandle cylinder(float r, float h);
+    QGLDrawableHandle cone(float r, float h);
+    QGLDrawableHandle sphere(float r);
 
     // line functions
     void lineWidth(float width);
     void lineStipple(float enable, float length = 5.0);
-    void *line(float x, float y, float z);
-    void *line(const QVector3D &vector);
-    void* lineTo(float x, float y, float z);
-    void *lineTo(const QVector3D &vector);
-    void *lineFromTo(float x1, float y1, float z1, float x2, float y2, float z2);
-    void *lineFromTo(const QVector3D &startPosition, const QVector3D &endPosition);
+    QGLDrawableHandle line(float x, float y, float z);
+    QGLDrawableHandle line(const QVector3D &vector);
+    QGLDrawableHandle lineTo(float x, float y, float z);
+    QGLDrawableHandle lineTo(const QVector3D &vector);
+    QGLDrawableHandle lineFromTo(float x1, float y1, float z1, float x2, float y2, float z2);
+    QGLDrawableHandle lineFromTo(const QVector3D &startPosition, const QVector3D &endPosition);
     void beginPath();
-    void *endPath();
-    void *arc(float x, float y, float radius, float startAngle, float endAngle, bool anticlockwise, float helixOffset = 0.0);
+    QGLDrawableHandle endPath();
+    QGLDrawableHandle arc(float x, float y, float radius, float startAngle, float endAngle, bool anticlockwise, float helixOffset = 0.0);
+
+    // adds all paths of a prerecorded scene buffer, returns one handle per path
+    // the buffer may be shared between views, its paths are copied into the store of this view
+    QVector<QGLDrawableHandle> sceneBuffer(const QGLSceneBuffer &buffer);
 
     // text functions
     void text(QString text, TextAlignment alignment = AlignLeft, QFont font = QFont());
@@ -149,7 +214,10 @@ public slots:
     void endUnion();
 
     // update functions
-    void updateColor(void *drawablePointer, const QColor &color);
+    void updateColor(QGLDrawableHandle handle, const QColor &color);
+    void updateColor(QGLDrawableHandle handle, const QColor &color, const QColor &backplotColor);
+    // scene paths of the item with a lower sequence, i.e. path index, are drawn in their backplot color
+    void updateBackplot(QGLItem *item, int executedSequence);
 
     void setCamera(QGLCamera *arg)
     {
@@ -169,7 +237,7 @@ public slots:
             m_light = arg;
             emit lightChanged(arg);
             connect(m_light, SIGNAL(propertyChanged()),
-                    this, SLOT(update()));
+                    this, SLOT(updateLight()));
         }
     }
 
@@ -178,6 +246,9 @@ private slots:
     void updatePerspectiveAspectRatio();
     void updateViewMatrix();
     void updateProjectionMatrix();
+    void updateLight();
+    void lineUploadFinished();
+    void interactionFinished();
     void updateItems();
     void updateItem(QObject *item);
     void updateChildren();
@@ -190,7 +261,28 @@ private:
         Sphere = 3,
         Cone = 4,
         Text = 5,
-        Line = 6
+        Line = 6,
+        Arc = 7,
+        LevelChunk = 8  // not a drawable, tags the handles of line level chunks
+    };
+
+    enum DirtyFlag {
+        NotDirty = 0x00,
+        ViewDirty = 0x01,       // camera, light or background changed
+        ItemsDirty = 0x02,      // items need to be painted again
+        SelectionDirty = 0x04   // selection requested
+    };
+
+    enum PaintLayer {
+        CachedLayer = 0x01,     // drawables of cached items, rendered once into the layer cache
+        DynamicLayer = 0x02,    // drawables of all other items, rendered every frame
+        AllLayers = 0x03
+    };
+
+    enum CullResult {
+        Outside = 0,
+        Intersecting = 1,
+        Inside = 2
     };
 
     typedef struct {
@@ -210,37 +302,165 @@ private:
         GLubyte b;
     } GLcolorRGB ;
 
+    typedef struct {
+        GLubyte r;
+        GLubyte g;
+        GLubyte b;
+        GLubyte a;
+    } GLcolorRGBA;
+
     typedef struct {
         GLvector3D position;
         GLvector3D normal;
     } ModelVertex;
 
     typedef struct {
-        GLvector3D position;
-        GLvector2D texCoordinate;
+        GLvector3D position;        // world space
+        GLvector2D texCoordinate;   // position in the glyph atlas, in pixels
+        GLcolorRGBA color;
+        GLfloat pickId;             // index of the text drawable
     } TextVertex;
 
+    typedef QGLLinePacker::Vertex LineVertex;
+    typedef QGLLinePacker::PackedVertex PackedLineVertex;
+
+    // color stream entry, the shader selects the backplot color for executed vertices
+    typedef struct {
+        GLcolorRGBA color;
+        GLcolorRGBA backplotColor;
+    } LineColor;
+
+    typedef QGLLinePacker::Chunk VertexChunk;
+
+    typedef struct {
+        GLfloat width;
+        int first;
+        int count;
+    } LineBatch;
+
+    typedef struct {
+        int first;
+        int count;
+        int level;      // detail level of the model mesh
+    } InstanceRange;
+
+    typedef struct {
+        QVector3D minimum;
+        QVector3D maximum;
+    } BoundingBox;
+
+    typedef struct {
+        BoundingBox bounds;
+        int first;      // first index, relative to the group
+        int count;
+        int left;       // child nodes, -1 for leaves
+        int right;
+        int firstDrawable;  // drawables covered by the node, relative to the group
+        int drawableCount;
+        int level;          // simplified levels of the leaf, -1 if it is always drawn at full detail
+        bool hasLevels;     // a leaf below the node has simplified levels
+    } BoundingNode;
+
+    typedef struct {
+        QGLDrawableHandle chunk;    // chunk the levels belong to
+        int first[QGLSceneBuffer::LevelCount];  // first index, relative to the group
+        int count[QGLSceneBuffer::LevelCount];  // 0 if the level does not exist
+        GLfloat tolerance[QGLSceneBuffer::LevelCount];  // maximum distance to the full detail path
+    } LineLevel;
+
+    typedef struct {
+        QVector<QGLDrawableHandle> drawables;   // full detail drawables in path order
+        QGLDrawableHandle levels[QGLSceneBuffer::LevelCount];  // simplified drawables, 0 if the level does not exist
+        GLfloat tolerances[QGLSceneBuffer::LevelCount];
+        BoundingBox bounds;
+        bool valid;         // all drawables are alive
+        bool uniform;       // all drawables have the same color, the levels may replace them
+        bool colorDirty;
+    } LineLevelChunk;
+
+    typedef struct {
+        QGLItem *item;
+        GLfloat width;
+        int first;      // first index in the line index store, the ranges of the group are index ranges
+        int count;
+        int firstVertex;    // first vertex in the line vertex store
+        int vertexCount;
+        QVector<BoundingNode> nodes;    // bounding volume hierarchy, the root is the first node
+        QVector<QGLDrawableHandle> drawables;   // drawables in leaf order
+        QVector<int> drawableOffsets;   // first index of each drawable, relative to the group
+        QVector<VertexChunk> chunks;    // quantization ranges in vertex order
+        GLfloat resolution;             // quantization step the group was packed with
+        QVector<LineLevel> levels;      // simplified levels of the leaves, stored behind the hierarchy
+    } LineGroup;
+
+    typedef struct {
+        GLfloat modelMatrix[16];
+        GLcolorRGBA color;
+        GLfloat pickId;     // index of the instance, offset by the first id of the type in selection mode
+    } ModelInstance;
+
+    typedef struct {
+        GLfloat modelRows[12];  // first three rows of the model matrix, plane and position of the arc
+        GLfloat arc[4];         // center x, center y, radius, start angle
+        GLfloat sweep[4];       // sweep angle, helix offset, stipple length, pick id
+        GLcolorRGBA color;
+        GLcolorRGBA backplotColor;  // color once executed
+        GLfloat sequence;       // position in the program order, compared with the executed sequence of the item
+    } ArcInstance;
+
+    typedef struct {
+        GLfloat width;
+        QGLItem *item;          // owner of the arcs, its executed sequence applies to the batch
+        int first;              // first instance of the batch in the instance buffer
+        int count;
+        BoundingBox bounds;     // world space bounds of all arcs of the batch
+        GLfloat worldRadius;    // largest transformed radius of the batch
+        GLfloat sweepAngle;     // largest absolute sweep angle of the batch
+    } ArcBatch;
+
+    typedef struct {
+        QOpenGLBuffer *buffer;
+        QVector<ModelInstance> instances;   // same order as the drawable pool of the type
+        QVector<BoundingBox> bounds;        // world space bounds of the instances
+        BoundingBox modelBounds;            // bounds of the untransformed model
+        int dirtyFirst;     // range of instances that needs to be rewritten
+        int dirtyLast;
+    } ModelInstances;
+
+    typedef struct {
+        int firstIndex;     // first index of the level in the index buffer
+        int indexCount;
+        int detail;         // segments around the circumference, 0 for models without curvature
+    } ModelLevel;
+
+    typedef struct {
+        QVector<ModelVertex> vertices;  // vertices of all levels
+        QVector<GLushort> indices;      // indices of all levels, they point to the vertices of their own level
+        QVector<ModelLevel> levels;     // from coarse to fine
+    } ModelMesh;
+
+    typedef void (QOPENGLF_APIENTRYP DrawArraysInstancedFunction)(GLenum mode, GLint first, GLsizei count, GLsizei instanceCount);
+    typedef void (QOPENGLF_APIENTRYP DrawElementsInstancedFunction)(GLenum mode, GLsizei count, GLenum type, const void *indices, GLsizei instanceCount);
+    typedef void (QOPENGLF_APIENTRYP VertexAttribDivisorFunction)(GLuint index, GLuint divisor);
+
     class Parameters {
     public:
         Parameters():
-            creator(NULL),
+            type(NoType),
             modelMatrix(QMatrix4x4()),
-            color(QColor(Qt::yellow)),
-            deleteFlag(false)
+            color(QColor(Qt::yellow))
         { }
 
         Parameters(Parameters *parameters)
         {
-            creator = parameters->creator;
+            type = parameters->type;
             modelMatrix = parameters->modelMatrix;
             color = parameters->color;
-            deleteFlag = parameters->deleteFlag;
         }
 
-        QGLItem *creator;
+        ModelType type;
         QMatrix4x4 modelMatrix;
         QColor color;
-        bool deleteFlag;    // marks the parameter to delete
     };
 
     class LineParameters: public Parameters {
@@ -249,8 +469,17 @@ private:
             Parameters(),
             width(1.0),
             stipple(false),
-            stippleLength(1.0)
+            stippleLength(1.0),
+            vertexOffset(0),
+            vertexCount(0),
+            packedVertexOffset(0),
+            packedVertexCount(0),
+            packed(false),
+            level(-1),
+            levelChunk(0)
         {
+            bounds.minimum = QVector3D(0.0, 0.0, 0.0);
+            bounds.maximum = QVector3D(0.0, 0.0, 0.0);
             GLvector3D vector;
             vector.x = 0.0;
             vector.y = 0.0;
@@ -262,23 +491,63 @@ private:
         LineParameters(LineParameters *parameters):
             Parameters(parameters)
         {
+            backplotColor = parameters->backplotColor;
             vertices = parameters->vertices;
             width = parameters->width;
             stipple = parameters->stipple;
             stippleLength = parameters->stippleLength;
+            vertexOffset = parameters->vertexOffset;
+            vertexCount = parameters->vertexCount;
+            packedVertexOffset = parameters->packedVertexOffset;
+            packedVertexCount = parameters->packedVertexCount;
+            packed = parameters->packed;
+            level = parameters->level;
+            levelChunk = parameters->levelChunk;
+            bounds = parameters->bounds;
         }
 
+        // copies the state without sharing the vertices, keeps the allocated vertex storage
+        void assign(const LineParameters &parameters)
+        {
+            Parameters::operator=(parameters);
+            backplotColor = parameters.backplotColor;
+            width = parameters.width;
+            stipple = parameters.stipple;
+            stippleLength = parameters.stippleLength;
+            vertexOffset = parameters.vertexOffset;
+            vertexCount = parameters.vertexCount;
+            packedVertexOffset = parameters.packedVertexOffset;
+            packedVertexCount = parameters.packedVertexCount;
+            packed = parameters.packed;
+            level = parameters.level;
+            levelChunk = parameters.levelChunk;
+            bounds = parameters.bounds;
+            vertices.resize(parameters.vertices.size());
+            for (int i = 0; i < vertices.size(); ++i)
+            {
+                vertices[i] = parameters.vertices.at(i);
+            }
+        }
+
+        QColor backplotColor;   // color once executed, invalid to keep the color
         QVector<GLvector3D> vertices;
         GLfloat width;
         bool stipple;
         GLfloat stippleLength;
+        int vertexOffset;   // position in the line index store, or in the staging store if not packed
+        int vertexCount;
+        int packedVertexOffset; // strip vertices in the line vertex store, the colors have the same layout
+        int packedVertexCount;
+        bool packed;        // vertices are quantized in the line vertex store
+        int level;          // level of detail of a simplified drawable, -1 for full detail drawables
+        QGLDrawableHandle levelChunk;   // chunk of simplified levels the drawable belongs to, 0 if none
+        BoundingBox bounds; // world space bounds of the vertices
     };
 
     class TextParameters: public Parameters {
     public:
         TextParameters():
             Parameters(),
-            staticText(QStaticText()),
             alignment(AlignLeft)
         {
             color = QColor(Qt::white);
@@ -287,18 +556,46 @@ private:
         TextParameters(TextParameters *parameters):
             Parameters(parameters)
         {
-            staticText = parameters->staticText;
             alignment = parameters->alignment;
+            vertices = parameters->vertices;
         }
 
-        QStaticText staticText;
         TextAlignment alignment;
+        QVector<TextVertex> vertices;   // glyph quads, already transformed
     };
 
-    typedef struct {
-        ModelType type;
-        Parameters *parameters;
-    } Drawable;
+    class ArcParameters: public Parameters {
+    public:
+        ArcParameters():
+            Parameters(),
+            x(0.0),
+            y(0.0),
+            radius(0.0),
+            startAngle(0.0),
+            sweepAngle(0.0),
+            helixOffset(0.0),
+            width(1.0),
+            stippleLength(0.0),
+            worldRadius(0.0),
+            sequence(0.0),
+            item(NULL)
+        {
+            color = QColor(Qt::red);
+        }
+
+        GLfloat x;              // center in the arc plane
+        GLfloat y;
+        GLfloat radius;
+        GLfloat startAngle;
+        GLfloat sweepAngle;     // negative for clockwise arcs
+        GLfloat helixOffset;    // height gained along the arc
+        GLfloat width;
+        GLfloat stippleLength;  // 0.0 disables stippling
+        GLfloat worldRadius;    // transformed radius, selects the segment count
+        QColor backplotColor;   // color once executed, invalid to keep the color
+        GLfloat sequence;       // position in the program order, compared with the executed sequence of the item
+        QGLItem *item;          // owner, its executed sequence applies to the arc
+    };
 
     bool m_initialized;
 
@@ -306,16 +603,29 @@ private:
     QOpenGLShaderProgram *m_modelProgram;
     QOpenGLShaderProgram *m_lineProgram;
     QOpenGLShaderProgram *m_textProgram;
+    QOpenGLShaderProgram *m_arcProgram;
+
+    // off-screen id buffer for the picked region
+    QOpenGLFramebufferObject *m_selectionFramebuffer;
 
     // vertex buffers
     QMap<ModelType, QOpenGLBuffer*> m_vertexBufferMap;
+    QMap<ModelType, QOpenGLBuffer*> m_indexBufferMap;
+    QMap<ModelType, ModelInstances*> m_modelInstancesMap;
     QOpenGLBuffer *m_lineVertexBuffer;
+    QOpenGLBuffer *m_lineIndexBuffer;
+    QOpenGLBuffer *m_lineColorBuffer;
     QOpenGLBuffer *m_textVertexBuffer;
+    QOpenGLBuffer *m_arcSegmentBuffer;
+    QOpenGLBuffer *m_arcInstanceBuffer;
 
     // transformation matrices
     QMatrix4x4 m_viewMatrix;
     QMatrix4x4 m_projectionMatrix;
+    QMatrix4x4 m_thread_viewMatrix;         // copies for the render thread, taken in sync()
+    QMatrix4x4 m_thread_projectionMatrix;
     float m_projectionAspectRatio;
+    QVector4D m_frustumPlanes[6];
 
     // shader program location ids
     int m_positionLocation;
@@ -329,68 +639,190 @@ private:
     int m_projectionMatrixLocation;
     int m_viewMatrixLocation;
     int m_modelMatrixLocation;
+    int m_pickIdLocation;
     int m_selectionModeLocation;
-    int m_idColorLocation;
+    int m_idOffsetLocation;
+
+    // instanced drawing, NULL if not supported by the context
+    DrawArraysInstancedFunction m_drawArraysInstanced;
+    DrawElementsInstancedFunction m_drawElementsInstanced;
+    VertexAttribDivisorFunction m_vertexAttribDivisor;
 
     int m_lineProjectionMatrixLocation;
     int m_lineViewMatrixLocation;
-    int m_lineModelMatrixLocation;
-    int m_lineColorLocation;
     int m_linePositionLocation;
-    int m_lineStippleLocation;
-    int m_lineStippleLengthLocation;
+    int m_lineColorLocation;
+    int m_lineChunkOriginLocation;
+    int m_lineChunkStippleOriginLocation;
+    int m_lineChunkStippleLengthLocation;
+    int m_lineVertexResolutionLocation;
+    int m_lineBackplotColorLocation;
+    int m_lineSequenceLocation;
+    int m_lineChunkSequenceOriginLocation;
+    int m_lineExecutedSequenceLocation;
     int m_lineSelectionModeLocation;
     int m_lineIdColorLocation;
 
     int m_textProjectionMatrixLocation;
     int m_textViewMatrixLocation;
-    int m_textModelMatrixLocation;
     int m_textColorLocation;
     int m_textPositionLocation;
     int m_textTexCoordinateLocation;
+    int m_textPickIdLocation;
     int m_textTextureLocation;
-    int m_textAspectRatioLocation;
-    int m_textAlignmentLocation;
+    int m_textTextureScaleLocation;
     int m_textSelectionModeLocation;
-    int m_textIdColorLocation;
+    int m_textIdOffsetLocation;
+
+    int m_arcProjectionMatrixLocation;
+    int m_arcViewMatrixLocation;
+    int m_arcSegmentLocation;
+    int m_arcSegmentCountLocation;
+    int m_arcPixelScaleLocation;
+    int m_arcToleranceLocation;
+    int m_arcModelRowLocation[3];
+    int m_arcLocation;
+    int m_arcSweepLocation;
+    int m_arcColorLocation;
+    int m_arcBackplotColorLocation;
+    int m_arcSequenceLocation;
+    int m_arcExecutedSequenceLocation;
+    int m_arcIdOffsetLocation;
+    int m_arcSelectionModeLocation;
 
     // thread secure properties
     QColor m_backgroundColor;
     QColor m_thread_backgroundColor;
-
-    QSize m_viewportSize;
-
-    // generic map of drawable items
-    QMap<ModelType, QList<Parameters*>* > m_drawableMap;
+    QVector3D m_thread_lightPosition;
+    QVector3D m_thread_lightIntensities;
+    float m_thread_lightAttenuation;
+    float m_thread_lightAmbientCoefficient;
+    bool m_thread_lightEnabled;
+    QSizeF m_thread_itemSize;
+
+    // frame scheduling, all changes of one event loop iteration result in one frame
+    int m_dirtyFlags;
+    int m_thread_dirtyFlags;
+    bool m_updatePending;
+    int m_framesRendered;
+    int m_framesSkipped;            // invalidate() calls coalesced into an already pending frame
+    int m_thread_framesRendered;
+    bool m_frameStatisticsChanged;
+
+    // interaction quality, camera changes switch to the fast mode until the view is idle again
+    bool m_adaptiveQuality;
+    int m_interactionTimeout;       // idle time in ms until full quality is restored
+    qreal m_interactionRenderScale; // size of the render target in the fast mode, relative to the item
+    bool m_interacting;
+    bool m_thread_interacting;
+    qreal m_thread_interactionRenderScale;
+    QTimer m_interactionTimer;
+
+    // quantization step of line vertices in scene units, follows the units of the program
+    qreal m_vertexResolution;
+    GLfloat m_thread_vertexResolution;
+
+    QSize m_viewportSize;   // size of the render target, set by the renderer
+    QOpenGLFramebufferObject *m_renderFramebuffer;  // render target of the current frame, set by the renderer
+
+    // static layer cache, cached items are drawn once and composited with the dynamic items
+    QOpenGLFramebufferObject *m_layerCacheFramebuffer;
+    bool m_layerCacheValid;
+    int m_paintLayers;                      // layers drawn by the current pass
+    QSet<QGLItem*> m_thread_cachedItems;
+    quint32 m_thread_dynamicTypes;          // one bit per drawable type that is used by uncached items
+    bool m_viewChanged;                     // camera or target size changed since the last frame
+
+    // drawable storage, one pool per type
+    QMap<ModelType, QGLDrawablePool<Parameters>* > m_modelPoolMap;
+    QGLDrawablePool<LineParameters> m_linePool;
+    QGLDrawablePool<TextParameters> m_textPool;
+    QGLDrawablePool<ArcParameters> m_arcPool;
+    QHash<QGLItem*, GLfloat> m_backplotSequences;   // executed sequence of each item, 0.0 if nothing is executed
 
     // model stack
-    Parameters *m_modelParameters;
-    QStack<Parameters*> m_modelParametersStack;
+    Parameters m_modelParameters;
+    QVector<Parameters> m_modelParametersStack;
+
+    // line vertex store, all line drawables packed as quantized strip vertices drawn as indexed GL_LINES
+    // the store is per view: it holds the transformed vertices and the hover colors of this view
+    // together with its other items, shared scene buffers are packed by every view that shows them
+    QVector<PackedLineVertex> m_lineVertices;
+    QVector<GLushort> m_lineIndices;    // GL_LINES pairs, relative to the first vertex of their chunk
+    QVector<LineVertex> m_lineStagingVertices;  // vertices of drawables added since the last repack
+    QVector<LineColor> m_lineColors;    // color stream, same layout as the vertices
+    QList<LineGroup> m_lineGroups;  // store is grouped by width and item, each group has its own hierarchy
+    QList<LineGroup> m_lineBufferGroups;    // groups of the geometry currently in the line buffers
+    QVector<QGLDrawableHandle> m_lineSelectionHandles;  // drawables in the order of their selection ids
+    QList<QGLItem*> m_modifiedLineItems;    // items whose line groups need to be rebuilt
+    QList<LineBatch> m_lineBatches; // visible ranges of the current frame
+    bool m_lineGeometryChanged;     // drawables added or removed, store needs to be repacked
+    int m_lineColorDirtyFirst;      // range of colors that needs to be rewritten
+    int m_lineColorDirtyLast;
+    int m_lineLevelColorDirtyFirst; // same for the simplified drawables, they are stored apart
+    int m_lineLevelColorDirtyLast;
+
+    // simplified levels of detail of line chunks, the coarsest level below a pixel is drawn
+    QGLDrawablePool<LineLevelChunk> m_lineLevelChunkPool;
+    QVector<QGLDrawableHandle> m_dirtyLineLevelChunks;  // chunks whose colors changed
+
+    // large line stores are uploaded on a separate thread, the old buffers are drawn meanwhile
+    QOffscreenSurface *m_uploadSurface;
+    QThread *m_uploadThread;
+    QGLBufferUploader *m_bufferUploader;
+    QGLBufferUploader::Job *m_lineUploadJob;
+    QList<LineGroup> m_lineUploadGroups;
+    QVector<PackedLineVertex> m_lineUploadVertices; // keep the uploaded data alive
+    QVector<GLushort> m_lineUploadIndices;
+    QVector<LineColor> m_lineUploadColors;
 
     // line stack
     bool m_pathEnabled;
-    LineParameters *m_lineParameters;
-    QStack<LineParameters*> m_lineParametersStack;
+    LineParameters m_lineParameters;
+    QVector<LineParameters> m_lineParametersStack;
 
     // text stack
-    TextParameters *m_textParameters;
-    QStack<TextParameters*> m_textParametersStack;
-    QList<QStaticText> m_textTextList;
-    QList<QImage> m_textImageList;
-    QList<QOpenGLTexture*> m_textTextureList;
-    QList<float> m_textAspectRatioList;
+    TextParameters m_textParameters;
+    QVector<TextParameters> m_textParametersStack;
+    int m_parametersStackDepth;     // used entries of the parameter stacks
+
+    // text store, the glyphs of all texts are drawn from one atlas in one batch
+    QGLGlyphAtlas m_glyphAtlas;
+    GLuint m_glyphTexture;
+    QSize m_glyphTextureSize;
+    QVector<TextVertex> m_textVertices;
+    bool m_textGeometryChanged;     // texts added, removed or recolored
+
+    // arc store, the points are calculated by the vertex shader
+    QVector<ArcInstance> m_arcInstances;    // same order as the arc pool
+    QVector<BoundingBox> m_arcBounds;
+    QVector<int> m_arcBatchIndices;         // arc pool indices in the order of the instance buffer
+    QList<ArcBatch> m_arcBatches;           // arcs grouped by width and item, the segment count is chosen per frame
+    bool m_arcInstancesChanged;             // arcs added, removed or recolored, the instance buffer is rewritten
 
     // item selection
     quint32 m_currentDrawableId;
-    QMap<quint32, Parameters* > m_drawableIdMap;
+    QMap<quint32, ModelType> m_selectionTypeMap;    // first selection id of each drawable type
     QPoint m_selectionPoint;
-    bool m_selectionModeActive;
+    bool m_selectionRequested;              // set by readPixel(), taken over by the next sync()
+    QPoint m_thread_selectionPoint;
+    bool m_thread_selectionModeActive;      // the selection pass of the current frame is running
+
+    // hover picking, copies of the line store taken in sync() for the gui thread
+    QVector<PackedLineVertex> m_pickLineVertices;
+    QVector<GLushort> m_pickLineIndices;
+    QList<LineGroup> m_pickLineGroups;
+    QVector<ArcInstance> m_pickArcInstances;
+    QVector<BoundingBox> m_pickArcBounds;
+    QVector<QGLDrawableHandle> m_pickArcHandles;
+    bool m_pickDataChanged;
+    QGLDrawableHandle m_hoveredDrawable;
 
     //GL items
     QGLItem *m_currentGlItem;
     QList<QGLItem*> m_glItems;
-    QMap<QGLItem*, QList<Drawable>* > m_drawableListMap;
-    QList<Drawable> *m_currentDrawableList;
+    QMap<QGLItem*, QVector<QGLDrawableHandle>* > m_drawableListMap;
+    QVector<QGLDrawableHandle> *m_currentDrawableList;
     QSignalMapper *m_propertySignalMapper;
     QList<QGLItem*> m_modifiedGlItems;  // list of gl items that have been modified
 
@@ -400,25 +832,64 @@ private:
     // light
     QGLLight *m_light;
 
-    void addDrawableList(ModelType type);
-    QList<Parameters*>* getDrawableList(ModelType type);
-    Parameters *addDrawableData(const LineParameters & parameters);
-    Parameters *addDrawableData(const TextParameters & parameters);
-    Parameters *addDrawableData(ModelType type, const Parameters & parameters);
+    int drawableCount(ModelType type) const;
+    QGLDrawableHandle addDrawableData(const LineParameters & parameters);
+    QGLDrawableHandle addScenePath(const QGLSceneBuffer::Path &path, const QVector<QVector3D> &vertices, int first, int count, int sequence);
+    QGLDrawableHandle addDrawableData(const TextParameters & parameters);
+    QGLDrawableHandle addDrawableData(const ArcParameters & parameters);
+    QGLDrawableHandle addDrawableData(ModelType type, const Parameters & parameters);
 
     void drawDrawables(ModelType type = NoType);
-    void clearDrawables();
-    void cleanupDrawables(ModelType type);
-    void removeDrawables(QList<Drawable> *drawableList);
+    void clearDrawables(ModelType type);
+    void removeDrawable(QGLDrawableHandle handle);
+    void removeDrawables(QGLItem *item);
+
+    void updateFrustum(const QMatrix4x4 &projectionMatrix);
+    void calculateFrustumPlanes(const QMatrix4x4 &matrix, QVector4D *planes) const;
+    CullResult cullBoundingBox(const BoundingBox &bounds, const QVector4D *planes) const;
+    void expandBoundingBox(BoundingBox *bounds, const QVector3D &point) const;
+    BoundingBox transformBoundingBox(const BoundingBox &bounds, const QMatrix4x4 &matrix) const;
 
     void drawModelVertices(ModelType type);
+    int selectModelLevel(const ModelMesh &mesh, const BoundingBox &bounds, const QMatrix4x4 &viewProjectionMatrix) const;
+    void appendModelInstance(const Parameters &parameters);
+    void removeModelInstance(ModelType type, int index);
+    void updateModelInstanceColor(ModelType type, int index);
+    void updateModelInstanceBuffer(ModelType type);
 
     void drawLines();
+    void appendLineVertices(LineParameters *lineParameters);
+    void updateLineVertexColor(LineParameters *lineParameters);
+    static LineColor lineColor(const LineParameters &lineParameters);
+    void updateLineVertexBuffer();
+    void startLineUpload();
+    void finishLineUpload();
+    int buildLineNodes(LineGroup *lineGroup, QVector<int> &drawables, int begin, int end,
+                       QVector<LineVertex> &vertices);
+    void unpackLineVertices(const LineGroup &lineGroup, const QVector<PackedLineVertex> &packedVertices,
+                            const QVector<GLushort> &indices, int first, int count, QVector<LineVertex> &vertices) const;
+    void setLineAttributeBuffers(int firstVertex);
+    void drawLineRange(const LineGroup &lineGroup, int first, int count);
+    void cullLineNodes(const LineGroup &lineGroup, int nodeIndex, bool inside);
+    const LineLevelChunk *representedLineLevelChunk(int index) const;
+    void updateLineLevelChunks();
+    void updateLineLevelColors();
+    int selectLineLevel(const LineLevel &lineLevel) const;
+    void appendLineBatch(GLfloat width, int first, int count);
+
+    void drawArcs();
+    void appendArcInstance(const ArcParameters &parameters);
+    void removeArcInstance(int index);
+    void updateArcInstanceColor(int index);
+    void updateArcInstanceBuffer();
+    int arcBatchSegments(const ArcBatch &arcBatch, const QMatrix4x4 &viewProjectionMatrix, qreal pixelScale) const;
+    BoundingBox arcBounds(const ArcParameters &parameters) const;
+    QVector3D arcPoint(const ArcInstance &instance, qreal t) const;
 
     void drawTexts();
-    void prepareTextTexture(const QStaticText &staticText, QFont font);
-    void createTextTexture(TextParameters *textParameters);
-    void clearTextTextures();
+    void appendTextVertices(TextParameters *textParameters, const QString &text, const QFont &font);
+    void updateTextVertexBuffer();
+    void updateGlyphTexture();
 
     void updateGLItems();
     void clearGLItem(QGLItem *item);
@@ -426,19 +897,41 @@ private:
     void paintGLItems();
     void paintGLItem(QGLItem *item);
 
+    void invalidate(DirtyFlag flag);
+    void startInteraction();
+    qreal renderScale() const;
+    int renderSamples() const;
+    bool paintFrame(QOpenGLFramebufferObject *framebuffer);
+    void paintSelection();
+    void paintLayerCache();
+    void updateLayers();
+    bool isLayerPainted(ModelType type) const;
+    bool isLayerPainted(QGLItem *item) const;
+    void paintDrawables(const QMatrix4x4 &projectionMatrix);
     quint32 getSelection();
+    QGLDrawableHandle selectedDrawable(quint32 id) const;
+    QGLDrawableHandle pickLine(const QPointF &point) const;
+    bool pickSegment(const QMatrix4x4 &matrix, const QPointF &point, const QVector3D &start, const QVector3D &end,
+                     qreal *nearestDistance, qreal *nearestDepth) const;
 
     // setup functions
-    void initializeVertexBuffer(ModelType type, const QVector<ModelVertex> & vertices);
-    void initializeVertexBuffer(ModelType type, const void *bufferData, int bufferLength);
+    void initializeModelBuffers(ModelType type);
     void setupVBOs();
+    void setupModelInstances(ModelType type);
+    void setupInstancing();
     void setupLineVertexBuffer();
     void setupTextVertexBuffer();
+    void setupArcVertexBuffer();
+    void setupBufferUploader();
     void setupShaders();
     void setupWindow();
-    void setupCube();
-    void setupCylinder(GLfloat originRadius, QVector3D originPoint, GLfloat endRadius, QVector3D endPoint, int detail, ModelType type);
-    void setupSphere(int detail);
+
+    // the model meshes are the same for all views, they are created once
+    static const ModelMesh &modelMesh(ModelType type);
+    static QMap<ModelType, ModelMesh> createModelMeshes();
+    static void appendCubeLevel(ModelMesh *mesh);
+    static void appendCylinderLevel(ModelMesh *mesh, GLfloat originRadius, QVector3D originPoint, GLfloat endRadius, QVector3D endPoint, int detail);
+    static void appendSphereLevel(ModelMesh *mesh, int detail);
     void setupStack();
 };
 
@@ -0,0 +1,96 @@
+/****************************************************************************
+**
+** Copyright (C) 2014 Alexander Rössler
+** License: LGPL version 2.1
+**
+** This file is part of QtQuickVcp.
+**
+** All rights reserved. This program and the accompanying materials
+** are made available under the terms of the GNU Lesser General Public License
+** (LGPL) version 2.1 which accompanies this distribution, and is available at
+** http://www.gnu.org/licenses/lgpl-2.1.html
+**
+** This library is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+** Lesser General Public License for more details.
+**
+** Contributors:
+** Alexander Rössler @ The Cool Tool GmbH <mail DOT aroessler AT gmail DOT com>
+**
+****************************************************************************/
+
+#include "qglviewrenderer.h"
+#include "qglview.h"
+
+QGLViewRenderer::QGLViewRenderer():
+    m_view(NULL),
+    m_window(NULL),
+    m_devicePixelRatio(1.0),
+    m_renderScale(1.0),
+    m_renderSamples(0)
+{
+}
+
+void QGLViewRenderer::synchronize(QQuickFramebufferObject *item)
+{
+    QSize size;
+    qreal devicePixelRatio;
+    qreal scale;
+    int samples;
+
+    // the gui thread is blocked, this is the only place where the view state may be copied
+    m_view = static_cast<QGLView*>(item);
+    m_window = item->window();
+    m_view->sync();
+
+    // the render target is recreated if the item is resized, moved to another screen or the render quality changes
+    size = QSize(qRound(item->width()), qRound(item->height()));
+    devicePixelRatio = (m_window != NULL) ? m_window->effectiveDevicePixelRatio() : 1.0;
+    scale = m_view->renderScale();
+    samples = m_view->renderSamples();
+    if ((size != m_itemSize) || (devicePixelRatio != m_devicePixelRatio) || (scale != m_renderScale) || (samples != m_renderSamples))
+    {
+        m_itemSize = size;
+        m_devicePixelRatio = devicePixelRatio;
+        m_renderScale = scale;
+        m_renderSamples = samples;
+        if (framebufferObject() != NULL)
+        {
+            invalidateFramebufferObject();
+        }
+    }
+}
+
+void QGLViewRenderer::render()
+{
+    if (m_view == NULL)
+    {
+        return;
+    }
+
+    if (!m_view->paintFrame(framebufferObject()))
+    {
+        return;     // nothing changed, no GL state was touched
+    }
+
+    // the scene graph expects its own GL state after we are done
+    if (m_window != NULL)
+    {
+        m_window->resetOpenGLState();
+    }
+}
+
+QOpenGLFramebufferObject *QGLViewRenderer::createFramebufferObject(const QSize &size)
+{
+    QOpenGLFramebufferObjectFormat format;
+    QSizeF targetSize = m_itemSize.isEmpty() ? QSizeF(size) : QSizeF(m_itemSize) * m_devicePixelRatio;    // device pixels
+    QSize scaledSize(qMax(1, qRound(targetSize.width() * m_renderScale)),
+                     qMax(1, qRound(targetSize.height() * m_renderScale)));
+
+    // a multisampled target is resolved by QQuickFramebufferObject before it is composited
+    format.setAttachment(QOpenGLFramebufferObject::CombinedDepthStencil);
+    format.setSamples(m_renderSamples);
+
+    return new QOpenGLFramebufferObject(scaledSize, format);
+}
@@ -0,0 +1,52 @@
+/****************************************************************************
+**
+** Copyright (C) 2014 Alexander Rössler
+** License: LGPL version 2.1
+**
+** This file is part of QtQuickVcp.
+**
+** All rights reserved. This program and the accompanying materials
+** are made available under the terms of the GNU Lesser General Public License
+** (LGPL) version 2.1 which accompanies this distribution, and is available at
+** http://www.gnu.org/licenses/lgpl-2.1.html
+**
+** This library is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+** Lesser General Public License for more details.
+**
+** Contributors:
+** Alexander Rössler @ The Cool Tool GmbH <mail DOT aroessler AT gmail DOT com>
+**
+****************************************************************************/
+
+#ifndef QGLVIEWRENDERER_H
+#define QGLVIEWRENDERER_H
+
+#include <QtQuick/QQuickFramebufferObject>
+#include <QtQuick/QQuickWindow>
+#include <QOpenGLFramebufferObject>
+
+class QGLView;
+
+// renders a GL view on the scene graph render thread
+class QGLViewRenderer : public QQuickFramebufferObject::Renderer
+{
+public:
+    QGLViewRenderer();
+
+protected:
+    void synchronize(QQuickFramebufferObject *item);
+    void render();
+    QOpenGLFramebufferObject *createFramebufferObject(const QSize &size);
+
+private:
+    QGLView *m_view;
+    QQuickWindow *m_window;
+    QSize m_itemSize;
+    qreal m_devicePixelRatio;
+    qreal m_renderScale;    // size of the render target relative to the item
+    int m_renderSamples;    // multisampling of the render target, 0 disables it
+};
+
+#endif // QGLVIEWRENDERER_H
@@ -216,7 +216,6 @@ void QPreviewClient::previewMessageReceived(QList<QByteArray> messageList)
 
         for (int i = 0; i < m_rx.preview_size(); ++i)
         {
-            QList<pb::Preview> *previewList;
             pb::Preview preview;
 
             preview = m_rx.preview(i);
@@ -261,19 +260,7 @@ void QPreviewClient::previewMessageReceived(QList<QByteArray> messageList)
                 preview.set_axis_end_point(convertValue(preview.axis_end_point()));
             }
 
-            previewList = static_cast<QList<pb::Preview>*>(m_model->data(m_previewStatus.fileName,
-                                                                         m_previewStatus.lineNumber,
-                                                                         QGCodeProgramModel::PreviewRole).value<void*>());
-            if (previewList == NULL)
-            {
-                previewList = new QList<pb::Preview>();
-            }
-
-            previewList->append(preview);
-
-            m_model->setData(m_previewStatus.fileName, m_previewStatus.lineNumber,
-                             QVariant::fromValue(static_cast<void*>(previewList)),
-                             QGCodeProgramModel::PreviewRole);
+            m_model->appendPreview(m_previewStatus.fileName, m_previewStatus.lineNumber, preview);
 
             m_previewUpdated = true;
         }
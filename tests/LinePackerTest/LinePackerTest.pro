@@ -0,0 +1,16 @@
+TEMPLATE = app
+TARGET = tst_linepacker
+
+QT += testlib
+CONFIG += testcase console
+CONFIG -= app_bundle
+
+PATHVIEW_DIR = ../../src/pathview
+INCLUDEPATH += $$PATHVIEW_DIR
+
+SOURCES += \
+    tst_linepacker.cpp \
+    $$PATHVIEW_DIR/qgllinepacker.cpp
+
+HEADERS += \
+    $$PATHVIEW_DIR/qgllinepacker.h
@@ -0,0 +1,228 @@
+#include <QtTest>
+#include <QtCore/qmath.h>
+#include "qgllinepacker.h"
+
+static const GLfloat Resolution = 0.001f;  // 1 um in mm, the default of the path view
+
+class tst_LinePacker : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void roundTrip();
+    void sharedStripVertices();
+    void longStippledTraverse();
+    void chunkVertexLimit();
+
+private:
+    static QGLLinePacker::Vertex vertex(const QVector3D &position, GLfloat sequence,
+                                        GLfloat stippleLength = 0.0, const QVector3D &stippleOrigin = QVector3D());
+    static void appendStrip(QVector<QGLLinePacker::Vertex> &vertices, const QVector<QVector3D> &points, GLfloat sequence,
+                            GLfloat stippleLength = 0.0);
+    static void verifyRoundTrip(const QGLLinePacker &packer, const QVector<QGLLinePacker::Vertex> &staged,
+                                const QVector<QGLLinePacker::Chunk> &chunks,
+                                const QVector<QGLLinePacker::PackedVertex> &packedVertices, const QVector<GLushort> &indices);
+};
+
+QGLLinePacker::Vertex tst_LinePacker::vertex(const QVector3D &position, GLfloat sequence,
+                                             GLfloat stippleLength, const QVector3D &stippleOrigin)
+{
+    QGLLinePacker::Vertex vertex;
+
+    vertex.position.x = position.x();
+    vertex.position.y = position.y();
+    vertex.position.z = position.z();
+    vertex.stippleOrigin.x = stippleOrigin.x();
+    vertex.stippleOrigin.y = stippleOrigin.y();
+    vertex.stippleOrigin.z = stippleOrigin.z();
+    vertex.stippleLength = stippleLength;
+    vertex.sequence = sequence;
+
+    return vertex;
+}
+
+// stages a strip as GL_LINES pairs like the path view does, the stipple starts at the first point
+void tst_LinePacker::appendStrip(QVector<QGLLinePacker::Vertex> &vertices, const QVector<QVector3D> &points,
+                                 GLfloat sequence, GLfloat stippleLength)
+{
+    for (int i = 0; (i + 1) < points.size(); ++i)
+    {
+        vertices.append(vertex(points.at(i), sequence, stippleLength, points.first()));
+        vertices.append(vertex(points.at(i + 1), sequence, stippleLength, points.first()));
+    }
+}
+
+void tst_LinePacker::verifyRoundTrip(const QGLLinePacker &packer, const QVector<QGLLinePacker::Vertex> &staged,
+                                     const QVector<QGLLinePacker::Chunk> &chunks,
+                                     const QVector<QGLLinePacker::PackedVertex> &packedVertices, const QVector<GLushort> &indices)
+{
+    QVector<QGLLinePacker::Vertex> unpacked;
+
+    QCOMPARE(indices.size(), staged.size());
+    packer.unpack(chunks, packedVertices.constData(), indices.constData(), 0, indices.size(), unpacked);
+    QCOMPARE(unpacked.size(), staged.size());
+
+    for (int i = 0; i < staged.size(); ++i)
+    {
+        const QGLLinePacker::Vertex &expected = staged.at(i);
+        const QGLLinePacker::Vertex &actual = unpacked.at(i);
+        GLfloat limit = packer.roundTripLimit(expected.position);
+
+        QVERIFY2(qAbs(actual.position.x - expected.position.x) <= limit, qPrintable(QString("x of vertex %1").arg(i)));
+        QVERIFY2(qAbs(actual.position.y - expected.position.y) <= limit, qPrintable(QString("y of vertex %1").arg(i)));
+        QVERIFY2(qAbs(actual.position.z - expected.position.z) <= limit, qPrintable(QString("z of vertex %1").arg(i)));
+        QCOMPARE(actual.sequence, expected.sequence);
+        QCOMPARE(actual.stippleLength, expected.stippleLength);
+        if (expected.stippleLength > 0.0)
+        {
+            QCOMPARE(actual.stippleOrigin.x, expected.stippleOrigin.x);
+            QCOMPARE(actual.stippleOrigin.y, expected.stippleOrigin.y);
+            QCOMPARE(actual.stippleOrigin.z, expected.stippleOrigin.z);
+        }
+    }
+
+    for (int i = 0; i < chunks.size(); ++i)
+    {
+        int end = ((i + 1) < chunks.size()) ? chunks.at(i + 1).firstVertex : packedVertices.size();
+        QVERIFY((end - chunks.at(i).firstVertex) <= QGLLinePacker::MaxChunkVertices);
+    }
+}
+
+void tst_LinePacker::roundTrip()
+{
+    QGLLinePacker packer(Resolution);
+    QVector<QGLLinePacker::Vertex> vertices;
+    QVector<QGLLinePacker::Chunk> chunks;
+    QVector<QGLLinePacker::PackedVertex> packedVertices;
+    QVector<GLushort> indices;
+    QVector<int> drawableOffsets;
+
+    // helices far away from the origin, several hundred chunk ranges apart
+    for (int path = 0; path < 50; ++path)
+    {
+        QVector<QVector3D> points;
+
+        for (int i = 0; i < 200; ++i)
+        {
+            qreal angle = i * 0.1 + path;
+            points.append(QVector3D(-800.0 + path * 31.7 + 25.0 * qCos(angle),
+                                    400.0 - path * 17.3 + 25.0 * qSin(angle),
+                                    -120.0 + i * 0.0137));
+        }
+        drawableOffsets.append(vertices.size());
+        appendStrip(vertices, points, path * 1000);
+    }
+
+    packer.pack(vertices, drawableOffsets, chunks, packedVertices, indices);
+    verifyRoundTrip(packer, vertices, chunks, packedVertices, indices);
+}
+
+void tst_LinePacker::sharedStripVertices()
+{
+    QGLLinePacker packer(Resolution);
+    QVector<QGLLinePacker::Vertex> vertices;
+    QVector<QGLLinePacker::Chunk> chunks;
+    QVector<QGLLinePacker::PackedVertex> packedVertices;
+    QVector<GLushort> indices;
+    QVector<int> drawableOffsets;
+    QVector<QVector3D> points;
+
+    for (int i = 0; i < 100; ++i)
+    {
+        points.append(QVector3D(i * 0.5, (i % 2) * 0.25, 0.0));
+    }
+
+    // the second strip starts where the first ends, it is a drawable of its own
+    drawableOffsets.append(vertices.size());
+    appendStrip(vertices, points, 1);
+    points.clear();
+    points.append(QVector3D(49.5, 0.25, 0.0));
+    points.append(QVector3D(49.5, 10.0, 0.0));
+    points.append(QVector3D(40.0, 10.0, 0.0));
+    drawableOffsets.append(vertices.size());
+    appendStrip(vertices, points, 1);
+
+    packer.pack(vertices, drawableOffsets, chunks, packedVertices, indices);
+    QCOMPARE(chunks.size(), 1);
+    QCOMPARE(indices.size(), 2 * 99 + 2 * 2);
+    QCOMPARE(packedVertices.size(), 100 + 3);
+    QCOMPARE((int)indices.at(2 * 99), 100);     // not shared across drawables
+    verifyRoundTrip(packer, vertices, chunks, packedVertices, indices);
+}
+
+void tst_LinePacker::longStippledTraverse()
+{
+    QGLLinePacker packer(Resolution);
+    QVector<QGLLinePacker::Vertex> staged;
+    QVector<QGLLinePacker::Vertex> vertices;
+    QVector<QGLLinePacker::Chunk> chunks;
+    QVector<QGLLinePacker::PackedVertex> packedVertices;
+    QVector<GLushort> indices;
+    QVector<int> drawableOffsets;
+    QVector<QVector3D> points;
+    GLfloat extent = Resolution * QGLLinePacker::MaxQuantizedValue;
+
+    // traverses far longer than one chunk range, the stipple length beyond the range of a quantized value
+    points << QVector3D(-300.0, -20.0, 5.0) << QVector3D(450.0, 120.0, -30.0);
+    appendStrip(staged, points, 1, 100.0);
+    points.clear();
+    points << QVector3D(450.0, 120.0, -30.0) << QVector3D(450.0, 120.0, 2.5);
+    appendStrip(staged, points, 2);
+    points.clear();
+    points << QVector3D(450.0, 120.0, 2.5) << QVector3D(-1000.0, 700.0, 2.5);
+    appendStrip(staged, points, 3, 2.5);
+
+    for (int i = 0; i < staged.size(); i += 2)
+    {
+        drawableOffsets.append(vertices.size());
+        packer.appendSplitSegments(staged, i, 2, vertices);
+    }
+    QVERIFY(vertices.size() > staged.size());
+
+    packer.pack(vertices, drawableOffsets, chunks, packedVertices, indices);
+    verifyRoundTrip(packer, vertices, chunks, packedVertices, indices);
+
+    // every chunk keeps the exact stipple of its traverse and stays within the range
+    for (int i = 0; i < chunks.size(); ++i)
+    {
+        const QGLLinePacker::Chunk &chunk = chunks.at(i);
+        int end = ((i + 1) < chunks.size()) ? chunks.at(i + 1).first : indices.size();
+
+        QVERIFY((chunk.stippleLength == 0.0f) || (chunk.stippleLength == 100.0f) || (chunk.stippleLength == 2.5f));
+        for (int j = chunk.first; j < end; ++j)
+        {
+            QVERIFY(qAbs(vertices.at(j).position.x - chunk.origin.x()) <= extent);
+            QVERIFY(qAbs(vertices.at(j).position.y - chunk.origin.y()) <= extent);
+            QVERIFY(qAbs(vertices.at(j).position.z - chunk.origin.z()) <= extent);
+            QCOMPARE(vertices.at(j).stippleLength, chunk.stippleLength);
+        }
+    }
+}
+
+void tst_LinePacker::chunkVertexLimit()
+{
+    QGLLinePacker packer(Resolution);
+    QVector<QGLLinePacker::Vertex> vertices;
+    QVector<QGLLinePacker::Chunk> chunks;
+    QVector<QGLLinePacker::PackedVertex> packedVertices;
+    QVector<GLushort> indices;
+    QVector<int> drawableOffsets;
+    QVector<QVector3D> points;
+
+    // a dense strip inside one chunk range needs more vertices than one chunk can index
+    for (int i = 0; i < 70000; ++i)
+    {
+        points.append(QVector3D(10.0 * qCos(i * 0.01), 10.0 * qSin(i * 0.01), 0.0));
+    }
+    drawableOffsets.append(0);
+    appendStrip(vertices, points, 7);
+
+    packer.pack(vertices, drawableOffsets, chunks, packedVertices, indices);
+    QCOMPARE(chunks.size(), 2);
+    QCOMPARE(packedVertices.size(), 70000 + 1);    // the second chunk repeats the shared vertex
+    verifyRoundTrip(packer, vertices, chunks, packedVertices, indices);
+}
+
+QTEST_APPLESS_MAIN(tst_LinePacker)
+
+#include "tst_linepacker.moc"